@@ -0,0 +1,506 @@
+
+#include "../include/Bdf.hpp"
+#include "../include/version.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+	#include <malloc.h>
+#endif
+
+/*
+ * bdf_bench.cpp
+ *
+ * Measures the time and allocations taken by the main operations of the
+ * library across a few document shapes, and prints the results as JSON.
+ *
+ * Usage:
+ * bdf_bench [--filter <substring>] [--min-time <seconds>] [--output <file>]
+ *
+ * Allocations are counted by replacing every form of the global operator new,
+ * so memory allocated by the library with malloc() is not included. Every form
+ * of operator delete is replaced to match, so memory is always given back the
+ * way it was allocated.
+ */
+
+std::atomic<uint64_t> allocations(0);
+std::atomic<uint64_t> allocatedBytes(0);
+
+/*
+ * Counts and allocates size bytes aligned to alignment, or returns nullptr if
+ * there isn't enough memory.
+ */
+static void* countedAllocate(std::size_t size, std::size_t alignment) noexcept
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+
+	if(size == 0) {
+		size = 1;
+	}
+
+	if(alignment <= alignof(std::max_align_t)) {
+		return std::malloc(size);
+	}
+
+	#ifdef _WIN32
+	return _aligned_malloc(size, alignment);
+	#else
+	// aligned_alloc() needs the size to be a multiple of the alignment
+	return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+	#endif
+}
+
+/*
+ * Frees memory from countedAllocate() with the same alignment. Never inlined, as
+ * GCC would otherwise see free() called on memory from the new expressions in
+ * this file and warn about mismatched allocation functions.
+ */
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+static void countedFree(void* p, std::size_t alignment) noexcept
+{
+	#ifdef _WIN32
+	if(alignment > alignof(std::max_align_t)) {
+		_aligned_free(p);
+		return;
+	}
+	#else
+	(void)alignment;
+	#endif
+
+	std::free(p);
+}
+
+static void* countedNew(std::size_t size, std::size_t alignment)
+{
+	void* p = countedAllocate(size, alignment);
+
+	if(p == nullptr) {
+		throw std::bad_alloc();
+	}
+
+	return p;
+}
+
+void* operator new(std::size_t size) {
+	return countedNew(size, alignof(std::max_align_t));
+}
+
+void* operator new[](std::size_t size) {
+	return countedNew(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	return countedAllocate(size, alignof(std::max_align_t));
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	return countedAllocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+	return countedNew(size, (std::size_t)alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+	return countedNew(size, (std::size_t)alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return countedAllocate(size, (std::size_t)alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return countedAllocate(size, (std::size_t)alignment);
+}
+
+void operator delete(void* p) noexcept {
+	countedFree(p, alignof(std::max_align_t));
+}
+
+void operator delete[](void* p) noexcept {
+	countedFree(p, alignof(std::max_align_t));
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	countedFree(p, alignof(std::max_align_t));
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+	countedFree(p, alignof(std::max_align_t));
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+	countedFree(p, alignof(std::max_align_t));
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+	countedFree(p, alignof(std::max_align_t));
+}
+
+void operator delete(void* p, std::align_val_t alignment) noexcept {
+	countedFree(p, (std::size_t)alignment);
+}
+
+void operator delete[](void* p, std::align_val_t alignment) noexcept {
+	countedFree(p, (std::size_t)alignment);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t alignment) noexcept {
+	countedFree(p, (std::size_t)alignment);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t alignment) noexcept {
+	countedFree(p, (std::size_t)alignment);
+}
+
+void operator delete(void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	countedFree(p, (std::size_t)alignment);
+}
+
+void operator delete[](void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	countedFree(p, (std::size_t)alignment);
+}
+
+class Result
+{
+public:
+	std::string name;
+	uint64_t iterations;
+	double nsPerOp;
+	double bytesPerSecond;
+	double allocationsPerOp;
+	double allocatedBytesPerOp;
+};
+
+std::vector<Result> results;
+std::string filter;
+double minTime = 0.5;
+
+// Stops the compiler from optimising away the results of benchmarked code
+volatile uint64_t sink;
+
+/*
+ * Runs op in batches, doubling the batch size until a batch takes at least minTime.
+ * bytes is the amount of data processed by each call of op, or 0 if it does not apply.
+ */
+void run(const std::string &name, uint64_t bytes, const std::function<void()> &op)
+{
+	if(name.find(filter) == std::string::npos) {
+		return;
+	}
+
+	// Warm up
+	op();
+
+	uint64_t iterations = 1;
+
+	for(;;)
+	{
+		uint64_t allocations_start = allocations.load();
+		uint64_t allocatedBytes_start = allocatedBytes.load();
+		auto start = std::chrono::steady_clock::now();
+
+		for(uint64_t i=0;i<iterations;i++) {
+			op();
+		}
+
+		auto end = std::chrono::steady_clock::now();
+		double seconds = std::chrono::duration<double>(end - start).count();
+
+		if(seconds < minTime && iterations < (1ULL << 40)) {
+			iterations *= 2;
+			continue;
+		}
+
+		Result result;
+		result.name = name;
+		result.iterations = iterations;
+		result.nsPerOp = seconds * 1e9 / iterations;
+		result.bytesPerSecond = bytes * iterations / seconds;
+		result.allocationsPerOp = (double)(allocations.load() - allocations_start) / iterations;
+		result.allocatedBytesPerOp = (double)(allocatedBytes.load() - allocatedBytes_start) / iterations;
+
+		results.push_back(result);
+
+		std::cerr << name << ": " << result.nsPerOp << " ns/op, " << result.allocationsPerOp << " allocations/op\n";
+
+		return;
+	}
+}
+
+// Documents
+
+void buildSmall(Bdf::BdfReader &reader)
+{
+	Bdf::BdfObject* root = reader.getObject();
+	Bdf::BdfNamedList* nl = root->newNamedList();
+	root->setNamedList(nl);
+
+	nl->set("id", root->newObject()->setLong(1234567890123));
+	nl->set("name", root->newObject()->setString("example"));
+	nl->set("enabled", root->newObject()->setBoolean(true));
+	nl->set("ratio", root->newObject()->setDouble(0.75));
+	nl->set("count", root->newObject()->setInteger(42));
+	nl->set("flags", root->newObject()->setByte(3));
+
+	Bdf::BdfList* tags = root->newList();
+	tags->add(root->newObject()->setString("a"));
+	tags->add(root->newObject()->setString("b"));
+	nl->set("tags", root->newObject()->setList(tags));
+}
+
+void buildWide(Bdf::BdfReader &reader)
+{
+	Bdf::BdfObject* root = reader.getObject();
+	Bdf::BdfNamedList* nl = root->newNamedList();
+	root->setNamedList(nl);
+
+	for(int i=0;i<10000;i++) {
+		nl->set("key" + std::to_string(i), root->newObject()->setInteger(i));
+	}
+}
+
+void buildDeep(Bdf::BdfReader &reader)
+{
+	Bdf::BdfObject* cur = reader.getObject();
+
+	for(int i=0;i<200;i++)
+	{
+		Bdf::BdfNamedList* nl = cur->newNamedList();
+		cur->setNamedList(nl);
+
+		nl->set("depth", cur->newObject()->setInteger(i));
+
+		Bdf::BdfObject* next = cur->newObject();
+		nl->set("child", next);
+		cur = next;
+	}
+
+	cur->setString("bottom");
+}
+
+void buildArrays(Bdf::BdfReader &reader)
+{
+	Bdf::BdfObject* root = reader.getObject();
+	Bdf::BdfNamedList* nl = root->newNamedList();
+	root->setNamedList(nl);
+
+	int size = 100000;
+	std::vector<int32_t> ints(size);
+	std::vector<int64_t> longs(size);
+	std::vector<double> doubles(size);
+
+	for(int i=0;i<size;i++) {
+		ints[i] = i * 3;
+		longs[i] = (int64_t)i * 1000003;
+		doubles[i] = i * 0.5;
+	}
+
+	nl->set("ints", root->newObject()->setIntegerArray(ints.data(), size));
+	nl->set("longs", root->newObject()->setLongArray(longs.data(), size));
+	nl->set("doubles", root->newObject()->setDoubleArray(doubles.data(), size));
+}
+
+// Benchmarks
+
+void benchDocument(const std::string &document, const std::function<void(Bdf::BdfReader&)> &build)
+{
+	Bdf::BdfReader reader;
+	build(reader);
+
+	char* data;
+	int size;
+	reader.serialize(&data, &size);
+
+	std::string human = reader.serializeHumanReadable();
+
+	run("parse_binary/" + document, size, [&]() {
+		Bdf::BdfReader parsed(data, size);
+		sink = sink + parsed.getObject()->getType();
+	});
+
+	run("serialize_binary/" + document, size, [&]() {
+		char* out;
+		int out_size;
+		reader.serialize(&out, &out_size);
+		sink = sink + out_size;
+		delete[] out;
+	});
+
+	run("parse_human/" + document, human.size(), [&]() {
+		Bdf::BdfReaderHuman parsed(human);
+		sink = sink + parsed.getObject()->getType();
+	});
+
+	run("serialize_human/" + document, human.size(), [&]() {
+		sink = sink + reader.serializeHumanReadable().size();
+	});
+
+	delete[] data;
+}
+
+void benchNamedList()
+{
+	Bdf::BdfReader reader;
+	buildWide(reader);
+
+	Bdf::BdfObject* root = reader.getObject();
+	Bdf::BdfNamedList* nl = root->getNamedList();
+
+	// Look up keys spread through the list, so the cost isn't just the first few items
+	std::vector<std::string> keys;
+	std::vector<int> ids;
+
+	for(int i=0;i<10000;i+=997) {
+		keys.push_back("key" + std::to_string(i));
+		ids.push_back(root->getKeyLocation(keys.back()));
+	}
+
+	size_t upto = 0;
+
+	run("named_list_get_string/wide", 0, [&]() {
+		sink = sink + nl->get(keys[upto++ % keys.size()])->getInteger();
+	});
+
+	run("named_list_get_id/wide", 0, [&]() {
+		sink = sink + nl->get(ids[upto++ % ids.size()])->getInteger();
+	});
+
+	run("named_list_set_string/wide", 0, [&]() {
+		nl->set(keys[upto++ % keys.size()], root->newObject()->setInteger(1));
+	});
+
+	run("named_list_set_id/wide", 0, [&]() {
+		nl->set(ids[upto++ % ids.size()], root->newObject()->setInteger(1));
+	});
+}
+
+void benchList()
+{
+	Bdf::BdfReader reader;
+	Bdf::BdfObject* root = reader.getObject();
+	Bdf::BdfList* list = root->newList();
+	root->setList(list);
+
+	for(int i=0;i<1000;i++) {
+		list->add(root->newObject()->setInteger(i));
+	}
+
+	int upto = 0;
+
+	run("list_get_index/1000", 0, [&]() {
+		sink = sink + list->get(upto)->getInteger();
+		upto = (upto + 97) % 1000;
+	});
+}
+
+void benchTypedArrays()
+{
+	Bdf::BdfReader reader;
+	Bdf::BdfObject* root = reader.getObject();
+
+	int size = 100000;
+	std::vector<int32_t> ints(size);
+
+	for(int i=0;i<size;i++) {
+		ints[i] = i;
+	}
+
+	run("typed_array_set/100000", size * sizeof(int32_t), [&]() {
+		root->setIntegerArray(ints.data(), size);
+	});
+
+	run("typed_array_get/100000", size * sizeof(int32_t), [&]() {
+		int32_t* v;
+		int v_size;
+		root->getIntegerArray(&v, &v_size);
+		sink = sink + v[v_size - 1];
+		delete[] v;
+	});
+}
+
+void writeJson(std::ostream &out)
+{
+	out << "{\n";
+	out << "\t\"context\": {\n";
+	out << "\t\t\"library_version\": \"" << Bdf::getLibraryVersion() << "\",\n";
+	out << "\t\t\"min_time\": " << minTime << "\n";
+	out << "\t},\n";
+	out << "\t\"benchmarks\": [";
+
+	for(size_t i=0;i<results.size();i++)
+	{
+		const Result &r = results[i];
+
+		out << (i == 0 ? "\n" : ",\n");
+		out << "\t\t{\n";
+		out << "\t\t\t\"name\": \"" << r.name << "\",\n";
+		out << "\t\t\t\"iterations\": " << r.iterations << ",\n";
+		out << "\t\t\t\"ns_per_op\": " << r.nsPerOp << ",\n";
+		out << "\t\t\t\"bytes_per_second\": " << r.bytesPerSecond << ",\n";
+		out << "\t\t\t\"allocations_per_op\": " << r.allocationsPerOp << ",\n";
+		out << "\t\t\t\"allocated_bytes_per_op\": " << r.allocatedBytesPerOp << "\n";
+		out << "\t\t}";
+	}
+
+	out << "\n\t]\n";
+	out << "}\n";
+}
+
+int main(int argc, char** argv)
+{
+	std::string output;
+
+	for(int i=1;i<argc;i++)
+	{
+		std::string arg = argv[i];
+
+		if(arg == "--filter" && i + 1 < argc) {
+			filter = argv[++i];
+		} else if(arg == "--min-time" && i + 1 < argc) {
+			minTime = std::stod(argv[++i]);
+		} else if(arg == "--output" && i + 1 < argc) {
+			output = argv[++i];
+		} else {
+			std::cerr << "Usage: " << argv[0] << " [--filter <substring>] [--min-time <seconds>] [--output <file>]\n";
+			return 1;
+		}
+	}
+
+	benchDocument("small", buildSmall);
+	benchDocument("wide", buildWide);
+	benchDocument("deep", buildDeep);
+	benchDocument("arrays", buildArrays);
+	benchNamedList();
+	benchList();
+	benchTypedArrays();
+
+	if(output.empty()) {
+		writeJson(std::cout);
+		return 0;
+	}
+
+	std::ofstream out(output);
+
+	if(!out.is_open()) {
+		std::cerr << "Could not open " << output << " for writing.\n";
+		return 1;
+	}
+
+	writeJson(out);
+
+	return 0;
+}
@@ -1,5 +1,9 @@
 
 #include <iostream>
+#include <cstring>
+#include <cmath>
+#include <thread>
+#include <sstream>
 
 #include "../include/Bdf.hpp"
 
@@ -119,5 +123,386 @@ int main()
 
 	test(!nl->exists("test"));
 
+	Bdf::BdfPath path = Bdf::BdfPath::compile("[5].Hello");
+
+	test(path.evaluate(bdf)->getInteger() == 42);
+	test(Bdf::BdfPath::compile("[5].missing").evaluate(bdf) == NULL);
+	test(!nl->exists("missing"));
+
+	Bdf::BdfPath key_b = Bdf::BdfPath::compile("b");
+	Bdf::BdfReader* first_keys = new Bdf::BdfReader();
+
+	first_keys->getObject()->getNamedList()->set("b", first_keys->getObject()->newObject()->setInteger(1));
+	test(key_b.evaluate(first_keys)->getInteger() == 1);
+	delete first_keys;
+
+	Bdf::BdfReader* second_keys = new Bdf::BdfReader();
+
+	second_keys->getObject()->getNamedList()->set("c", second_keys->getObject()->newObject()->setInteger(2));
+	second_keys->getObject()->getNamedList()->set("x", second_keys->getObject()->newObject()->setInteger(3));
+	test(key_b.evaluate(second_keys) == NULL);
+	delete second_keys;
+
+	int32_t ids[] = {1000, 1001, 1003, 1010, 990};
+	Bdf::BdfReader compact;
+	compact.getObject()->setIntegerArray(ids, 5);
+
+	char* compact_data;
+	int compact_size;
+	compact.serialize(&compact_data, &compact_size, Bdf::BdfSerializeOptions(Bdf::BdfSerializeOptions::AUTO));
+
+	test(compact_size < 5 * 4);
+
+	Bdf::BdfReader compact2(compact_data, compact_size);
+	int32_t* ids2;
+	int ids2_size;
+	compact2.getObject()->getIntegerArray(&ids2, &ids2_size);
+
+	test(ids2_size == 5 && memcmp(ids, ids2, sizeof(ids)) == 0);
+
+	delete[] ids2;
+	delete[] compact_data;
+
+	Bdf::BdfReader table;
+	Bdf::BdfList* rows = table.getObject()->newList();
+	table.getObject()->setList(rows);
+
+	for(int i=0;i<10;i++) {
+		Bdf::BdfNamedList* row = table.getObject()->newNamedList();
+		row->set("id", table.getObject()->newObject()->setInteger(i));
+		row->set("name", table.getObject()->newObject()->setString("row"));
+		rows->add(table.getObject()->newObject()->setNamedList(row));
+	}
+
+	Bdf::BdfSerializeOptions columnar;
+	columnar.listEncoding = Bdf::BdfSerializeOptions::COLUMNAR;
+	table.serialize(&compact_data, &compact_size, columnar);
+
+	Bdf::BdfReader table2(compact_data, compact_size);
+
+	test(table2.serializeHumanReadable() == table.serializeHumanReadable());
+
+	Bdf::BdfReaderColumn column(compact_data, compact_size, Bdf::BdfPath::compile(""), "id");
+	column.getObject()->getIntegerArray(&ids2, &ids2_size);
+
+	test(ids2_size == 10 && ids2[9] == 9);
+
+	Bdf::BdfReaderPath columnar_id(compact_data, compact_size, Bdf::BdfPath::compile("[3].id"));
+	Bdf::BdfReaderPath columnar_name(compact_data, compact_size, Bdf::BdfPath::compile("[3].name"));
+
+	test(columnar_id.getView().element == 3 && columnar_id.getObject()->getInteger() == 3);
+	test(columnar_name.getView().element == -1 && columnar_name.getObject()->getString() == "row");
+	test(!Bdf::BdfPath::compile("[10].id").evaluate(compact_data, compact_size));
+
+	delete[] ids2;
+	delete[] compact_data;
+
+	Bdf::BdfSerializeOptions columnar_compact(Bdf::BdfSerializeOptions::COMPACT);
+	columnar_compact.listEncoding = Bdf::BdfSerializeOptions::COLUMNAR;
+	table.serialize(&compact_data, &compact_size, columnar_compact);
+
+	Bdf::BdfReaderPath compact_id(compact_data, compact_size, Bdf::BdfPath::compile("[7].id"));
+
+	test(compact_id.getView().type == Bdf::BdfTypes::INTEGER && compact_id.getObject()->getInteger() == 7);
+
+	delete[] compact_data;
+
+	Bdf::BdfSerializeOptions strings;
+	strings.stringTable = true;
+	table.serialize(&compact_data, &compact_size, strings);
+
+	Bdf::BdfReader table3(compact_data, compact_size);
+
+	test(table3.getObject()->getList()->get(9)->getNamedList()->get("name")->getString() == "row");
+
+	delete[] compact_data;
+
+	Bdf::BdfStats stats = table3.getStats();
+
+	if(Bdf::BdfStats::isEnabled()) {
+		test(stats.nodes[Bdf::BdfTypes::NAMED_LIST] == 10 && stats.bytesParsed == (uint64_t)compact_size);
+		test(stats.maxDepth == 3 && stats.allocations > 0);
+	}
+
+	test(stats.keys > 0);
+
+	table3.resetStats();
+	test(table3.getStats().bytesParsed == 0);
+
+	Bdf::BdfMemoryUsage usage = table3.memoryUsage();
+	Bdf::BdfMemoryUsage row_usage = table3.getObject()->getList()->get(0)->memoryUsage();
+
+	test(usage.nodes > row_usage.nodes * 10 && usage.keys > 0 && row_usage.keys == 0);
+	test(usage.total() == usage.nodes + usage.items + usage.payloads + usage.strings + usage.keys + usage.pooled);
+
+	table3.serialize(&compact_data, &compact_size, strings);
+
+	test(Bdf::BdfValidator::validate(compact_data, compact_size).error == Bdf::BdfValidator::NONE);
+
+	Bdf::BdfReaderPath row(compact_data, compact_size, Bdf::BdfPath::compile("[9].name"));
+	Bdf::BdfReaderPath missing(compact_data, compact_size, Bdf::BdfPath::compile("[10]"));
+
+	test(row.getView() && row.getObject()->getString() == "row");
+	test(!missing.getView() && missing.getObject()->getType() == Bdf::BdfTypes::UNDEFINED);
+	test(Bdf::BdfValidator::validate(compact_data, compact_size - 1).error != Bdf::BdfValidator::NONE);
+
+	// An integer followed by a lookup table with a negative size tag
+	char corrupted[] = {0, 0, 0, 0, 42, (char)0xff, (char)0xff, (char)0xff, (char)0xf0, 0, 0, 0, 0};
+	corrupted[0] = Bdf::BdfObject::getFlags(Bdf::BdfTypes::INTEGER, 0, 0);
+
+	try {
+		Bdf::BdfReader corrupted_reader(corrupted, sizeof(corrupted));
+		test(false);
+	} catch(Bdf::BdfError &e) {
+		test(true);
+	}
+
+	test(!Bdf::BdfPath::compile("").evaluate(corrupted, sizeof(corrupted)));
+	test(Bdf::BdfValidator::validate(corrupted, sizeof(corrupted)).error != Bdf::BdfValidator::NONE);
+	test(Bdf::BdfValidator::validate(compact_data, 0).error == Bdf::BdfValidator::INVALID_DATA_SIZE);
+
+	compact_data[0] = (char)255;
+	test(Bdf::BdfValidator::validate(compact_data, compact_size).error == Bdf::BdfValidator::INVALID_FLAGS);
+	test(Bdf::BdfValidator::validate(compact_data, compact_size).offset == 0);
+
+	delete[] compact_data;
+
+	Bdf::BdfList* rows3 = table3.getObject()->getList();
+
+	test(*table.getObject() == *table3.getObject() && table.getObject()->hash() == table3.getObject()->hash());
+	test(rows->findIndex(rows3->get(7)) == 7);
+
+	rows->get(7)->getNamedList()->get("id")->setInteger(70);
+
+	test(!rows->findIndex(rows3->get(7)) && !(*table.getObject() == *table3.getObject()));
+
+	Bdf::BdfDiff patch(&table3, &table);
+	patch.serialize(&compact_data, &compact_size);
+
+	Bdf::BdfDiff patch2(compact_data, compact_size);
+	patch2.apply(&table3);
+
+	test(patch.size() == 1 && patch2.size() == 1 && *table.getObject() == *table3.getObject());
+	test(Bdf::BdfDiff(&table, &table3).size() == 0);
+
+	delete[] compact_data;
+
+	Bdf::BdfReader snapshot(table3);
+	table3.getObject()->getList()->get(3)->getNamedList()->get("name")->setString("changed");
+
+	test(snapshot.getObject()->getList()->get(3)->getNamedList()->get("name")->getString() == "row");
+	test(Bdf::BdfDiff(&snapshot, &table3).size() == 1 && *snapshot.getObject() == *table.getObject());
+
+	// Pointers got before the copy change the reader, and go on showing the copy's version
+	Bdf::BdfNamedList* row4 = table3.getObject()->getList()->get(4)->getNamedList();
+	Bdf::BdfObject* id5 = table3.getObject()->getList()->get(5)->getNamedList()->get("id");
+	Bdf::BdfReader snapshot2(table3);
+
+	test(table3.getObject()->getList()->get(6) == snapshot2.getObject()->getList()->get(6));
+
+	row4->set("name", table3.getObject()->newObject()->setString("set"));
+	Bdf::BdfObject* id5_changed = id5->setInteger(500);
+
+	test(id5_changed != id5 && id5->getInteger() == 5 && table3.getObject()->getList()->get(5)->getNamedList()->get("id") == id5_changed);
+	test(snapshot2.getObject()->getList()->get(4)->getNamedList()->get("name")->getString() == "row");
+	test(snapshot2.getObject()->getList()->get(5)->getNamedList()->get("id")->getInteger() == 5);
+	test(table3.getObject()->getList()->get(4)->getNamedList()->get("name")->getString() == "set");
+	test(table3.getObject()->getList()->get(6) == snapshot2.getObject()->getList()->get(6));
+
+	try {
+		id5->setInteger(50);
+		test(false);
+	} catch(std::logic_error &e) {
+		test(snapshot2.getObject()->getList()->get(5)->getNamedList()->get("id")->getInteger() == 5);
+	}
+
+	// Copies can be read and deleted on another thread while the reader is changed, adding keys
+	Bdf::BdfReader* snapshot3 = new Bdf::BdfReader(table3);
+	bool consistent = true;
+
+	std::thread snapshot_reader([&consistent, snapshot3]() {
+		for(int i=0;i<100;i++) {
+			Bdf::BdfNamedList* row = snapshot3->getObject()->getList()->get(i % 10)->getNamedList();
+			std::string name = (i % 10 == 3) ? "changed" : (i % 10 == 4) ? "set" : "row";
+			consistent &= row->get("name")->getString() == name && !row->exists("key" + std::to_string(i));
+		}
+
+		delete snapshot3;
+	});
+
+	for(int i=0;i<100;i++) {
+		table3.getObject()->getList()->get(i % 10)->getNamedList()->get("id")->setInteger(i);
+		table3.getObject()->getList()->get(i % 10)->getNamedList()->set("key" + std::to_string(i), table3.getObject()->newObject());
+	}
+
+	snapshot_reader.join();
+
+	test(consistent && table3.getObject()->getList()->get(9)->getNamedList()->exists("key99"));
+	test(table3.getObject()->getList()->get(9)->getNamedList()->get("id")->getInteger() == 99);
+	test(snapshot2.getObject()->getList()->get(9)->getNamedList()->get("id")->getInteger() == 9);
+
+	Bdf::BdfReader ordered;
+	Bdf::BdfReader reversed;
+
+	ordered.getObject()->getNamedList()->set("a", ordered.getObject()->newObject()->setInteger(1));
+	ordered.getObject()->getNamedList()->set("b", ordered.getObject()->newObject()->setDouble(std::nan("1")));
+	reversed.getObject()->getNamedList()->set("b", reversed.getObject()->newObject()->setDouble(std::nan("2")));
+	reversed.getObject()->getNamedList()->set("a", reversed.getObject()->newObject()->setInteger(1));
+
+	Bdf::BdfSerializeOptions canonical;
+	canonical.canonical = true;
+
+	char* reversed_data;
+	int reversed_size;
+
+	ordered.serialize(&compact_data, &compact_size, canonical);
+	reversed.serialize(&reversed_data, &reversed_size, canonical);
+
+	test(compact_size == reversed_size && memcmp(compact_data, reversed_data, compact_size) == 0);
+	test(ordered.contentHash() == reversed.contentHash() && ordered.contentHash() == Bdf::BdfReader::contentHash(compact_data, compact_size));
+
+	delete[] compact_data;
+	delete[] reversed_data;
+
+	const char* buffered_data;
+	int buffered_size;
+
+	table.serialize(&compact_data, &compact_size);
+	table.serializeBuffered(&buffered_data, &buffered_size);
+
+	test(buffered_size == compact_size && memcmp(buffered_data, compact_data, compact_size) == 0);
+
+	char into_data[1024];
+
+	test(table.serializedSize() == (size_t)compact_size && table.serializeInto(into_data, 4) == (size_t)compact_size);
+	test(table.serializeInto(into_data, sizeof(into_data)) == (size_t)compact_size && memcmp(into_data, compact_data, compact_size) == 0);
+
+	#ifdef BDF_HAS_IOVEC
+
+	std::vector<iovec> segments;
+	std::string gathered;
+
+	table.getObject()->getList()->get(0)->getNamedList()->set("payload", table.getObject()->newObject()->setString(std::string(100, 'x')));
+	table.serializeVectored(&segments, Bdf::BdfSerializeOptions(), 64);
+
+	for(const iovec &segment : segments) {
+		gathered.append((const char*)segment.iov_base, segment.iov_len);
+	}
+
+	test(segments.size() == 3 && Bdf::BdfReader(gathered.data(), gathered.size()).getObject()->hash() == table.getObject()->hash());
+
+	table.getObject()->getList()->get(0)->getNamedList()->remove("payload");
+
+	#endif
+
+	Bdf::BdfReader reused;
+	reused.load(compact_data, compact_size);
+	reused.resetObject();
+
+	test(reused.memoryUsage().pooled > 0);
+
+	reused.load(compact_data, compact_size);
+
+	test(*reused.getObject() == *table.getObject() && Bdf::BdfPath::compile("[7].id").evaluate(&reused)->getInteger() == 70);
+
+	try {
+		reused.load(corrupted, sizeof(corrupted));
+		test(false);
+	} catch(Bdf::BdfError &e) {
+		test(*reused.getObject() == *table.getObject() && Bdf::BdfPath::compile("[7].id").evaluate(&reused)->getInteger() == 70);
+	}
+
+	Bdf::BdfReader culled;
+	Bdf::BdfNamedList* culled_named = culled.getObject()->getNamedList();
+
+	culled_named->set("kept", culled.getObject()->newObject()->setInteger(1));
+	culled_named->set("removed", culled.getObject()->newObject()->setInteger(2));
+	culled_named->remove("removed");
+	culled.serializeBuffered(&buffered_data, &buffered_size);
+
+	test(std::string(buffered_data, buffered_size).find("removed") == std::string::npos && std::string(buffered_data, buffered_size).find("kept") != std::string::npos);
+
+	for(int i=0;i<100;i++) {
+		culled_named->exists("unused" + std::to_string(i));
+	}
+
+	Bdf::BdfReader detached;
+	Bdf::BdfNamedList* never_added = detached.getObject()->newNamedList();
+
+	detached.getObject()->getNamedList()->set("attached", detached.getObject()->newObject()->setInteger(1));
+	never_added->set("detached", detached.getObject()->newObject()->setInteger(2));
+	detached.serializeBuffered(&buffered_data, &buffered_size);
+
+	test(std::string(buffered_data, buffered_size).find("detached") == std::string::npos && std::string(buffered_data, buffered_size).find("attached") != std::string::npos);
+
+	delete never_added;
+
+	std::vector<int> held_keys = culled_named->keys();
+
+	culled.serializeBuffered(&buffered_data, &buffered_size);
+
+	test(culled_named->keys() == held_keys && culled_named->get(held_keys[0])->getInteger() == 1);
+	test(culled.compactKeys() == 101 && culled_named->get("kept")->getInteger() == 1 && Bdf::BdfPath::compile("kept").evaluate(&culled)->getInteger() == 1);
+
+	for(int i=0;i<100;i++) {
+		culled_named->exists("unused" + std::to_string(i));
+	}
+
+	Bdf::BdfSerializeOptions compacting;
+	compacting.compactKeys = true;
+	culled.serializeBuffered(&buffered_data, &buffered_size, compacting);
+
+	test(culled.compactKeys() == 0 && culled_named->get("kept")->getInteger() == 1);
+
+	Bdf::BdfObject* viewed = culled_named->get(std::string_view("kept"));
+	std::string view_source(64, 'v');
+
+	viewed->setString(std::string_view(view_source));
+	viewed->setString(std::string_view(view_source.data(), 10));
+
+	test(viewed->getStringView() == std::string_view(view_source.data(), 10) && culled_named->exists(std::string_view("kept")));
+
+	Bdf::BdfObject* appended = culled.getObject()->newObject();
+	int32_t appended_range[] = {3, 4, 5};
+
+	for(int i=0;i<100;i++) {
+		appended->appendInteger(i);
+	}
+
+	appended->appendRange(appended_range, 3);
+	appended->setIntegerAt(0, -1);
+
+	test(appended->getArraySize() == 103 && appended->getIntegerAt(0) == -1 && appended->getIntegerAt(102) == 5);
+
+	delete appended;
+
+	std::stringstream compressed;
+	Bdf::BdfReader big_string;
+
+	big_string.getObject()->setString(std::string(100000, 'b'));
+	big_string.serializeCompressed(compressed);
+
+	Bdf::BdfReaderCompressed decompressed(compressed);
+
+	test(*decompressed.getObject() == *big_string.getObject());
+
+	std::filesystem::path async_path = std::filesystem::temp_directory_path() / "bdf_tests_async.bdf";
+	Bdf::BdfReader async_reader;
+
+	Bdf::BdfAsync::save(&table, async_path).getFuture().get();
+	Bdf::BdfAsync::load(&async_reader, async_path).getFuture().get();
+
+	test(*async_reader.getObject() == *table.getObject());
+
+	try {
+		Bdf::BdfAsync::load(&async_reader, async_path, 4).getFuture().get();
+		test(false);
+	} catch(std::runtime_error &e) {
+		test(*async_reader.getObject() == *table.getObject());
+	}
+
+	std::filesystem::remove(async_path);
+	delete[] compact_data;
+
 	return 0;
 }
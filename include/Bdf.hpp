@@ -6,6 +6,9 @@ namespace Bdf
 {
 	class BdfList;
 	class BdfIndent;
+	class BdfSerializeOptions;
+	class BdfStats;
+	class BdfMemoryUsage;
 	class BdfLookupTable;
 	class BdfNamedList;
 	class BdfObject;
@@ -14,12 +17,29 @@ namespace Bdf
 	class BdfError;
 	class BdfStringReader;
 	class BdfReaderHuman;
+	class BdfPath;
+	class BdfValidator;
+	class BdfColumns;
+	class BdfReaderColumn;
+	class BdfReaderPath;
+	class BdfDiff;
+	class BdfCompression;
+	class BdfReaderCompressed;
+	class BdfReaderGz;
+	class BdfReaderXz;
+	class BdfReaderZstd;
+	class BdfAsync;
+	class BdfPool;
 	
 }
 
+#include "BdfPool.hpp"
 #include "BdfLookupTable.hpp"
 #include "BdfList.hpp"
 #include "BdfIndent.hpp"
+#include "BdfSerializeOptions.hpp"
+#include "BdfStats.hpp"
+#include "BdfMemoryUsage.hpp"
 #include "BdfNamedList.hpp"
 #include "BdfObject.hpp"
 #include "BdfReader.hpp"
@@ -27,5 +47,14 @@ namespace Bdf
 #include "BdfError.hpp"
 #include "BdfStringReader.hpp"
 #include "BdfReaderHuman.hpp"
+#include "BdfPath.hpp"
+#include "BdfValidator.hpp"
+#include "BdfColumns.hpp"
+#include "BdfReaderColumn.hpp"
+#include "BdfReaderPath.hpp"
+#include "BdfDiff.hpp"
+#include "BdfCompression.hpp"
+#include "BdfReaderCompressed.hpp"
+#include "BdfAsync.hpp"
 
 #endif
@@ -0,0 +1,137 @@
+
+#ifndef BDFASYNC_HPP_
+#define BDFASYNC_HPP_
+
+#include "Bdf.hpp"
+#include "BdfSerializeOptions.hpp"
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <climits>
+#include <cstddef>
+
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+	#include <coroutine>
+	#define BDF_HAS_COROUTINES
+#endif
+
+namespace Bdf
+{
+	/**
+	 * Class for loading and saving binary BDF files on a background thread, so an event loop
+	 * isn't blocked while the file is read and parsed or serialised and written.
+	 *
+	 * Each call starts an Operation on its own thread. The result can be waited for with a std::future
+	 * or, when compiled as C++20, with co_await. Files are read and written in chunks of CHUNK_SIZE,
+	 * checking for cancellation between chunks. The reader passed in must not be used by anything else
+	 * until the operation has finished.
+	 * @since 2.0.0
+	 */
+	class BdfAsync
+	{
+	public:
+		/**
+		 * The most bytes read or written between checks for cancellation.
+		 */
+		static constexpr size_t CHUNK_SIZE = 1 << 20;
+
+		/**
+		 * Class that represents a load or save running in the background.
+		 * Copies of an Operation refer to the same load or save.
+		 */
+		class Operation
+		{
+			friend class BdfAsync;
+
+		public:
+			/**
+			 * Asks the operation to stop at the next chunk. The operation then fails with a std::system_error
+			 * holding std::errc::operation_canceled, unless it had already finished.
+			 */
+			void cancel() noexcept;
+
+			/**
+			 * Checks if the operation has finished, successfully or not.
+			 */
+			bool isDone() const noexcept;
+
+			/**
+			 * Gets a future that becomes ready once the operation has finished, and holds the exception it
+			 * failed with, if any. Can only be called once for each operation.
+			 * @throw std::future_error if the future has already been got.
+			 */
+			std::future<void> getFuture();
+
+			#ifdef BDF_HAS_COROUTINES
+
+			bool await_ready() const noexcept {
+				return isDone();
+			}
+
+			/**
+			 * Resumes the awaiting coroutine on the thread running the operation once it has finished.
+			 */
+			bool await_suspend(std::coroutine_handle<> handle) {
+				return suspend(handle.address(), [](void* address) {
+					std::coroutine_handle<>::from_address(address).resume();
+				});
+			}
+
+			/**
+			 * Rethrows the exception the operation failed with, if any.
+			 */
+			void await_resume() const {
+				rethrow();
+			}
+
+			#endif
+
+		private:
+			class State;
+
+			std::shared_ptr<State> state;
+
+			/**
+			 * Sets resume(address) to be called once the operation has finished.
+			 * @return false if the operation has already finished, so nothing was set.
+			 */
+			bool suspend(void* address, void (*resume)(void*));
+			void rethrow() const;
+		};
+
+		/**
+		 * Reads the binary BDF file located at filename in the background, then parses it into reader
+		 * with BdfReader::load(), replacing its document and reusing its memory.
+		 * The file is read into one buffer the size of the file, which is freed once it is parsed.
+		 * @param reader the reader to load the file into.
+		 * @param filename the file to read.
+		 * @param maxSize the biggest file to read, in bytes. Bigger files fail without being read.
+		 * @return the operation loading the file, which fails with BdfError if the file isn't valid binary BDF
+		 *         data, std::runtime_error if the file couldn't be read or is bigger than maxSize, or
+		 *         std::system_error if it was cancelled.
+		 */
+		static Operation load(BdfReader* reader, const std::filesystem::path &filename, size_t maxSize = INT_MAX);
+
+		/**
+		 * Serialises reader in the background and writes it to the file located at filename.
+		 * The data is written to a temporary file next to filename, which replaces filename once all of
+		 * it has been written, so a failed or cancelled save leaves the old file as it was. Big payloads
+		 * are written from where they're stored (see BdfReader::serializeVectored()) where that's supported.
+		 * @param reader the reader to save.
+		 * @param filename the file to write.
+		 * @param options the encodings to use.
+		 * @return the operation saving the file, which fails with std::runtime_error if the file couldn't be
+		 *         written, or std::system_error if it was cancelled.
+		 */
+		static Operation save(BdfReader* reader, const std::filesystem::path &filename, const BdfSerializeOptions &options = BdfSerializeOptions());
+
+	private:
+		/**
+		 * Runs job on its own thread, then completes the future and resumes anything awaiting the operation.
+		 */
+		static Operation start(std::function<void(Operation::State*)> job);
+	};
+}
+
+#endif
@@ -0,0 +1,127 @@
+
+#ifndef BDFCOLUMNS_HPP_
+#define BDFCOLUMNS_HPP_
+
+#include "Bdf.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace Bdf
+{
+	/**
+	 * The columnar form of a BdfList of BdfNamedLists that all have the same keys.
+	 *
+	 * Instead of repeating every key for every row, each key is stored once followed by a
+	 * column holding the value for every row. Columns whose values all have the same primitive
+	 * type are stored as typed arrays, and all other columns are stored as lists.
+	 * @internal
+	 * @since 2.0.0
+	 */
+	class BdfColumns
+	{
+	private:
+		/**
+		 * Subclass that represents a single column.
+		 * @internal
+		 */
+		class Column
+		{
+		public:
+			int key;
+
+			/**
+			 * A typed array of the values in the column, or nullptr if the values are stored as a list.
+			 */
+			BdfObject* array;
+
+			/**
+			 * The values of the column when they are stored as a list.
+			 */
+			std::vector<BdfObject*> values;
+
+			/**
+			 * The serialised size of the column, excluding its key.
+			 */
+			int size;
+		};
+
+		const BdfList* list;
+		std::vector<Column> columns;
+		uint64_t rows;
+		int size;
+
+		BdfColumns(const BdfList* list);
+
+		/**
+		 * Adds object at key to the end of row.
+		 * @internal
+		 */
+		static void appendValue(BdfNamedList* row, int key, BdfObject* object);
+
+	public:
+		/**
+		 * Deleted (no copy constructor).
+		 */
+		BdfColumns(const BdfColumns&) = delete;
+
+		virtual ~BdfColumns();
+
+		/**
+		 * Creates the columnar form of list. serializeSeeker() must already have been called on
+		 * every row of the list.
+		 * @return the columns, or nullptr if the items in list aren't named lists with the same keys.
+		 */
+		static BdfColumns* create(const BdfList* list, int* locations);
+
+		/**
+		 * Packs values into a typed array if they are all the same primitive type.
+		 * @return a new array object, or nullptr if the values can't be stored in a typed array.
+		 */
+		static BdfObject* createArray(BdfLookupTable* lookupTable, const std::vector<BdfObject*> &values);
+
+		/**
+		 * Gets the size of a value of the primitive type type when it is stored in a typed array.
+		 * @return the size in bytes, or -1 if type isn't a primitive type.
+		 */
+		static int getElementSize(char type) noexcept;
+
+		/**
+		 * Creates an object holding the value of the primitive type type stored at data in a typed array.
+		 * @return a new object.
+		 */
+		static BdfObject* readElement(BdfLookupTable* lookupTable, char type, const char* data);
+
+		/**
+		 * Creates an object holding the element at index of the serialised typed array at data, which can be compact.
+		 * @param data the serialised array, starting at its flag byte.
+		 * @return a new object, or nullptr if the array is malformed or index is out of range.
+		 */
+		static BdfObject* readArrayElement(BdfLookupTable* lookupTable, const char* data, int size, uint64_t index);
+
+		/**
+		 * Expands columnar data back into a list of named lists.
+		 * @return a new list, or nullptr if the data is malformed.
+		 */
+		static BdfList* expand(BdfLookupTable* lookupTable, const char* data, int size);
+
+		/**
+		 * Reads the values at key from every row of the serialised list at data, without
+		 * decoding anything else. The list can be stored as rows or as columns.
+		 * @param data the serialised list, starting at its flag byte.
+		 * @return a new typed array or list of the values, or nullptr if the list is malformed.
+		 */
+		static BdfObject* readColumn(BdfLookupTable* lookupTable, const char* data, int size, int key);
+
+		/**
+		 * Gets the serialised size of the columns.
+		 */
+		int serializeSeeker() const noexcept;
+
+		/**
+		 * Serialises the columns to data using locations.
+		 */
+		int serialize(char* data, int* locations) const;
+	};
+}
+
+#endif
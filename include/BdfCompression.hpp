@@ -0,0 +1,175 @@
+
+#ifndef BDFCOMPRESSION_HPP_
+#define BDFCOMPRESSION_HPP_
+
+#include "Bdf.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+
+namespace Bdf
+{
+	class BdfCompressionState;
+
+	/**
+	 * Class containing the streaming compression codecs used by BdfReaderCompressed and
+	 * BdfReader::serializeCompressed().
+	 *
+	 * Codecs are only available if the library was built with them (see isSupported()); using a codec
+	 * that is not available throws std::runtime_error.
+	 * @since 2.0.0
+	 */
+	class BdfCompression
+	{
+	public:
+		/**
+		 * Enumeration type representing a compression codec.
+		 * @since 2.0.0
+		 */
+		enum Codec: uint8_t {
+			/**
+			 * No compression. Data is passed through unchanged.
+			 */
+			NONE,
+
+			/**
+			 * gzip compression, provided by zlib.
+			 */
+			GZIP,
+
+			/**
+			 * xz compression, provided by liblzma.
+			 */
+			XZ,
+
+			/**
+			 * Zstandard compression, provided by libzstd. This is by far the fastest of the three.
+			 */
+			ZSTD,
+
+			/**
+			 * When decompressing, detect the codec from the magic bytes at the start of the data. Data
+			 * without a known magic number is treated as uncompressed.
+			 * When compressing, use the fastest codec the library was built with: ZSTD, then GZIP, then XZ,
+			 * or NONE if none of them were.
+			 */
+			AUTO,
+		};
+
+		/**
+		 * Checks if the library was built with support for codec.
+		 * @param codec the codec to check.
+		 * @return true if codec can be used for compressing and decompressing, false otherwise.
+		 */
+		static bool isSupported(Codec codec) noexcept;
+
+		/**
+		 * Detects the codec used to compress data from its magic bytes.
+		 * @param data the first bytes of the compressed data.
+		 * @param size the number of bytes available at data.
+		 * @return the detected codec, or NONE if data does not start with a known magic number.
+		 */
+		static Codec detect(const char* data, size_t size) noexcept;
+
+		/**
+		 * Class that decompresses an input stream in chunks.
+		 * @since 2.0.0
+		 */
+		class Decompressor
+		{
+		public:
+			/**
+			 * Creates a decompressor which will read compressed data from stream.
+			 * @param stream the stream to read compressed data from.
+			 * @param codec the codec the data was compressed with, or AUTO to detect it.
+			 * @throw std::runtime_error if codec is not supported.
+			 */
+			explicit Decompressor(std::istream &stream, Codec codec = Codec::AUTO);
+
+			/**
+			 * Deleted (no copy constructor).
+			 */
+			Decompressor(const Decompressor&) = delete;
+
+			/**
+			 * Destroys the decompressor.
+			 */
+			virtual ~Decompressor();
+
+			/**
+			 * Decompresses up to size bytes into data.
+			 * @param data the buffer to write the decompressed data to.
+			 * @param size the size of the buffer in bytes.
+			 * @return the number of bytes written to data. Less than size is only returned at the end of the data.
+			 * @throw std::runtime_error if the data is corrupt.
+			 */
+			size_t read(char* data, size_t size);
+
+			/**
+			 * Gets the codec being used, which is the detected codec if the decompressor was created with AUTO.
+			 * @return the codec being used.
+			 */
+			Codec getCodec() const noexcept;
+
+		private:
+			std::istream* stream;
+			BdfCompressionState* state;
+			char* input;
+			bool finished;
+
+			/**
+			 * Reads the next chunk of compressed data into input.
+			 * @return false if the end of the stream was reached.
+			 * @internal
+			 */
+			bool fill();
+		};
+
+		/**
+		 * Class that compresses data in chunks and writes it to an output stream.
+		 * @since 2.0.0
+		 */
+		class Compressor
+		{
+		public:
+			/**
+			 * Creates a compressor which will write compressed data to stream.
+			 * @param stream the stream to write compressed data to.
+			 * @param codec the codec to compress with, or AUTO to use the fastest one available.
+			 * @param level the compression level, or -1 to use the codec's default level.
+			 * @throw std::runtime_error if codec is not supported.
+			 */
+			explicit Compressor(std::ostream &stream, Codec codec = Codec::AUTO, int level = -1);
+
+			/**
+			 * Deleted (no copy constructor).
+			 */
+			Compressor(const Compressor&) = delete;
+
+			/**
+			 * Destroys the compressor. finish() must be called first, otherwise the output will be incomplete.
+			 */
+			virtual ~Compressor();
+
+			/**
+			 * Compresses size bytes from data, writing any compressed output to the stream.
+			 * @param data the data to compress.
+			 * @param size the number of bytes to compress.
+			 */
+			void write(const char* data, size_t size);
+
+			/**
+			 * Flushes all remaining compressed data and ends the compressed stream.
+			 */
+			void finish();
+
+		private:
+			std::ostream* stream;
+			BdfCompressionState* state;
+			char* output;
+			bool finished;
+		};
+	};
+}
+
+#endif
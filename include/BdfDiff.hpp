@@ -0,0 +1,168 @@
+
+#ifndef BDFDIFF_HPP_
+#define BDFDIFF_HPP_
+
+#include "Bdf.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Bdf
+{
+	/**
+	 * Class that represents a patch: the changes that turn one BDF document into another.
+	 *
+	 * A patch is a list of changes applied in order, each of which sets, removes or inserts the object at a path of
+	 * named list keys and list indicies, like the paths compiled by BdfPath. Patches are usually much smaller than the
+	 * documents they change, so they can be serialised and sent to every copy of a document instead of the document.
+	 *
+	 * Subtrees are compared by BdfObject::hash() while diffing, so only the parts of the documents that differ are
+	 * visited, and hashes cached by an earlier diff of a document that hasn't changed since are reused.
+	 * @since 2.0.0
+	 */
+	class BdfDiff
+	{
+	public:
+		/**
+		 * Enumeration type representing what a change does to the object at its path.
+		 */
+		enum Operation: uint8_t {
+			/**
+			 * Replaces the object at the path, or adds it to its named list if the key doesn't exist yet.
+			 * An empty path replaces the root object.
+			 */
+			SET,
+
+			/**
+			 * Removes the object at the path from its named list or list.
+			 */
+			REMOVE,
+
+			/**
+			 * Inserts an object into a list before the index the path ends with, or adds it to the end of the list
+			 * if the index is the size of the list.
+			 */
+			INSERT,
+		};
+
+		/**
+		 * Deleted (no copy constructor).
+		 */
+		BdfDiff(const BdfDiff&) = delete;
+
+		/**
+		 * Works out the changes that turn from into to.
+		 * Neither object is changed, but the hashes of both are worked out and cached. Subtrees with the same hash
+		 * are treated as equal without comparing their content.
+		 * @param from the object the patch will be applied to.
+		 * @param to the object that applying the patch to from gives.
+		 */
+		BdfDiff(const BdfObject* from, const BdfObject* to);
+
+		/**
+		 * Works out the changes that turn the object of from into the object of to.
+		 * @param from the reader the patch will be applied to.
+		 * @param to the reader that applying the patch to from gives.
+		 */
+		BdfDiff(BdfReader* from, BdfReader* to);
+
+		/**
+		 * Reads a patch serialised by serialize().
+		 * @param data the serialised patch.
+		 * @param size the size of data in bytes.
+		 * @throw BdfError if the size tags in data do not match size.
+		 * @throw std::invalid_argument if data is BDF data, but not a patch.
+		 */
+		BdfDiff(const char* data, int size);
+
+		/**
+		 * Gets the number of changes in the patch.
+		 * @return the number of changes, which is 0 if both documents were equal.
+		 */
+		size_t size() const noexcept;
+
+		/**
+		 * Applies every change in the patch to root, in order.
+		 * @param root the object to change, which should be equal to the object the patch was worked out from.
+		 * @throw std::out_of_range if a path in the patch doesn't exist in root. The changes before it stay applied.
+		 */
+		void apply(BdfObject* root) const;
+
+		/**
+		 * Applies every change in the patch to the object of reader, in order.
+		 * @param reader the reader to change.
+		 * @throw std::out_of_range if a path in the patch doesn't exist in the reader.
+		 */
+		void apply(BdfReader* reader) const;
+
+		/**
+		 * Serialises the patch as binary BDF data.
+		 * @param pData the location to store the pointer to the data in, which must be deleted with delete[].
+		 * @param pSize the location to store the size of the data in.
+		 */
+		void serialize(char** pData, int* pSize);
+
+		/**
+		 * Serialises the patch as binary BDF data, using the encodings chosen in options.
+		 * @param pData the location to store the pointer to the data in, which must be deleted with delete[].
+		 * @param pSize the location to store the size of the data in.
+		 * @param options the encodings to use.
+		 */
+		void serialize(char** pData, int* pSize, const BdfSerializeOptions &options);
+
+		/**
+		 * Serialises the patch as human-readable BDF data, with one named list per change.
+		 * @param stream the stream to write to.
+		 * @param indent settings used for indenting the human-readable BDF data.
+		 */
+		void serializeHumanReadable(std::ostream &stream, const BdfIndent &indent);
+
+	private:
+		/**
+		 * The changes, stored as a list of named lists with an operation, a path and a value.
+		 */
+		BdfReader changes;
+		BdfList* list;
+
+		int operationKey;
+		int pathKey;
+		int valueKey;
+
+		/**
+		 * The locations in changes of the keys copied into it while diffing.
+		 */
+		std::vector<int> copiedKeys;
+
+		void initChanges();
+
+		/**
+		 * Adds the changes that turn from into to, where both are found at path.
+		 * @internal
+		 */
+		void diff(std::vector<BdfPath::Step> &path, const BdfObject* from, const BdfObject* to);
+		void diffLists(std::vector<BdfPath::Step> &path, const BdfList* from, const BdfList* to);
+		void diffNamedLists(std::vector<BdfPath::Step> &path, const BdfNamedList* from, const BdfNamedList* to);
+		void addChange(Operation operation, const std::vector<BdfPath::Step> &path, const BdfObject* value);
+
+		/**
+		 * Applies a single change to root.
+		 * @internal
+		 */
+		void applyChange(BdfObject* root, BdfNamedList* change, std::vector<int> &keys) const;
+
+		/**
+		 * Gets the object at key in a change, or nullptr if the change doesn't have it.
+		 * @internal
+		 */
+		BdfObject* getChangeField(BdfNamedList* change, int key) const noexcept;
+
+		/**
+		 * Copies object and everything in it into a new object using lookupTable.
+		 * @param keys the locations in lookupTable of the keys of object's lookup table, or -1 if not copied yet.
+		 * @internal
+		 */
+		static BdfObject* copyObject(const BdfObject* object, BdfLookupTable* lookupTable, std::vector<int> &keys);
+	};
+}
+
+#endif
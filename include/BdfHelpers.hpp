@@ -4,6 +4,26 @@
 
 #include <string>
 #include <cstdint>
+#include <chrono>
+#include "BdfStats.hpp"
+
+/*
+ * Records statistics in a BdfStats, but only when the library is built with BDF_STATS,
+ * so they cost nothing otherwise. stats is a pointer to the BdfStats to update.
+ */
+#ifdef BDF_STATS
+#define BDF_STATS_ADD(stats, field, n) ((stats)->field += (n))
+#define BDF_STATS_ALLOC(stats, bytes) ((stats)->allocations += 1, (stats)->allocatedBytes += (bytes))
+#define BDF_STATS_NODE(stats, type) BdfHelpers::StatsNode stats_node(stats, type)
+#define BDF_STATS_TIMER(timer) std::chrono::steady_clock::time_point timer = std::chrono::steady_clock::now()
+#define BDF_STATS_LAP(stats, field, timer) BdfHelpers::addStatsTime(&(stats)->field, &(timer))
+#else
+#define BDF_STATS_ADD(stats, field, n) ((void)0)
+#define BDF_STATS_ALLOC(stats, bytes) ((void)0)
+#define BDF_STATS_NODE(stats, type) ((void)0)
+#define BDF_STATS_TIMER(timer) ((void)0)
+#define BDF_STATS_LAP(stats, field, timer) ((void)0)
+#endif
 
 namespace BdfHelpers
 {
@@ -26,6 +46,56 @@ namespace BdfHelpers
 	uint16_t get_netus(const char* data);
 	float get_netf(const char* data);
 	double get_netd(const char* data);
+
+	int varintSize(uint64_t num);
+	int put_varint(char* data, uint64_t num);
+
+	/*
+	 * Reads a varint from at most size bytes of data into num.
+	 * Returns the number of bytes read, or -1 if the varint is truncated or too long.
+	 */
+	int get_varint(const char* data, int size, uint64_t* num);
+
+	/*
+	 * Hashes size bytes of data, starting from seed. The result doesn't depend on the platform,
+	 * so hashes can be compared between documents and processes.
+	 */
+	uint64_t hash_bytes(const char* data, size_t size, uint64_t seed);
+
+	/*
+	 * Mixes the bits of h, so that values that differ by a single bit give unrelated hashes.
+	 */
+	uint64_t hash_mix(uint64_t h);
+
+	/*
+	 * Adds the time since *timer to *total in nanoseconds, and restarts *timer.
+	 */
+	void addStatsTime(uint64_t* total, std::chrono::steady_clock::time_point* timer);
+
+#ifdef BDF_STATS
+	/*
+	 * Records the depth of a node being parsed, and counts it by the type it ends up with once it goes out of scope.
+	 */
+	class StatsNode
+	{
+		Bdf::BdfStats* stats;
+		const char* type;
+
+	public:
+		StatsNode(Bdf::BdfStats* pStats, const char* pType) : stats(pStats), type(pType) {
+			stats->enter();
+		}
+
+		~StatsNode()
+		{
+			stats->leave();
+
+			if(*type >= 0 && *type <= Bdf::BdfTypes::ARRAY_FLOAT) {
+				stats->nodes[(int)*type] += 1;
+			}
+		}
+	};
+#endif
 }
 
 #endif
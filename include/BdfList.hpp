@@ -23,6 +23,11 @@ namespace Bdf
 	 */
 	class BdfList
 	{		
+		friend class BdfPath;
+		friend class BdfColumns;
+		friend class BdfDiff;
+		friend class BdfObject;
+
 	private:
 		class Item;
 		class ItemIterator;
@@ -130,6 +135,17 @@ namespace Bdf
 		Item* endItem;
 		Item** endptr;
 		BdfLookupTable* lookupTable;
+
+		/**
+		 * The object holding the list, or nullptr if it hasn't been given to one yet.
+		 */
+		BdfObject* owner;
+
+		/**
+		 * The columnar form of the list chosen by serializeSeeker(), or nullptr if it is stored as rows.
+		 * @internal
+		 */
+		mutable BdfColumns* columns;
 				
 		/**
 		 * Inserts a new object after the item given in item.
@@ -149,6 +165,16 @@ namespace Bdf
 		 * @internal
 		 */
 		BdfList* remove(Item* item) noexcept;
+
+		/**
+		 * Removes every item, like clear() but without unsharing the list first.
+		 */
+		void clearItems() noexcept;
+
+		/**
+		 * Sets the list as the one holding o in the document, for BdfObject::unshare().
+		 */
+		void adopt(BdfObject* o) noexcept;
 				
 		/**
 		 * Pops the item given at item; unlike remove(), the object's pointer is released and returned.
@@ -211,6 +237,56 @@ namespace Bdf
 		 * @internal
 		 */
 		int serialize(char *data, int* locations) const;
+
+		/**
+		 * Gets the total size of the payloads in the list that the vectored serialisation in progress leaves out.
+		 * @internal
+		 */
+		int getGatheredSize() const noexcept;
+
+		/**
+		 * Checks if the last call to serializeSeeker() chose to store the list as columns.
+		 * @internal
+		 */
+		bool serializesAsColumns() const noexcept;
+
+		/**
+		 * Gets the memory owned by the BdfList, its items and every object in it.
+		 * @return the bytes owned, by category.
+		 * @since 2.0.0
+		 */
+		BdfMemoryUsage memoryUsage() const;
+
+		/**
+		 * Gets a hash of every object in the list, in order. Used by BdfObject::hash().
+		 * @return the hash.
+		 * @since 2.0.0
+		 */
+		uint64_t hash() const noexcept;
+
+		/**
+		 * Creates a list holding the same objects as this one, each shared by both lists until it's changed.
+		 * Used by BdfObject::unshare().
+		 * @return the new list.
+		 * @internal
+		 */
+		BdfList* shallowCopy() const;
+
+		/**
+		 * Makes sure the list can be changed without changing any copies of its reader, like
+		 * BdfObject::unshare(). Every method that changes the list calls this first.
+		 * @return the list to change, which is a copy of this one if it was shared.
+		 * @throw std::logic_error if the list is only held by copies of the reader.
+		 * @internal
+		 */
+		BdfList* unshare();
+
+		/**
+		 * Finds where the list holds object.
+		 * @return the location of object in its item, or nullptr if the list doesn't hold it.
+		 * @internal
+		 */
+		BdfObject** findSlot(const BdfObject* object) const noexcept;
 		
 		/**
 		 * Adds the BdfObject at o to the back of the BdfList.
@@ -258,7 +334,7 @@ namespace Bdf
 		 * Clear all items in the list. this->size() == 0 after calling.
 		 * @return the BdfList, now emptied of all objects.
 		 */
-		BdfList* clear() noexcept;
+		BdfList* clear();
 		
 		BdfObject* getStart() noexcept;
 		const BdfObject* getStart() const noexcept;
@@ -290,7 +366,7 @@ namespace Bdf
 		 * @param id the ID that this function will attempt to find.
 		 * @return the BdfList, now with the BdfObject located at id removed.
 		 * @throw std::out_of_range if id is larger than this->size().
-		 * @note This function is potentially throwing, unlike the overload that takes a BdfObject.
+		 * @note Unlike the overload that takes a BdfObject, this throws if id isn't in the list.
 		 */
 		BdfList* remove(int id);
 		
@@ -300,7 +376,7 @@ namespace Bdf
 		 * @return the BdfList, now with the BdfObject located at object removed if it ever existed.
 		 * @since 1.0
 		 */
-		BdfList* remove(BdfObject* object) noexcept;
+		BdfList* remove(BdfObject* object);
 		
 		/**
 		 * Replace the BdfObject located at id with object.
@@ -356,6 +432,8 @@ namespace Bdf
 		
 		/**
 		 * Find the specified BdfObject in the list.
+		 * Objects are compared by BdfObject::hash() first, which is cached, so only objects that are very likely equal
+		 * to needle are compared in full, and searching again before the document changes only compares hashes.
 		 * @param needle the object to search for.
 		 * @return an iterator to the first object which compares (**it == *needle), or equivalent to end() if no such iterator was found.
 		 */
@@ -363,6 +441,7 @@ namespace Bdf
 		
 		/**
 		 * Find the specified BdfObject in the list.
+		 * Objects are compared by BdfObject::hash() first, like find().
 		 * @param needle the object to search for.
 		 * @return the index to the first object which compares (**it == *needle), or std::nullopt if no such iterator was found.
 		 */
@@ -385,7 +464,8 @@ namespace Bdf
 		std::partial_ordering operator<=>(const BdfList& rhs) const noexcept;
 		
 		/**
-		 * Returns true if operator<=> returns std::partial_ordering::equal.
+		 * Returns true if both lists hold equal objects in the same order, which is when operator<=> returns
+		 * std::partial_ordering::equivalent. Objects are compared with BdfObject::operator==, so cached hashes are used.
 		 * @since 2.0.0
 		 * @param rhs the right hand side value of the comparison. this is automatically treated as the lhs.
 		 * @return bool that represents the outcome of the equality comparison.
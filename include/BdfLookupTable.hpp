@@ -3,9 +3,16 @@
 #define BDFLOOKUPTABLE_HPP_
 
 #include "Bdf.hpp"
+#include "BdfSerializeOptions.hpp"
+#include "BdfMemoryUsage.hpp"
+#include "BdfPool.hpp"
 #include <iostream>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
 
 namespace Bdf
 {
@@ -30,23 +37,330 @@ namespace Bdf
 		Item** keys_endp;
 		Item** keys_mapped;
 		unsigned int keys_size_mapped;
+		unsigned int keys_capacity_mapped;
 		unsigned int keys_size;
 
-		BdfReader* reader;
+		/**
+		 * Keys removed by clear(), kept with their string buffers to be reused for the next keys added.
+		 */
+		Item* keys_free;
+
+		/**
+		 * The number of named list items using each key, by location. Keys past the end have no items.
+		 */
+		std::vector<int> key_uses;
+
+		/**
+		 * The number of keys used by at least one named list item.
+		 */
+		unsigned int keys_live;
+
+		/**
+		 * The readers sharing the lookup table. The first one counts the allocations made through stats.
+		 */
+		std::vector<BdfReader*> readers;
+
+		/**
+		 * The size of readers, which copies check from other threads without locking mutex.
+		 */
+		std::atomic<size_t> shares;
+
+		/**
+		 * Guards readers, retired and the keys added while the lookup table is shared, since copies of the
+		 * reader can be read and deleted on other threads.
+		 */
+		mutable std::mutex mutex;
+
+		/**
+		 * The documents of copies deleted while the lookup table was shared, given back to the pool by the
+		 * reader changing the document so the pool is only used from its thread.
+		 */
+		std::vector<BdfObject*> retired;
+		std::atomic<size_t> retired_size;
+
+		/**
+		 * Subclass that counts the uses of a string value while serialising.
+		 * @internal
+		 */
+		class StringUse
+		{
+		public:
+			int uses;
+			int first;
+			int location;
+		};
+
+		std::vector<std::string> strings;
+		std::unordered_map<std::string_view, StringUse> strings_used;
+		std::vector<std::string_view> strings_mapped;
+
+		/**
+		 * Memory reused by every serialisation, for counting the uses of each key and ordering them.
+		 */
+		std::vector<int> serialize_uses;
+		std::vector<int> serialize_keys;
 
 		void remapKeys();
+
+		/**
+		 * Gets an item for a new key, reusing one removed by clear() if there is one.
+		 */
+		Item* newKey(const char* key, size_t size);
+
+		/**
+		 * Reads the keys of a serialised lookup table, adding them to the end of the table.
+		 */
+		void readKeys(const char* data, int size);
 	
 	public:
+		/**
+		 * The options used by the serialisation in progress, set by BdfReader::serialize().
+		 * @internal
+		 */
+		BdfSerializeOptions serializeOptions;
+
+		/**
+		 * The reader whose document can be changed, or nullptr once it stops using the lookup table.
+		 * Copies of it share the lookup table, but only read their documents.
+		 * @internal
+		 */
+		BdfReader* writer;
+
+		/**
+		 * The counters of the reader that owns the lookup table, updated when the library is built with BDF_STATS.
+		 * @internal
+		 */
+		BdfStats* stats;
+
+		/**
+		 * Incremented whenever an object, list or named list using the lookup table changes,
+		 * which invalidates every hash cached by BdfObject::hash().
+		 * @internal
+		 */
+		std::atomic<uint64_t> generation;
+
+		/**
+		 * The memory of the objects, lists, named lists, items and payloads using the lookup table
+		 * once they are deleted, kept to be reused by new ones.
+		 * @internal
+		 */
+		BdfPool pool;
+
+		/**
+		 * Identifies the keys of the lookup table, so key locations found before it changes can't be used. Set
+		 * from a counter shared by every lookup table when it's constructed and whenever clear() removes every
+		 * key or compact() renumbers them, so no two lookup tables ever have the same one, even at the same
+		 * address.
+		 * @internal
+		 */
+		uint64_t keysId;
+
+		/**
+		 * Gets an id for keysId that no lookup table has had before.
+		 * @internal
+		 */
+		static uint64_t newKeysId() noexcept;
+
+		/**
+		 * The first of every named list using the lookup table, linked through the named lists.
+		 * @internal
+		 */
+		BdfNamedList* namedLists;
+
+		/**
+		 * The fewest unused keys that make compaction due, so small tables aren't compacted over and over.
+		 * @internal
+		 */
+		static const unsigned int COMPACT_MIN_KEYS = 64;
+
+		/**
+		 * Incremented whenever the objects using the lookup table are measured for serialising or copied by
+		 * BdfObject::unshare(), either of which loses the sizes kept in them by the last pass.
+		 * @internal
+		 */
+		std::atomic<uint64_t> seekGeneration;
+
+		/**
+		 * Subclass that records a payload left out of the data by a vectored serialisation, which belongs
+		 * at the position at in the data and is still stored at data.
+		 * @internal
+		 */
+		class Gathered
+		{
+		public:
+			const char* at;
+			const char* data;
+			int size;
+		};
+
+		/**
+		 * The payloads left out of the data by the vectored serialisation in progress, or nullptr if payloads
+		 * are copied into the data. Set by BdfReader::serializeVectored(), along with the smallest payload size
+		 * left out.
+		 * @internal
+		 */
+		std::vector<Gathered>* gathered;
+		int gatherThreshold;
+
 		BdfLookupTable(BdfReader* reader);
 		BdfLookupTable(BdfReader* reader, const char* data, int size);
 		virtual ~BdfLookupTable();
-		unsigned int getLocation(std::string id);
-		std::string getName(unsigned int id);
+		unsigned int getLocation(std::string_view key);
+
+		/**
+		 * Finds the location of key without adding it to the table.
+		 * @return the location of key, or -1 if key is not in the table.
+		 * @since 2.0.0
+		 */
+		int findLocation(std::string_view key) const noexcept;
+
+		/**
+		 * Gets the name of the key at location id.
+		 * @return the name, or an empty string if id is not in the table. Valid until the table changes.
+		 */
+		const std::string& getName(unsigned int id);
 		int serialize(char* database, int* locations, int locations_size);
 		int serializeSeeker(int* locations, int locations_size);
-		void serializeGetLocations(int* locations);
+		void serializeGetLocations(int* locations, BdfObject* root);
 		bool hasKeyLocation(unsigned int key);
-		int size();
+		int size() const;
+
+		/**
+		 * Counts a named list item added with key, so the keys in use are known without walking the objects.
+		 * @internal
+		 */
+		void addKeyUse(int key);
+
+		/**
+		 * Stops counting a named list item with key, once it is deleted.
+		 * @internal
+		 */
+		void removeKeyUse(int key) noexcept;
+
+		/**
+		 * Removes every key no named list item uses and renumbers the rest in order, updating the items of
+		 * every named list using the lookup table, including ones not in any document. Takes time proportional
+		 * to the keys and items. Does nothing while the lookup table is shared, since copies of the reader may
+		 * be read from other threads.
+		 * @return the number of keys removed.
+		 * @internal
+		 */
+		int compact();
+
+		/**
+		 * Checks if the unused keys are at least as many as the used ones and at least COMPACT_MIN_KEYS, and the
+		 * lookup table isn't shared.
+		 * The table then never holds much more than twice the keys in use, and every compaction removes at
+		 * least half of the keys it goes through.
+		 * @internal
+		 */
+		bool isCompactDue() const noexcept;
+
+		/**
+		 * Checks if any named list using the lookup table might not be in the document under root, such as one
+		 * that was never added or whose object was removed but is still held. Their items are counted in key_uses
+		 * too. May also return true for deep documents that would take longer to check than to walk.
+		 * @internal
+		 */
+		bool hasDetachedNamedLists(const BdfObject* root) const noexcept;
+
+		/**
+		 * Adds reader to the readers sharing the lookup table, when a reader is copied.
+		 * @internal
+		 */
+		void share(BdfReader* reader);
+
+		/**
+		 * Removes reader from the readers sharing lookupTable, deleting it once no reader uses it, and releases
+		 * document, the root object of reader. Documents of copies still sharing the lookup table with the
+		 * reader changing the document are kept until freeRetired(), so copies can be deleted on other threads.
+		 * @internal
+		 */
+		static void release(BdfLookupTable* lookupTable, BdfReader* reader, BdfObject* document = nullptr) noexcept;
+
+		/**
+		 * Releases the documents of the copies deleted since the last call. Must only be called on the
+		 * thread changing the document.
+		 * @internal
+		 */
+		void freeRetired() noexcept;
+
+		/**
+		 * Checks if any deleted copies have documents left for freeRetired().
+		 * @internal
+		 */
+		bool hasRetired() const noexcept;
+
+		/**
+		 * Checks if more than one reader uses the lookup table.
+		 * @internal
+		 */
+		bool isShared() const noexcept;
+
+		/**
+		 * Removes every key and string from the lookup table, keeping their memory to be reused.
+		 * Must only be called once nothing uses the lookup table.
+		 * @internal
+		 */
+		void clear() noexcept;
+
+		/**
+		 * Clears the lookup table and reads the keys of a serialised lookup table into it, like
+		 * constructing a new lookup table from data but reusing the memory of this one.
+		 * @internal
+		 */
+		void load(const char* data, int size);
+
+		/**
+		 * Frees the memory kept in the pool and the keys kept by clear().
+		 * @internal
+		 */
+		void trim() noexcept;
+
+		/**
+		 * Gets the memory owned by the lookup table, its keys and the strings read from the string table.
+		 * @return the bytes owned, by category.
+		 * @since 2.0.0
+		 */
+		BdfMemoryUsage memoryUsage() const;
+
+		/**
+		 * Reads the string table stored after the lookup table in binary data.
+		 * @internal
+		 */
+		void readStrings(const char* data, int size);
+
+		/**
+		 * Gets the string at location in the string table read by readStrings().
+		 * Every reference to the location shares the returned string.
+		 * @return the string, or nullptr if location is not in the table.
+		 * @internal
+		 */
+		const std::string* getString(unsigned int location) const noexcept;
+
+		/**
+		 * Counts a use of the string value v while getting locations for serialising.
+		 * @internal
+		 */
+		void countString(const std::string &v);
+
+		/**
+		 * Gets the location of v in the string table being serialised.
+		 * @return the location of v, or -1 if v is stored in full.
+		 * @internal
+		 */
+		int getStringLocation(const std::string &v) const;
+
+		/**
+		 * @internal
+		 */
+		int serializeStringsSeeker() const;
+
+		/**
+		 * Serialises the string table to data, then forgets the strings counted.
+		 * @internal
+		 */
+		int serializeStrings(char* data);
 	};
 }
 
@@ -0,0 +1,84 @@
+
+#ifndef BDFMEMORYUSAGE_HPP_
+#define BDFMEMORYUSAGE_HPP_
+
+#include <cstdint>
+#include <string>
+
+namespace Bdf
+{
+	/**
+	 * Class holding the memory owned by a document or part of one, returned by the memoryUsage() methods.
+	 *
+	 * Each category holds the bytes requested from the allocator, so the overhead of the allocator
+	 * itself isn't included. Strings stored inside a std::string without a heap allocation are only
+	 * counted as the size of the std::string.
+	 * @newable
+	 * @since 2.0.0
+	 */
+	class BdfMemoryUsage
+	{
+	public:
+		/**
+		 * The bytes used by BdfObject, BdfList, BdfNamedList, BdfLookupTable and BdfReader instances.
+		 */
+		uint64_t nodes;
+
+		/**
+		 * The bytes used by the items linking objects into lists and named lists.
+		 */
+		uint64_t items;
+
+		/**
+		 * The bytes used by the data of primitives and arrays.
+		 */
+		uint64_t payloads;
+
+		/**
+		 * The bytes used by string values, including the strings shared through the string table.
+		 */
+		uint64_t strings;
+
+		/**
+		 * The bytes used by the keys in the lookup table.
+		 */
+		uint64_t keys;
+
+		/**
+		 * The bytes kept by the lookup table after objects and keys were deleted, to be reused by new ones.
+		 */
+		uint64_t pooled;
+
+		/**
+		 * Creates a memory usage with every category set to zero.
+		 */
+		BdfMemoryUsage();
+
+		/**
+		 * Gets the total of every category.
+		 * @return the total bytes owned.
+		 */
+		uint64_t total() const noexcept;
+
+		/**
+		 * Adds every category of other to this memory usage.
+		 * @param other the memory usage to add.
+		 * @return this memory usage.
+		 */
+		BdfMemoryUsage& operator+=(const BdfMemoryUsage &other) noexcept;
+
+		/**
+		 * Formats the categories and the total as text on one line.
+		 * @return the memory usage as text.
+		 */
+		std::string toString() const;
+
+		/**
+		 * Gets the bytes owned by str, including its heap buffer if it has one.
+		 * @internal
+		 */
+		static uint64_t getStringSize(const std::string &str) noexcept;
+	};
+}
+
+#endif
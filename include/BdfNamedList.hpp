@@ -6,12 +6,19 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <string_view>
 
 namespace Bdf
 {
 	
 	class BdfNamedList
 	{
+		friend class BdfPath;
+		friend class BdfColumns;
+		friend class BdfDiff;
+		friend class BdfLookupTable;
+		friend class BdfObject;
+
 	private:
 	
 		class Item;
@@ -32,6 +39,33 @@ namespace Bdf
 
 		BdfLookupTable* lookupTable;
 
+		/**
+		 * The object holding the named list, or nullptr if it hasn't been given to one yet.
+		 */
+		BdfObject* owner;
+
+		/**
+		 * The named lists before and after this one in the list of every named list using the lookup table.
+		 */
+		BdfNamedList* table_prev;
+		BdfNamedList* table_next;
+
+		/**
+		 * Adds the named list to the named lists using the lookup table, so BdfLookupTable::compact() can renumber its keys.
+		 */
+		void link() noexcept;
+		void unlink() noexcept;
+
+		/**
+		 * Removes every item, like clear() but without unsharing the named list first.
+		 */
+		void clearItems() noexcept;
+
+		/**
+		 * Sets the named list as the one holding object in the document, for BdfObject::unshare().
+		 */
+		void adopt(BdfObject* object) noexcept;
+
 	public:
 	    /**
 		 * Deleted (no copy constructor).
@@ -62,6 +96,12 @@ namespace Bdf
 		 * @since 1.0
 		 */	
 		int serialize(char *data, int* locations) const;
+
+		/**
+		 * Gets the total size of the payloads in the named list that the vectored serialisation in progress leaves out.
+		 * @internal
+		 */
+		int getGatheredSize() const noexcept;
 		
 		/**
 		 * Serialises the named list to &stream.
@@ -75,7 +115,56 @@ namespace Bdf
 		 * @return the BdfNamedList, now with all elements removed.
 		 * @since 1.4.0
 		 */
-		BdfNamedList* clear() noexcept;
+		BdfNamedList* clear();
+
+		/**
+		 * Gets the memory owned by the BdfNamedList, its items and every object in it.
+		 * Keys are owned by the lookup table, so they aren't included.
+		 * @return the bytes owned, by category.
+		 * @since 2.0.0
+		 */
+		BdfMemoryUsage memoryUsage() const;
+
+		/**
+		 * Gets a hash of every key and object in the named list. Keys are hashed by name and the items are
+		 * combined in a way that doesn't depend on their order. Used by BdfObject::hash().
+		 * @return the hash.
+		 * @since 2.0.0
+		 */
+		uint64_t hash() const noexcept;
+
+		/**
+		 * Creates a named list holding the same objects at the same keys as this one, each shared by both named
+		 * lists until it's changed. Used by BdfObject::unshare().
+		 * @return the new named list.
+		 * @internal
+		 */
+		BdfNamedList* shallowCopy() const;
+
+		/**
+		 * Makes sure the named list can be changed without changing any copies of its reader, like
+		 * BdfObject::unshare(). Every method that changes the named list calls this first.
+		 * @return the named list to change, which is a copy of this one if it was shared.
+		 * @throw std::logic_error if the named list is only held by copies of the reader.
+		 * @internal
+		 */
+		BdfNamedList* unshare();
+
+		/**
+		 * Finds where the named list holds object.
+		 * @return the location of object in its item, or nullptr if the named list doesn't hold it.
+		 * @internal
+		 */
+		BdfObject** findSlot(const BdfObject* object) const noexcept;
+
+		/**
+		 * Checks if both named lists hold equal objects at the same keys, in any order.
+		 * Keys are compared by name if the named lists use different lookup tables.
+		 * @param rhs the named list to compare with.
+		 * @return true if the named lists are equal.
+		 * @since 2.0.0
+		 */
+		bool operator==(const BdfNamedList &rhs) const noexcept;
 		
 		/**
 		 * Gets the item located at key. If it does not exist, creates it.
@@ -86,13 +175,20 @@ namespace Bdf
 		 * @since 1.0
 		 */	
 		BdfObject* get(int key);
-		BdfObject* get(std::string key);
-		BdfNamedList* set(std::string key, BdfObject* value);
+		BdfObject* get(std::string_view key);
+		BdfNamedList* set(std::string_view key, BdfObject* value);
 		BdfNamedList* set(int key, BdfObject* value);
-		BdfObject* remove(std::string key);
+		BdfObject* remove(std::string_view key);
 		BdfObject* remove(int key);
+
+		/**
+		 * Gets the locations of the keys in the named list.
+		 * Locations change when unused keys are removed from the lookup table by BdfReader::compactKeys(), or by
+		 * serialising with BdfSerializeOptions::compactKeys set.
+		 * @since 1.0
+		 */
 		std::vector<int> keys();
-		bool exists(std::string key);
+		bool exists(std::string_view key);
 		bool exists(int key);
 	};
 }
@@ -5,21 +5,119 @@
 #include "Bdf.hpp"
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <cstdint>
+#include <functional>
+#include <atomic>
+
+#if __cplusplus >= 202002L
+	#include <compare>
+	#include <span>
+#endif
 
 namespace Bdf
 {
+	/**
+	 * A value in a document: a primitive, an array, a string, a list or a named list.
+	 *
+	 * After a reader is copied, the objects on the way to a change are copied. Copying starts at the first
+	 * change after the reader is copied. The methods that change objects, lists and named lists return the
+	 * one changed, which is then a new object. A pointer got before the change still points to the old
+	 * object, which only copies of the reader hold now. It shows their version and can't be changed, so keep
+	 * the pointers the setters return, or get the object from the reader again:
+	 *
+	 * @code
+	 * BdfObject* version = reader.getObject()->getNamedList()->get("version");
+	 * BdfReader snapshot(reader);
+	 *
+	 * // Without reassigning, version would still point to the snapshot's object, and changing it would throw
+	 * version = version->setInteger(2);
+	 * @endcode
+	 */
 	class BdfObject
 	{
+		friend class BdfPath;
+		friend class BdfColumns;
+		friend class BdfDiff;
+		friend class BdfList;
+		friend class BdfNamedList;
+		friend class BdfLookupTable;
+
 	private:
 	
 		BdfLookupTable* lookupTable;
 		int last_seek;
+		char last_seek_type;
 		void *object;
 		char type;
+		bool interned;
 		char *data;
 		int s;
+
+		/**
+		 * The bytes allocated for data, which is more than s once an array has been appended to or reserved.
+		 */
+		int data_capacity;
+
+		mutable uint64_t hash_value;
+		mutable uint64_t hash_generation;
+
+		/**
+		 * The number of lists, named lists and readers holding the object. Objects are only held more than once
+		 * after a reader is copied, until they are unshared to be changed. Copies of a reader can be read from
+		 * other threads while the reader is changed, so it's counted atomically.
+		 */
+		std::atomic<int> references;
+
+		/**
+		 * The list or named list holding the object in the document of the reader that can be changed, whose
+		 * type is parent_type, or NULL if the object is a root object or isn't held by a list or named list.
+		 */
+		void* parent;
+		char parent_type;
+
+		/**
+		 * Set once the object is only held by copies of the reader, which can't be changed.
+		 */
+		bool frozen;
 	
 		void freeAll();
+
+		/**
+		 * Gets the object holding the list or named list that holds this object.
+		 * @return the holder, or nullptr if there isn't one.
+		 */
+		BdfObject* getHolder() const noexcept;
+
+		/**
+		 * Copies only the object. Lists and named lists get new items pointing to the same objects.
+		 */
+		BdfObject* shallowCopy() const;
+
+		/**
+		 * Sets the parent of everything in the object to the list or named list holding it and lets it be
+		 * changed again, when a copy of the reader takes the place of the reader that was copied.
+		 */
+		void relink() noexcept;
+
+		/**
+		 * Allocates size bytes for data from the pool of the lookup table and sets data_capacity to size,
+		 * which freeAll() needs to give data back to the pool.
+		 */
+		char* newData(int size);
+
+		/**
+		 * Makes the object an empty array of arrayType if it isn't an array of that type, then adds room for
+		 * count elements of elementSize bytes to the end, doubling the capacity of data when it's full.
+		 * @return the first of the new elements.
+		 */
+		char* appendArray(char arrayType, int elementSize, int count);
+
+		/**
+		 * Gets the element at index in the array of arrayType held by the object.
+		 * @throw std::out_of_range if the object isn't an array of arrayType or index is not in the array.
+		 */
+		char* getArrayElement(char arrayType, int elementSize, int index);
 	
 	public:
 	
@@ -44,6 +142,111 @@ namespace Bdf
 		 */
 		explicit operator bool() const noexcept;
 
+		/**
+		 * Gets the memory owned by the BdfObject and everything in it.
+		 * Strings shared through the string table are owned by the lookup table, so they aren't included.
+		 * @return the bytes owned, by category.
+		 * @since 2.0.0
+		 */
+		BdfMemoryUsage memoryUsage() const;
+
+		/**
+		 * Gets a hash of the type and content of the BdfObject and everything in it.
+		 * Objects that compare equal have the same hash, even if they belong to different readers. Keys are hashed
+		 * by name rather than by their location in the lookup table, and the order of the items in a named list
+		 * doesn't change its hash.
+		 *
+		 * The hash is worked out the first time it's needed, then cached in every object in the tree until something
+		 * using the same lookup table changes, so calling this again on an unchanged document is O(1).
+		 * Like every other method, it must not be called while another thread uses the document.
+		 * @return the hash.
+		 * @since 2.0.0
+		 */
+		uint64_t hash() const noexcept;
+
+		/**
+		 * Checks if two BdfObjects have the same type and content.
+		 * Doubles and floats are compared by their bits, so NaN equals itself and 0.0 doesn't equal -0.0.
+		 * Named lists are equal if they hold equal objects at the same keys, in any order.
+		 * If the hashes of both objects are already cached, objects with different hashes are told apart without
+		 * comparing their content.
+		 * @param rhs the object to compare with.
+		 * @return true if the objects are equal.
+		 * @since 2.0.0
+		 */
+		bool operator==(const BdfObject &rhs) const noexcept;
+
+		#if __cplusplus >= 202002L
+
+		/**
+		 * Compares two BdfObjects.
+		 * Objects of different types are ordered by type. Numbers are ordered by value, strings by their characters,
+		 * and arrays and lists by their first unequal element. Named lists are unordered unless they are equal.
+		 * The result is std::partial_ordering::equivalent exactly when operator== returns true.
+		 * @param rhs the object to compare with.
+		 * @return the ordering of this object relative to rhs.
+		 * @since 2.0.0
+		 */
+		std::partial_ordering operator<=>(const BdfObject &rhs) const noexcept;
+
+		#endif
+
+		/**
+		 * Function object that hashes the object a pointer points to with hash(), for unordered containers of
+		 * BdfObject pointers. Together with PointerEqual, std::unordered_set<BdfObject*, BdfObject::PointerHash,
+		 * BdfObject::PointerEqual> keeps one of each distinct subtree, which can come from any number of readers.
+		 * @since 2.0.0
+		 */
+		class PointerHash
+		{
+		public:
+			size_t operator()(const BdfObject* object) const noexcept;
+		};
+
+		/**
+		 * Function object that compares the objects two pointers point to with operator==.
+		 * @since 2.0.0
+		 */
+		class PointerEqual
+		{
+		public:
+			bool operator()(const BdfObject* lhs, const BdfObject* rhs) const noexcept;
+		};
+
+		/**
+		 * Adds a reference to the object, for a copy of the list, named list or reader holding it.
+		 * @return the object.
+		 * @internal
+		 */
+		BdfObject* share() noexcept;
+
+		/**
+		 * Removes a reference to object, deleting it once nothing holds it.
+		 * Lists, named lists and readers use this instead of delete for the objects they hold.
+		 * @internal
+		 */
+		static void release(BdfObject* object) noexcept;
+
+		/**
+		 * Removes the reference to object held by holder, a list, named list or reader, like release(). If the
+		 * object stays alive after leaving the document that can be changed, only copies of the reader hold
+		 * it from then on.
+		 * @internal
+		 */
+		static void release(BdfObject* object, const void* holder) noexcept;
+
+		/**
+		 * Makes sure the object can be changed without changing any copies of its reader. Every method that
+		 * changes the object calls this first. If a copy of the reader still holds the object or anything on the
+		 * way to it from the root object, those are replaced by copies of themselves in the document of the
+		 * reader that was copied, whose lists and named lists hold the same objects as the originals. So only
+		 * the objects on the way to the change are copied, and the copies of the reader keep the originals.
+		 * @return the object to change, which is a copy of this one if the object was shared.
+		 * @throw std::logic_error if the object is only held by copies of the reader, which can't be changed.
+		 * @internal
+		 */
+		BdfObject* unshare();
+
 		/**
   		 * @internal
      	 */
@@ -55,10 +258,26 @@ namespace Bdf
 		int serializeSeeker(int* locations) const;
 
 		/**
+		 * Serialises the object to data, which must have room for the size worked out by serializeSeeker().
+		 * @return the number of bytes written, which is less than the size if payloads were gathered.
   		 * @internal
      	 */
 		int serialize(char* data, int* locations, unsigned char flags) const;
 
+		/**
+		 * Checks if the vectored serialisation in progress leaves the payload of the object out of the data,
+		 * to be referenced where it's stored instead.
+		 * @internal
+		 */
+		bool isGathered() const noexcept;
+
+		/**
+		 * Gets the total size of the payloads in the object that the vectored serialisation in progress leaves out.
+		 * serializeSeeker() must already have been called.
+		 * @internal
+		 */
+		int getGatheredSize() const noexcept;
+
 		/**
   		 * @internal
          */
@@ -68,10 +287,30 @@ namespace Bdf
   		 * @internal
      	 */
 		static void getFlagData(const char* data, char* type, char* size_bytes, char* parent_flags);
+
+		/**
+		 * Packs type, size_bytes and parent_flags into a flag byte, the inverse of getFlagData().
+		 * @internal
+		 */
+		static unsigned char getFlags(char type, char size_bytes, char parent_flags);
 		static char getSizeBytes(char size_bytes);
+
+		/**
+		 * Gets the size tag needed to store location, like the size tag of a key in a named list.
+		 * @internal
+		 */
+		static char getLocationSizeTag(int location);
 		static int getSize(const char* data);
+
+		/**
+		 * Gets the size of the serialised object at data like getSize(), but checks that the object
+		 * fits within the available bytes first.
+		 * @return the size of the object, or -1 if it does not fit.
+		 * @internal
+		 */
+		static int getCheckedSize(const char* data, int available);
 		
-		int getKeyLocation(std::string key);
+		int getKeyLocation(std::string_view key);
 		std::string getKeyName(int key);
 	
 		BdfObject* newObject();
@@ -103,6 +342,14 @@ namespace Bdf
 	
 		// Objects
 		std::string getString();
+
+		/**
+		 * Gets the string held by the object without copying it, like getString().
+		 * @return a view of the string, valid until the object is changed or deleted.
+		 * @since 2.0.0
+		 */
+		std::string_view getStringView();
+
 		BdfList* getList();
 		BdfNamedList* getNamedList();
 	
@@ -125,12 +372,121 @@ namespace Bdf
 	 	BdfObject* setByteArray(const char *v, int size);
 		BdfObject* setDoubleArray(const double *v, int size);
 		BdfObject* setFloatArray(const float *v, int size);
+
+		// Growable arrays
+
+		/**
+		 * Adds v to the end of the array held by the object. If the object isn't an array of the type of v,
+		 * it's set to an empty one first. The array keeps spare capacity that doubles whenever it runs out,
+		 * so building an array one element at a time takes amortised constant time per element.
+		 * @since 2.0.0
+		 */
+		BdfObject* appendInteger(int32_t v);
+		BdfObject* appendBoolean(bool v);
+		BdfObject* appendLong(int64_t v);
+		BdfObject* appendShort(int16_t v);
+		BdfObject* appendByte(char v);
+		BdfObject* appendDouble(double v);
+		BdfObject* appendFloat(float v);
+
+		/**
+		 * Adds the size elements at v to the end of the array held by the object, like appending them one at
+		 * a time but growing the array at most once.
+		 * @since 2.0.0
+		 */
+		BdfObject* appendRange(const int32_t *v, int size);
+		BdfObject* appendRange(const bool *v, int size);
+		BdfObject* appendRange(const int64_t *v, int size);
+		BdfObject* appendRange(const int16_t *v, int size);
+		BdfObject* appendRange(const char *v, int size);
+		BdfObject* appendRange(const double *v, int size);
+		BdfObject* appendRange(const float *v, int size);
+
+		#if __cplusplus >= 202002L
+
+		BdfObject* appendRange(std::span<const int32_t> v) { return appendRange(v.data(), (int)v.size()); }
+		BdfObject* appendRange(std::span<const bool> v) { return appendRange(v.data(), (int)v.size()); }
+		BdfObject* appendRange(std::span<const int64_t> v) { return appendRange(v.data(), (int)v.size()); }
+		BdfObject* appendRange(std::span<const int16_t> v) { return appendRange(v.data(), (int)v.size()); }
+		BdfObject* appendRange(std::span<const char> v) { return appendRange(v.data(), (int)v.size()); }
+		BdfObject* appendRange(std::span<const double> v) { return appendRange(v.data(), (int)v.size()); }
+		BdfObject* appendRange(std::span<const float> v) { return appendRange(v.data(), (int)v.size()); }
+
+		#endif
+
+		/**
+		 * Makes room for size elements in the array held by the object, so appending until it holds size
+		 * elements doesn't allocate. Does nothing if the object isn't an array.
+		 * @since 2.0.0
+		 */
+		BdfObject* reserve(int size);
+
+		/**
+		 * Gets the number of elements in the array held by the object.
+		 * @return the number of elements, or 0 if the object isn't an array.
+		 * @since 2.0.0
+		 */
+		int getArraySize();
+
+		/**
+		 * Sets the element at index of the array held by the object, without copying the array.
+		 * @throw std::out_of_range if the object isn't an array of the type of v or index is not in the array.
+		 * @since 2.0.0
+		 */
+		BdfObject* setIntegerAt(int index, int32_t v);
+		BdfObject* setBooleanAt(int index, bool v);
+		BdfObject* setLongAt(int index, int64_t v);
+		BdfObject* setShortAt(int index, int16_t v);
+		BdfObject* setByteAt(int index, char v);
+		BdfObject* setDoubleAt(int index, double v);
+		BdfObject* setFloatAt(int index, float v);
+
+		/**
+		 * Gets the element at index of the array held by the object, without copying the array.
+		 * @throw std::out_of_range if the object isn't an array of that type or index is not in the array.
+		 * @since 2.0.0
+		 */
+		int32_t getIntegerAt(int index);
+		bool getBooleanAt(int index);
+		int64_t getLongAt(int index);
+		int16_t getShortAt(int index);
+		char getByteAt(int index);
+		double getDoubleAt(int index);
+		float getFloatAt(int index);
 	
 		// Objects
-		BdfObject* setString(std::string v);
+
+		/**
+		 * Sets the object to a string, taking over the buffer of v.
+		 * @since 1.0
+		 */
+		BdfObject* setString(std::string &&v);
+
+		/**
+		 * Sets the object to a copy of v. If the object already holds a string, its buffer is reused,
+		 * so setting strings no longer than the last one doesn't allocate.
+		 * @since 2.0.0
+		 */
+		BdfObject* setString(std::string_view v);
+		BdfObject* setString(const char* v);
 		BdfObject* setList(BdfList* v);
 		BdfObject* setNamedList(BdfNamedList* v);
 	};
 }
 
+namespace std
+{
+	/**
+	 * Hashes BdfObjects by their content with BdfObject::hash().
+	 * @since 2.0.0
+	 */
+	template<>
+	struct hash<Bdf::BdfObject>
+	{
+		size_t operator()(const Bdf::BdfObject &object) const noexcept {
+			return object.hash();
+		}
+	};
+}
+
 #endif
@@ -0,0 +1,164 @@
+
+#ifndef BDFPATH_HPP_
+#define BDFPATH_HPP_
+
+#include "Bdf.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace Bdf
+{
+	/**
+	 * Class that represents a compiled path expression, used to find a nested object without
+	 * chaining getNamedList()->get() and getList()->get() calls by hand.
+	 *
+	 * A path is made of named list keys separated by dots and list indicies in square brackets,
+	 * for example "a[3].b" or ".sessions[1024].user.name". Keys containing characters other than
+	 * letters, digits, '_' and '-' can be quoted: "a.\"key with spaces\"[0]".
+	 *
+	 * Evaluating a path never modifies the document: missing keys are not created, no keys are added
+	 * to the lookup table and out of range indicies are not thrown. Key names are resolved to ids once
+	 * per lookup table and reused until that lookup table gains new keys.
+	 * @newable
+	 * @since 2.0.0
+	 */
+	class BdfPath
+	{
+		friend class BdfDiff;
+
+	public:
+		/**
+		 * Result of evaluating a path against serialised binary BDF data.
+		 * The result points into the buffer that was evaluated, so it is only valid as long as that buffer is.
+		 */
+		class View
+		{
+		public:
+			/**
+			 * Pointer to the first byte (the flag byte) of the object found, or nullptr if the path was not found.
+			 * If the object found is an element of a typed array, this points at the array instead.
+			 */
+			const char* data;
+
+			/**
+			 * The size of the object found in bytes, including its flag byte and size tag, or of the
+			 * typed array it is in.
+			 */
+			int size;
+
+			/**
+			 * The type of the object found, which can be compared against a type listed in BdfTypes.
+			 * Objects stored in a compact encoding have the encoded type, such as BdfTypes::ARRAY_INTEGER_VARINT
+			 * or BdfTypes::STRING_REF.
+			 */
+			char type;
+
+			/**
+			 * The index of the object found in the typed array at data if it is the value of a row in a
+			 * column of a columnar list (see BdfSerializeOptions::COLUMNAR), or -1 otherwise. Values stored
+			 * in typed arrays have no flag byte, so data and size are those of the array, and type is the
+			 * type of the value, such as BdfTypes::INTEGER.
+			 */
+			int64_t element;
+
+			/**
+			 * Checks if the path was found.
+			 * @return true if data points at an object, false otherwise.
+			 */
+			explicit operator bool() const noexcept;
+		};
+
+		/**
+		 * Compiles the path expression given in path.
+		 * @param path the path expression to compile, for example "a[3].b".
+		 * @return the compiled path.
+		 * @throw std::invalid_argument if path is not a valid path expression.
+		 */
+		static BdfPath compile(const std::string &path);
+
+		/**
+		 * Finds the object located at this path, starting from root.
+		 * @param root the object to start searching from.
+		 * @return a pointer to the object found, or nullptr if any step of the path does not exist or
+		 *         does not have the type required by the path.
+		 */
+		BdfObject* evaluate(BdfObject* root) const;
+
+		/**
+		 * Finds the object located at this path, starting from the object contained in reader.
+		 * @param reader the reader to search.
+		 * @return a pointer to the object found, or nullptr if the path does not exist.
+		 */
+		BdfObject* evaluate(BdfReader* reader) const;
+
+		/**
+		 * Finds the object located at this path inside serialised binary BDF data, as produced by
+		 * BdfReader::serialize(), without parsing it into BdfObjects. Only the bytes along the
+		 * path and the lookup table are read.
+		 * Rows of columnar lists are found by finding the value in the column of the key after the index,
+		 * so a path can go through a row of a columnar list but not end at one.
+		 * @param data the serialised BDF data.
+		 * @param size the size of data in bytes.
+		 * @return a View of the object found, which evaluates to false if the path does not exist or the data is malformed.
+		 */
+		View evaluate(const char* data, int size) const;
+
+		/**
+		 * Gets the number of steps in the path.
+		 * @return the number of keys and indicies in the path.
+		 */
+		size_t size() const noexcept;
+
+		/**
+		 * Converts the path back to a normalised path expression.
+		 * @return a string which compiles to an equivalent path.
+		 */
+		std::string toString() const;
+
+	private:
+		/**
+		 * Subclass that represents a single key or index of the path.
+		 * @internal
+		 */
+		class Step
+		{
+		public:
+			std::string key;
+			uint64_t index;
+			bool isIndex;
+		};
+
+		std::vector<Step> steps;
+
+		/**
+		 * Subclass that holds the location of each key in steps (or -1 for indicies and missing keys) in the
+		 * lookup table whose BdfLookupTable::keysId was keysId, when it had size keys. Lookup tables only gain
+		 * keys until their keysId changes, so the locations stay valid until either changes.
+		 * @internal
+		 */
+		class Resolved
+		{
+		public:
+			std::vector<int> locations;
+			uint64_t keysId;
+			int size;
+		};
+
+		/**
+		 * The last keys resolved. Never changed once set, only replaced, so a path can be evaluated from
+		 * several threads at once.
+		 */
+		mutable std::shared_ptr<const Resolved> resolved;
+
+		/**
+		 * Resolves every key in steps to its location in lookupTable, without adding missing keys.
+		 * @return the locations, reused from the last call if lookupTable has the same keys.
+		 * @internal
+		 */
+		std::shared_ptr<const Resolved> resolve(const BdfLookupTable* lookupTable) const;
+	};
+}
+
+#endif
@@ -0,0 +1,100 @@
+
+#ifndef BDFPOOL_HPP_
+#define BDFPOOL_HPP_
+
+#include "Bdf.hpp"
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace Bdf
+{
+	/**
+	 * Class that keeps the memory of deleted objects, lists, named lists, items and payloads so it can
+	 * be reused for the next ones of the same size, instead of being returned to the allocator.
+	 *
+	 * Every lookup table has a pool, which is kept when the reader owning it loads new data, so
+	 * parsing and building similar documents over and over stops allocating once the pool is warm.
+	 * Blocks are allocated one at a time with ::operator new, so memory from the pool can be deleted
+	 * with delete and memory from new can be given to the pool.
+	 * @internal
+	 * @since 2.0.0
+	 */
+	class BdfPool
+	{
+	public:
+		/**
+		 * Blocks bigger than this are always returned to the allocator.
+		 */
+		static const size_t MAX_SIZE = 256;
+
+		BdfPool() noexcept;
+		~BdfPool();
+
+		BdfPool(const BdfPool&) = delete;
+		BdfPool& operator=(const BdfPool&) = delete;
+
+		/**
+		 * Gets a block of size bytes, reusing a block of the same size if there is one.
+		 * @throw std::bad_alloc if there is no memory left.
+		 */
+		void* allocate(size_t size);
+
+		/**
+		 * Gives back a block got from allocate() with the same size, to be reused.
+		 */
+		void deallocate(void* block, size_t size) noexcept;
+
+		/**
+		 * Constructs a T in a block from the pool.
+		 */
+		template<typename T, typename... Args> T* create(Args&&... args)
+		{
+			void* block = allocate(sizeof(T));
+
+			try {
+				return new(block) T(std::forward<Args>(args)...);
+			} catch(...) {
+				deallocate(block, sizeof(T));
+				throw;
+			}
+		}
+
+		/**
+		 * Destructs object and gives its block back to the pool. Does nothing if object is nullptr.
+		 */
+		template<typename T> void destroy(T* object) noexcept
+		{
+			if(object != nullptr) {
+				object->~T();
+				deallocate(object, sizeof(T));
+			}
+		}
+
+		/**
+		 * Returns every block kept for reuse to the allocator.
+		 */
+		void clear() noexcept;
+
+		/**
+		 * Gets the memory kept for reuse.
+		 * @return the total size of the blocks in the pool in bytes.
+		 */
+		size_t size() const noexcept;
+
+	private:
+		class Block
+		{
+		public:
+			Block* next;
+		};
+
+		/**
+		 * The blocks kept for reuse, by their size.
+		 */
+		Block* blocks[MAX_SIZE + 1];
+		size_t bytes;
+	};
+}
+
+#endif
@@ -3,25 +3,297 @@
 #define BDFREADER_HPP_
 
 #include "Bdf.hpp"
+#include "BdfCompression.hpp"
+#include "BdfSerializeOptions.hpp"
+#include "BdfStats.hpp"
+#include "BdfMemoryUsage.hpp"
 #include <iostream>
+#include <cstdint>
 #include <string>
+#include <vector>
+
+#if __has_include(<sys/uio.h>)
+	#include <sys/uio.h>
+	#define BDF_HAS_IOVEC
+#endif
 
 namespace Bdf
 {
 	class BdfReader
 	{
+		friend class BdfLookupTable;
+		friend class BdfObject;
+
 	protected:
 		BdfObject* bdf;
 		BdfLookupTable* lookupTable;
+
+		/**
+		 * The lookup table of the document replaced by the last load(), kept along with its pool so the next
+		 * load() can parse into it while the current document is still there to fall back on.
+		 */
+		BdfLookupTable* spare;
+		BdfStats stats;
+		uint64_t content_hash;
+		uint64_t content_hash_generation;
+
+		/**
+		 * The data written by serializeBuffered() and the key locations worked out by every serialisation,
+		 * kept between calls so serialising similar documents doesn't allocate.
+		 */
+		std::vector<char> buffer;
+		std::vector<int> serialize_locations;
+
+		/**
+		 * The payloads left out of the data by the last call to serializeVectored().
+		 */
+		std::vector<BdfLookupTable::Gathered> gathered;
+
+		/**
+		 * The sizes worked out by the last pass over the document for serialising. They're reused while
+		 * the lookup table still has the same generation and no other pass has been made over it since.
+		 */
+		uint64_t seek_generation;
+		uint64_t seek_pass;
+		int seek_bdf_size;
+		int seek_lookupTable_size;
+		int seek_lookupTable_size_bytes;
+		int seek_strings_size;
+
 		void initEmpty();
+
+		/**
+		 * Parses the binary BDF data at data, replacing the contents of the reader.
+		 * @throw BdfError if the size tags in data do not match size.
+		 * @internal
+		 */
+		void initFromData(const char* data, int size);
+
+		/**
+		 * Parses only the lookup table of the binary BDF data at data into the spare lookup table, or a new one.
+		 * The reader is left as it was until the table is given to replaceDocument().
+		 * @param pLookupTable set to the parsed lookup table.
+		 * @return the size of the root object at the start of data.
+		 * @throw BdfError if the size tags in data do not match size.
+		 * @internal
+		 */
+		int initLookupTable(const char* data, int size, BdfLookupTable** pLookupTable);
+
+		/**
+		 * Replaces the document of the reader with pBdf, whose objects use pLookupTable. The old lookup table
+		 * is kept as the spare one unless it's shared with a copy of the reader.
+		 * @internal
+		 */
+		void replaceDocument(BdfObject* pBdf, BdfLookupTable* pLookupTable) noexcept;
+
+		/**
+		 * Works out the locations of the keys and the size of every object for serialising with options,
+		 * unless the last pass did already.
+		 * @return the size of the serialised data in bytes.
+		 * @internal
+		 */
+		int serializeSeek(const BdfSerializeOptions &options);
+
+		/**
+		 * Writes the data measured by serializeSeek() to data, which must have room for all of it.
+		 * @return the number of bytes written, which is less than the size if payloads were gathered.
+		 * @internal
+		 */
+		int serializeWrite(char* data);
 	
 	public:
 		BdfReader();
 		BdfReader(const char* database, int size);
+
+		/**
+		 * Copies reader in O(1) time, by sharing every object and the lookup table with it. The copy is a
+		 * read-only snapshot: reader is still the one to change, and each change copies only the objects on the
+		 * way to it, so the copy keeps seeing the document as it was when it was copied.
+		 *
+		 * Methods that change an object, list or named list return the one changed, which is a copy if it was
+		 * shared. Pointers got before a change, including ones got before copying the reader, keep showing the
+		 * copy's version. Changing an object the copy still shares with reader changes reader, as if the object
+		 * was got from it, and changing an object only the copy holds throws std::logic_error. Once reader is
+		 * deleted, its oldest copy takes its place.
+		 *
+		 * Copies can be read and deleted on other threads while reader is changed: the getters of BdfObject,
+		 * BdfList::get() and its iterators, and BdfNamedList::get() and exists() are safe. The objects only a
+		 * deleted copy held are given back to the pool the next time reader changes something. Copying reader,
+		 * serialising and hashing copies, and compactKeys(), must be done on the thread changing reader.
+		 * @param reader the reader to copy.
+		 * @since 2.0.0
+		 */
+		BdfReader(const BdfReader &reader);
+
+		/**
+		 * Deleted (no copy assignment).
+		 */
+		BdfReader& operator=(const BdfReader&) = delete;
+
 		virtual ~BdfReader();
+
+		/**
+		 * Parses binary BDF data into the reader, replacing the document it holds.
+		 *
+		 * Unlike constructing a new reader for each message, the memory of the old document is kept: objects,
+		 * lists, named lists, items and small payloads are reused from a pool, and lookup tables are cleared
+		 * and reused with their keys. The data is parsed into the lookup table and pool kept from the load
+		 * before last, and the old document is only given back to its pool once parsing has succeeded, so the
+		 * reader takes turns between two of them. Loading messages of a similar shape over and over stops
+		 * allocating after the first few, apart from strings too long to be stored inside a std::string and
+		 * arrays too big to be pooled. resetObject() gives the memory of the document to the pool in the same way.
+		 *
+		 * Objects got from the reader before loading must not be used afterwards. If the reader has been copied
+		 * and the copy still exists, the lookup table is shared with it, so it isn't kept for reuse.
+		 * @param data the binary BDF data.
+		 * @param size the size of data in bytes.
+		 * @throw BdfError if the size tags in data do not match size. The reader keeps the document it had.
+		 * @since 2.0.0
+		 */
+		void load(const char* data, int size);
+
+		/**
+		 * Frees the memory kept by load(), resetObject() and serializeBuffered() to be reused, for example
+		 * after an unusually big message.
+		 * @since 2.0.0
+		 */
+		void trim() noexcept;
+
+		/**
+		 * Removes the keys no longer used by any named list from the lookup table, so documents that keep
+		 * adding and removing keys, such as session ids, don't grow the table forever. Serialising the reader
+		 * with BdfSerializeOptions::compactKeys set does this on its own once the unused keys are at least as
+		 * many as the used ones.
+		 *
+		 * The remaining keys are renumbered, so key locations got before, such as from BdfNamedList::keys(), must
+		 * be looked up again. Nothing is removed while copies of the reader share the lookup table, since they
+		 * may be read from other threads. Unused keys are kept to be reused like the memory kept by load(), until
+		 * trim() is called.
+		 * @return the number of keys removed.
+		 * @since 2.0.0
+		 */
+		int compactKeys();
+
 		void serialize(char** data, int* size);
+
+		/**
+		 * Serialises the reader to binary BDF data using the encodings set in options.
+		 * The data is allocated with new[] and must be freed with delete[].
+		 * @param data set to the serialised data.
+		 * @param size set to the size of the serialised data in bytes.
+		 * @param options the encodings to use.
+		 * @since 2.0.0
+		 */
+		void serialize(char** data, int* size, const BdfSerializeOptions &options);
+
+		/**
+		 * Serialises the reader to binary BDF data like serialize(), but into a buffer owned by the reader which
+		 * is reused by the next call. Serialising similar documents over and over doesn't allocate once the
+		 * buffer is big enough.
+		 * @param data set to the serialised data, which is valid until the reader is next serialised with this
+		 *        method, trimmed or deleted.
+		 * @param size set to the size of the serialised data in bytes.
+		 * @param options the encodings to use.
+		 * @since 2.0.0
+		 */
+		void serializeBuffered(const char** data, int* size, const BdfSerializeOptions &options = BdfSerializeOptions());
+
+		/**
+		 * Gets the size of the binary BDF data that serialising the reader with options produces, so a buffer
+		 * can be made ready for serializeInto(). The sizes worked out are kept, so serialising the unchanged
+		 * reader with the same options straight after doesn't work them out again.
+		 * @param options the encodings to use.
+		 * @return the size of the serialised data in bytes.
+		 * @since 2.0.0
+		 */
+		size_t serializedSize(const BdfSerializeOptions &options = BdfSerializeOptions());
+
+		/**
+		 * Serialises the reader to binary BDF data written straight into data, such as a network send buffer
+		 * or shared memory, without allocating a buffer for it.
+		 * @param data the buffer to write to.
+		 * @param capacity the size of data in bytes.
+		 * @param options the encodings to use.
+		 * @return the size of the serialised data in bytes. If this is more than capacity, nothing was written,
+		 *         and the return value is the capacity needed.
+		 * @since 2.0.0
+		 */
+		size_t serializeInto(char* data, size_t capacity, const BdfSerializeOptions &options = BdfSerializeOptions());
+
+		#ifdef BDF_HAS_IOVEC
+
+		/**
+		 * Serialises the reader to binary BDF data as a list of segments for writev() or sendmsg(), without
+		 * copying big payloads. Flags, size tags, keys and small payloads are written to a buffer owned by the
+		 * reader, while strings and uncompressed primitive arrays of at least threshold bytes are referenced
+		 * where they're stored. Writing every segment in order gives the same data as serialize().
+		 *
+		 * Payloads of lists stored as columns and compact arrays are always copied, since they're encoded
+		 * while being serialised. writev() takes at most IOV_MAX segments per call.
+		 * @param segments cleared, then set to the segments of the data. They're valid until the document is
+		 *        changed, or the reader is next serialised with this method or serializeBuffered(), trimmed or deleted.
+		 * @param options the encodings to use.
+		 * @param threshold the smallest payload to reference instead of copying, in bytes.
+		 * @since 2.0.0
+		 */
+		void serializeVectored(std::vector<iovec>* segments, const BdfSerializeOptions &options = BdfSerializeOptions(), size_t threshold = 4096);
+
+		#endif
+
+		/**
+		 * Serialises the reader to binary BDF data and streams it to &stream compressed with codec.
+		 * Where serializeVectored() is available, big strings and arrays are compressed straight from where
+		 * they're stored, and only the rest is written to the buffer used by serializeBuffered() first. Otherwise
+		 * the whole document is written to that buffer. Either way, data from serializeBuffered() is no longer valid.
+		 * @param stream an output stream to which the compressed BDF data will be sent.
+		 * @param codec the codec to compress with. Defaults to the fastest one available (see BdfCompression::AUTO).
+		 * @param level the compression level, or -1 to use the codec's default level.
+		 * @throw std::runtime_error if codec is not supported.
+		 * @since 2.0.0
+		 */
+		void serializeCompressed(std::ostream &stream, BdfCompression::Codec codec = BdfCompression::Codec::AUTO, int level = -1);
+
+		/**
+		 * Gets a hash of the canonical binary BDF data of the reader (see BdfSerializeOptions::canonical),
+		 * so documents that compare equal have the same hash whichever order their keys were added in.
+		 * The hash is cached until the document changes. It's 64 bits and not cryptographic, so when used
+		 * to deduplicate data, data with the same hash should still be compared before being treated as equal.
+		 * @return the same hash as contentHash(data, size) of the canonical data.
+		 * @since 2.0.0
+		 */
+		uint64_t contentHash();
+
+		/**
+		 * Hashes serialised binary BDF data the same way as contentHash(), without parsing it.
+		 * @param data the serialised data, which should be canonical to match the hash of the reader it came from.
+		 * @param size the size of data in bytes.
+		 * @return the hash.
+		 * @since 2.0.0
+		 */
+		static uint64_t contentHash(const char* data, int size) noexcept;
 		BdfObject* getObject();
 		BdfObject* resetObject();
+
+		/**
+		 * Gets the counters recorded while parsing and serialising with this reader.
+		 * The counters are only recorded when the library is built with the BDF_STATS option.
+		 * @return a copy of the counters, with BdfStats::keys set to the current size of the lookup table.
+		 * @since 2.0.0
+		 */
+		BdfStats getStats() const;
+
+		/**
+		 * Sets every counter recorded by this reader back to zero.
+		 * @since 2.0.0
+		 */
+		void resetStats() noexcept;
+
+		/**
+		 * Gets the memory owned by the reader, including its lookup table and every object in the document.
+		 * @return the bytes owned, by category.
+		 * @since 2.0.0
+		 */
+		BdfMemoryUsage memoryUsage() const;
 		
 		/**
 		 * Serialises human-readable BDF data and returns it as a string. This overload
@@ -0,0 +1,37 @@
+
+#ifndef BDFREADERCOLUMN_HPP_
+#define BDFREADERCOLUMN_HPP_
+
+#include "Bdf.hpp"
+#include <string>
+
+namespace Bdf
+{
+	/**
+	 * Class for reading one field from every row of a list of named lists in binary BDF data,
+	 * without decoding the other fields or the rest of the document.
+	 *
+	 * This is fastest when the list was serialised as columns (see BdfSerializeOptions::COLUMNAR),
+	 * as the field is then stored in one piece, but it works on any list.
+	 *
+	 * The object of the reader is a typed array if the values all have the same primitive type
+	 * (for example, a field of integers is read as an integer array), otherwise it is a list with an
+	 * object for each row. The object is undefined if the list or the key could not be found.
+	 * @since 2.0.0
+	 */
+	class BdfReaderColumn : public BdfReader
+	{
+	public:
+		/**
+		 * Reads the values at key from the list at path in data.
+		 * @param data the binary BDF data, as produced by BdfReader::serialize().
+		 * @param size the size of data in bytes.
+		 * @param path the path of the list within the data, which can be empty for the root object.
+		 * @param key the key to read from every row.
+		 * @throw BdfError if the size tags in data do not match size.
+		 */
+		BdfReaderColumn(const char* data, int size, const BdfPath &path, const std::string &key);
+	};
+}
+
+#endif
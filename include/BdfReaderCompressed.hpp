@@ -0,0 +1,82 @@
+
+#ifndef BDFREADERCOMPRESSED_HPP_
+#define BDFREADERCOMPRESSED_HPP_
+
+#include "Bdf.hpp"
+#include <iostream>
+#include <filesystem>
+
+namespace Bdf
+{
+	/**
+	 * Class for reading compressed binary BDF files.
+	 *
+	 * The compressed data is decompressed in chunks straight into the buffer that is parsed, which is
+	 * allocated once the size of the document is known, so the document is never held in memory
+	 * both compressed and uncompressed.
+	 * @since 2.0.0
+	 */
+	class BdfReaderCompressed : public BdfReader
+	{
+	protected:
+		/**
+		 * Decompresses stream and parses it, replacing the contents of the reader.
+		 * @internal
+		 */
+		void readCompressed(std::istream &stream, BdfCompression::Codec codec);
+
+	public:
+		/**
+		 * Reads compressed binary BDF data from stream.
+		 * @param stream the stream to read the compressed data from.
+		 * @param codec the codec the data was compressed with, or BdfCompression::AUTO to detect it.
+		 * @throw BdfError if the decompressed data is not a complete binary BDF document.
+		 * @throw std::runtime_error if the data is corrupt or codec is not supported.
+		 */
+		explicit BdfReaderCompressed(std::istream &stream, BdfCompression::Codec codec = BdfCompression::Codec::AUTO);
+
+		/**
+		 * Opens the file located at filename as a compressed binary BDF file.
+		 * @param filename the file to read.
+		 * @param codec the codec the file was compressed with, or BdfCompression::AUTO to detect it.
+		 * @throw BdfError if the decompressed data is not a complete binary BDF document.
+		 * @throw std::runtime_error if the file could not be opened, the data is corrupt or codec is not supported.
+		 */
+		explicit BdfReaderCompressed(const std::filesystem::path &filename, BdfCompression::Codec codec = BdfCompression::Codec::AUTO);
+	};
+
+	/**
+	 * Class for reading gzip compressed binary BDF files (.bdf.gz).
+	 * @since 2.0.0
+	 */
+	class BdfReaderGz : public BdfReaderCompressed
+	{
+	public:
+		explicit BdfReaderGz(std::istream &stream);
+		explicit BdfReaderGz(const std::filesystem::path &filename);
+	};
+
+	/**
+	 * Class for reading xz compressed binary BDF files (.bdf.xz).
+	 * @since 2.0.0
+	 */
+	class BdfReaderXz : public BdfReaderCompressed
+	{
+	public:
+		explicit BdfReaderXz(std::istream &stream);
+		explicit BdfReaderXz(const std::filesystem::path &filename);
+	};
+
+	/**
+	 * Class for reading Zstandard compressed binary BDF files (.bdf.zst).
+	 * @since 2.0.0
+	 */
+	class BdfReaderZstd : public BdfReaderCompressed
+	{
+	public:
+		explicit BdfReaderZstd(std::istream &stream);
+		explicit BdfReaderZstd(const std::filesystem::path &filename);
+	};
+}
+
+#endif
@@ -20,12 +20,22 @@ namespace Bdf
 		 */
 		explicit BdfReaderHuman(const std::string &data);
 
+		/**
+		 * Parses size bytes of UTF-8 text at data as a human-readable BDF file, without copying them to a string first.
+		 * Useful for parsing large files that are mapped into memory.
+		 * @param data narrow-encoded text representing a human-readable BDF file.
+		 * @param size the number of bytes of text at data.
+		 * @throw BdfError if data could not be parsed.
+		 * @since 2.0.0
+		 */
+		BdfReaderHuman(const char* data, size_t size);
+
 		/**
 		 * Parses data as a human-readable BDF file.
 		 * @param data wide-encoded text representing a human-readable BDF file.
 		 * @throw BdfError if data could not be parsed.
 		 */
-		explicit BdfReaderHuman(const std::wstring *data);
+		explicit BdfReaderHuman(const std::wstring &data);
 		
 		/**
 		 * Opens the file located at filename as a BDF file.
@@ -0,0 +1,43 @@
+
+#ifndef BDFREADERPATH_HPP_
+#define BDFREADERPATH_HPP_
+
+#include "Bdf.hpp"
+
+namespace Bdf
+{
+	/**
+	 * Class for reading the object at a path in binary BDF data, without decoding the rest of the document.
+	 *
+	 * Only the lookup table and the bytes along the path are read, so one field can be taken out of a very large
+	 * document quickly, especially if the data is mapped into memory. The object of the reader is the object found,
+	 * or undefined if the path was not found. Serialising the reader gives a document holding only that object.
+	 * @since 2.0.0
+	 */
+	class BdfReaderPath : public BdfReader
+	{
+	private:
+		BdfPath::View view;
+
+	public:
+		/**
+		 * Reads the object at path in data.
+		 * @param data the binary BDF data, as produced by BdfReader::serialize().
+		 * @param size the size of data in bytes.
+		 * @param path the path of the object within the data, which can be empty for the root object.
+		 * @param decode whether to decode the object found. If false, the object of the reader stays undefined,
+		 *               but the object can still be read through getView(), and its keys looked up with
+		 *               getObject()->getKeyName().
+		 * @throw BdfError if the size tags in data do not match size.
+		 */
+		BdfReaderPath(const char* data, int size, const BdfPath &path, bool decode = true);
+
+		/**
+		 * Gets where the object at the path is in the data that was read.
+		 * @return a View of the object, which evaluates to false if the path was not found.
+		 */
+		BdfPath::View getView() const noexcept;
+	};
+}
+
+#endif
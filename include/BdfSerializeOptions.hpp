@@ -0,0 +1,103 @@
+
+#ifndef BDFSERIALIZEOPTIONS_HPP_
+#define BDFSERIALIZEOPTIONS_HPP_
+
+#include <cstdint>
+
+namespace Bdf
+{
+	/**
+	 * Class used to configure the encodings used when serialising binary BDF data.
+	 * The default options produce the classic binary format, which can be read by every BDF implementation.
+	 * @newable
+	 * @since 2.0.0
+	 */
+	class BdfSerializeOptions
+	{
+	public:
+		/**
+		 * Enumeration type representing how integer, long and short arrays are encoded.
+		 * @since 2.0.0
+		 */
+		enum ArrayEncoding: uint8_t {
+			/**
+			 * Always store arrays as fixed-width big-endian elements.
+			 */
+			FIXED,
+
+			/**
+			 * Store arrays as delta + zigzag varints when that is smaller than the fixed-width encoding.
+			 * This suits sorted ids and small counters, which usually take 1 or 2 bytes per element.
+			 */
+			AUTO,
+
+			/**
+			 * Always store arrays as delta + zigzag varints.
+			 */
+			COMPACT,
+		};
+
+		/**
+		 * Enumeration type representing how lists of named lists are encoded.
+		 * @since 2.0.0
+		 */
+		enum ListEncoding: uint8_t {
+			/**
+			 * Always store lists as a sequence of objects.
+			 */
+			ROWS,
+
+			/**
+			 * Store lists of named lists with the same keys as columns when that is smaller.
+			 */
+			AUTO_COLUMNAR,
+
+			/**
+			 * Always store lists of named lists with the same keys as columns. Each key is stored once,
+			 * followed by the value of every row as a typed array (if the values are all the same
+			 * primitive type) or a list. See BdfReaderColumn for reading a single column.
+			 */
+			COLUMNAR,
+		};
+
+		ArrayEncoding arrayEncoding;
+		ListEncoding listEncoding;
+
+		/**
+		 * Store string values that are used more than once in a string table after the lookup table,
+		 * replacing each use with a reference. Readers share one string for every reference to it.
+		 */
+		bool stringTable;
+
+		/**
+		 * Produce the same bytes for every pair of documents that compare equal, whatever order their keys
+		 * were added in. Keys are numbered and named lists are stored in the byte order of the key names, and
+		 * every NaN is stored as the same quiet NaN. The classic encodings are always used, so arrayEncoding,
+		 * listEncoding and stringTable are ignored. See BdfReader::contentHash().
+		 */
+		bool canonical;
+
+		/**
+		 * Remove the keys no longer used by any named list from the lookup table first, once they are at least
+		 * as many as the used ones. The remaining keys are renumbered, so key locations held from before, such as
+		 * from BdfNamedList::keys(), can't be used afterwards. Off by default. See BdfReader::compactKeys().
+		 */
+		bool compactKeys;
+
+		/**
+		 * Creates options which produce the classic binary format.
+		 */
+		BdfSerializeOptions();
+
+		/**
+		 * Creates options with the encodings provided.
+		 * @param arrayEncoding how integer, long and short arrays will be encoded.
+		 * @param listEncoding how lists of named lists will be encoded.
+		 * @param stringTable whether repeated string values are stored in a string table.
+		 * @param canonical whether equal documents are stored as the same bytes.
+		 */
+		explicit BdfSerializeOptions(ArrayEncoding arrayEncoding, ListEncoding listEncoding = ListEncoding::ROWS, bool stringTable = false, bool canonical = false);
+	};
+}
+
+#endif
@@ -0,0 +1,114 @@
+
+#ifndef BDFSTATS_HPP_
+#define BDFSTATS_HPP_
+
+#include "BdfTypes.hpp"
+#include <cstdint>
+#include <string>
+
+namespace Bdf
+{
+	/**
+	 * Class holding the counters a BdfReader records while parsing and serialising, returned by BdfReader::getStats().
+	 *
+	 * Recording the counters has a cost on every node, so they are only updated when the library is built with
+	 * the BDF_STATS option. Otherwise they are compiled out and always zero, which can be checked with isEnabled().
+	 * @since 2.0.0
+	 */
+	class BdfStats
+	{
+	public:
+		/**
+		 * The number of nodes parsed from binary or human-readable data, indexed by their type in BdfTypes.
+		 * Compact encodings are counted as the type they decode to.
+		 */
+		uint64_t nodes[BdfTypes::ARRAY_FLOAT + 1];
+
+		/**
+		 * The number of bytes of binary data parsed, or characters of human-readable data.
+		 */
+		uint64_t bytesParsed;
+
+		/**
+		 * The number of bytes of binary data serialised, plus the characters of human-readable data
+		 * returned by BdfReader::serializeHumanReadable().
+		 */
+		uint64_t bytesSerialized;
+
+		/**
+		 * The number of keys in the lookup table when the stats were retrieved.
+		 */
+		uint64_t keys;
+
+		/**
+		 * The number of calls to BdfLookupTable::getLocation() that found an existing key (hits),
+		 * and that had to add the key to the lookup table (misses).
+		 */
+		uint64_t keyHits;
+		uint64_t keyMisses;
+
+		/**
+		 * The number and total size of the allocations made for nodes, list items, payloads, strings, keys
+		 * and serialisation buffers. Arrays returned by the getters are owned by the caller and aren't counted.
+		 * Nodes, items and payloads reused from the pool of the lookup table are counted as well.
+		 */
+		uint64_t allocations;
+		uint64_t allocatedBytes;
+
+		/**
+		 * The deepest level of nesting reached while parsing, where the root object is at depth 1.
+		 */
+		int maxDepth;
+
+		/**
+		 * The time spent in each phase in nanoseconds: parsing, finding the keys in use
+		 * (BdfLookupTable::serializeGetLocations()), measuring (serializeSeeker()) and writing (serialize()).
+		 */
+		uint64_t parseTime;
+		uint64_t getLocationsTime;
+		uint64_t serializeSeekerTime;
+		uint64_t serializeTime;
+
+		/**
+		 * The current level of nesting of the parser.
+		 * @internal
+		 */
+		int depth;
+
+		/**
+		 * Creates stats with every counter set to zero.
+		 */
+		BdfStats();
+
+		/**
+		 * Checks if the library was built with the BDF_STATS option, so the counters are recorded.
+		 * @return true if the counters are recorded.
+		 */
+		static bool isEnabled() noexcept;
+
+		/**
+		 * Sets every counter back to zero.
+		 */
+		void reset() noexcept;
+
+		/**
+		 * Formats the counters as text, one counter per line.
+		 * @return the counters as text.
+		 */
+		std::string toString() const;
+
+		/**
+		 * Records the parser moving into a nested object.
+		 * @internal
+		 */
+		void enter() noexcept;
+
+		/**
+		 * Records the parser moving out of a nested object.
+		 * @internal
+		 */
+		void leave() noexcept;
+	};
+}
+
+#endif
@@ -29,6 +29,14 @@ namespace Bdf
 		const static char ARRAY_BYTE = 15;
 		const static char ARRAY_DOUBLE = 16;
 		const static char ARRAY_FLOAT = 17;
+
+		// Compact encodings that are only found in binary data (see BdfSerializeOptions).
+		// Objects are always decoded to the types above, so getType() never returns these.
+		const static char ARRAY_INTEGER_VARINT = 18;
+		const static char ARRAY_LONG_VARINT = 19;
+		const static char ARRAY_SHORT_VARINT = 20;
+		const static char LIST_COLUMNAR = 21;
+		const static char STRING_REF = 22;
 	};
 }
 
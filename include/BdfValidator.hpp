@@ -0,0 +1,147 @@
+
+#ifndef BDFVALIDATOR_HPP_
+#define BDFVALIDATOR_HPP_
+
+#include "Bdf.hpp"
+#include <cstdint>
+
+namespace Bdf
+{
+	/**
+	 * Class that checks the structure of serialised binary BDF data without parsing it into BdfObjects.
+	 *
+	 * The binary constructors skip or stop at anything malformed, so a BdfReader built from bad data silently holds
+	 * less than the data claims to. The validator reads the data once, front to back, without allocating, and reports
+	 * the first problem found and where it is. This makes it cheap enough to check untrusted data before parsing it.
+	 *
+	 * Every flag byte, size tag, typed array size, compact encoding, key and string reference is checked, as well as
+	 * the bounds of the lookup table and the string table stored after the root object.
+	 * @since 2.0.0
+	 */
+	class BdfValidator
+	{
+	public:
+		/**
+		 * Enumeration type representing the problem found by validate().
+		 */
+		enum ErrorType: uint8_t {
+			/**
+			 * Indicates that the data is valid.
+			 */
+			NONE,
+
+			/**
+			 * Indicates that the data is empty, or too large to be binary BDF data.
+			 */
+			INVALID_DATA_SIZE,
+
+			/**
+			 * Indicates that a flag byte does not hold a known type.
+			 */
+			INVALID_FLAGS,
+
+			/**
+			 * Indicates that an object, its size tag or the key after it runs past the end of the list containing it.
+			 */
+			TRUNCATED,
+
+			/**
+			 * Indicates that the size tag of an object is smaller than the object's flag byte and size tag.
+			 */
+			INVALID_SIZE,
+
+			/**
+			 * Indicates that the size of a typed array is not a whole number of elements.
+			 */
+			INVALID_ARRAY_SIZE,
+
+			/**
+			 * Indicates that a compact array holds a malformed varint, an element out of range for its type,
+			 * or a different number of elements than it claims to.
+			 */
+			INVALID_ENCODING,
+
+			/**
+			 * Indicates that a columnar list has a malformed header, a column that isn't a typed array or list,
+			 * or a column with a different number of rows than the list.
+			 */
+			INVALID_COLUMNS,
+
+			/**
+			 * Indicates that a key is not in the lookup table.
+			 */
+			INVALID_KEY,
+
+			/**
+			 * Indicates that a string reference is not in the string table.
+			 */
+			INVALID_STRING_REF,
+
+			/**
+			 * Indicates that the lookup table, or a key in it, runs past the end of the data.
+			 */
+			LOOKUP_TABLE_BOUNDS,
+
+			/**
+			 * Indicates that the string table, or a string in it, runs past the end of the data.
+			 */
+			STRING_TABLE_BOUNDS,
+
+			/**
+			 * Indicates that there is data after the end of the string table.
+			 */
+			TRAILING_DATA,
+
+			/**
+			 * Indicates that lists are nested deeper than MAX_DEPTH.
+			 */
+			TOO_DEEP,
+		};
+
+		/**
+		 * Result of validating binary BDF data.
+		 */
+		class Result
+		{
+		public:
+			/**
+			 * The problem found, or ErrorType::NONE if the data is valid.
+			 */
+			ErrorType error;
+
+			/**
+			 * The offset in bytes from the start of the data of the object or table where the problem was found,
+			 * or -1 if the data is valid.
+			 */
+			int64_t offset;
+
+			/**
+			 * Checks if the data is valid.
+			 * @return true if no problem was found, false otherwise.
+			 */
+			explicit operator bool() const noexcept;
+
+			/**
+			 * Gets a short description of error.
+			 * @return the description, for example "Object runs past the end of its container".
+			 */
+			const char* getMessage() const noexcept;
+		};
+
+		/**
+		 * The deepest nesting of lists and named lists that validate() accepts.
+		 * It bounds the memory the validator uses, which is fixed and stored on the stack.
+		 */
+		static const int MAX_DEPTH = 1024;
+
+		/**
+		 * Checks the structure of serialised binary BDF data, as produced by BdfReader::serialize().
+		 * @param data the serialised BDF data.
+		 * @param size the size of data in bytes.
+		 * @return the first problem found and its offset, which evaluates to true if the data is valid.
+		 */
+		static Result validate(const char* data, int64_t size) noexcept;
+	};
+}
+
+#endif
@@ -0,0 +1,216 @@
+
+#include "../include/Bdf.hpp"
+#include "../include/BdfAsync.hpp"
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <algorithm>
+#include <vector>
+
+using namespace Bdf;
+
+class BdfAsync::Operation::State
+{
+public:
+	std::atomic<bool> cancelled;
+	std::promise<void> promise;
+
+	std::mutex mutex;
+	bool done;
+	std::exception_ptr error;
+	void* waiting;
+	void (*resume)(void*);
+
+	State() : cancelled(false), done(false), waiting(nullptr), resume(nullptr) {
+	}
+
+	void checkCancelled() const
+	{
+		if(cancelled) {
+			throw std::system_error(std::make_error_code(std::errc::operation_canceled));
+		}
+	}
+};
+
+void BdfAsync::Operation::cancel() noexcept {
+	state->cancelled = true;
+}
+
+bool BdfAsync::Operation::isDone() const noexcept
+{
+	std::lock_guard<std::mutex> lock(state->mutex);
+	return state->done;
+}
+
+std::future<void> BdfAsync::Operation::getFuture() {
+	return state->promise.get_future();
+}
+
+bool BdfAsync::Operation::suspend(void* address, void (*resume)(void*))
+{
+	std::lock_guard<std::mutex> lock(state->mutex);
+
+	if(state->done) {
+		return false;
+	}
+
+	state->waiting = address;
+	state->resume = resume;
+
+	return true;
+}
+
+void BdfAsync::Operation::rethrow() const
+{
+	std::lock_guard<std::mutex> lock(state->mutex);
+
+	if(state->error) {
+		std::rethrow_exception(state->error);
+	}
+}
+
+BdfAsync::Operation BdfAsync::start(std::function<void(Operation::State*)> job)
+{
+	std::shared_ptr<Operation::State> state = std::make_shared<Operation::State>();
+
+	std::thread thread([state, job] ()
+	{
+		std::exception_ptr error;
+
+		try {
+			job(state.get());
+		} catch(...) {
+			error = std::current_exception();
+		}
+
+		void* waiting;
+		void (*resume)(void*);
+
+		{
+			std::lock_guard<std::mutex> lock(state->mutex);
+			state->done = true;
+			state->error = error;
+			waiting = state->waiting;
+			resume = state->resume;
+		}
+
+		if(error) {
+			state->promise.set_exception(error);
+		} else {
+			state->promise.set_value();
+		}
+
+		if(waiting != nullptr) {
+			resume(waiting);
+		}
+	});
+
+	thread.detach();
+
+	Operation operation;
+	operation.state = state;
+
+	return operation;
+}
+
+BdfAsync::Operation BdfAsync::load(BdfReader* reader, const std::filesystem::path &filename, size_t maxSize)
+{
+	return start([reader, filename, maxSize] (Operation::State* state)
+	{
+		std::ifstream stream(filename, std::ios::in | std::ios::binary | std::ios::ate);
+
+		if(!stream.is_open()) {
+			throw std::runtime_error("Could not open " + filename.string() + " for reading.");
+		}
+
+		size_t size = stream.tellg();
+		stream.seekg(0);
+
+		if(size > maxSize || size > INT_MAX) {
+			throw std::runtime_error("Could not read " + filename.string() + " because it is bigger than the maximum size.");
+		}
+
+		std::vector<char> data(size);
+
+		for(size_t upto = 0; upto < size; upto += CHUNK_SIZE)
+		{
+			state->checkCancelled();
+
+			if(!stream.read(data.data() + upto, std::min(CHUNK_SIZE, size - upto))) {
+				throw std::runtime_error("Could not read " + filename.string() + ".");
+			}
+		}
+
+		state->checkCancelled();
+		reader->load(data.data(), size);
+	});
+}
+
+BdfAsync::Operation BdfAsync::save(BdfReader* reader, const std::filesystem::path &filename, const BdfSerializeOptions &options)
+{
+	return start([reader, filename, options] (Operation::State* state)
+	{
+		std::filesystem::path temp = filename;
+		temp += ".tmp";
+
+		try
+		{
+			std::ofstream stream(temp, std::ios::out | std::ios::binary | std::ios::trunc);
+
+			if(!stream.is_open()) {
+				throw std::runtime_error("Could not open " + temp.string() + " for writing.");
+			}
+
+#ifdef BDF_HAS_IOVEC
+			std::vector<iovec> segments;
+			reader->serializeVectored(&segments, options);
+#else
+			const char* buffer;
+			int buffer_size;
+			reader->serializeBuffered(&buffer, &buffer_size, options);
+			std::vector<std::pair<const char*, size_t>> segments = {{buffer, (size_t)buffer_size}};
+#endif
+
+			for(auto &segment : segments)
+			{
+#ifdef BDF_HAS_IOVEC
+				const char* data = (const char*)segment.iov_base;
+				size_t size = segment.iov_len;
+#else
+				const char* data = segment.first;
+				size_t size = segment.second;
+#endif
+
+				for(size_t upto = 0; upto < size; upto += CHUNK_SIZE)
+				{
+					state->checkCancelled();
+
+					if(!stream.write(data + upto, std::min(CHUNK_SIZE, size - upto))) {
+						throw std::runtime_error("Could not write " + temp.string() + ".");
+					}
+				}
+			}
+
+			state->checkCancelled();
+			stream.close();
+
+			if(stream.fail()) {
+				throw std::runtime_error("Could not write " + temp.string() + ".");
+			}
+
+			std::filesystem::rename(temp, filename);
+		}
+
+		catch(...)
+		{
+			std::error_code error;
+			std::filesystem::remove(temp, error);
+
+			throw;
+		}
+	});
+}
@@ -0,0 +1,539 @@
+
+#include "../include/Bdf.hpp"
+#include "../include/BdfHelpers.hpp"
+#include <cstdint>
+#include <climits>
+#include <vector>
+#include <string.h>
+
+using namespace Bdf;
+using namespace BdfHelpers;
+
+int BdfColumns::getElementSize(char type) noexcept
+{
+	switch(type)
+	{
+		case BdfTypes::BOOLEAN:
+		case BdfTypes::BYTE:
+			return 1;
+		case BdfTypes::SHORT:
+			return 2;
+		case BdfTypes::INTEGER:
+		case BdfTypes::FLOAT:
+			return 4;
+		case BdfTypes::LONG:
+		case BdfTypes::DOUBLE:
+			return 8;
+		default:
+			return -1;
+	}
+}
+
+/*
+ * Gets the size of a list column with a payload of size bytes,
+ * including its flag byte and size tag.
+ */
+static int getListColumnSize(int size)
+{
+	size += 1;
+
+	if(size > 65531) {
+		return size + 4;
+	} else if(size > 253) {
+		return size + 2;
+	} else {
+		return size + 1;
+	}
+}
+
+BdfColumns::BdfColumns(const BdfList* pList)
+{
+	list = pList;
+	rows = 0;
+	size = 0;
+}
+
+BdfColumns::~BdfColumns()
+{
+	for(Column &column : columns) {
+		delete column.array;
+	}
+}
+
+BdfObject* BdfColumns::createArray(BdfLookupTable* lookupTable, const std::vector<BdfObject*> &values)
+{
+	if(values.empty()) {
+		return nullptr;
+	}
+
+	char type = values[0]->type;
+	int width = getElementSize(type);
+
+	if(width == -1) {
+		return nullptr;
+	}
+
+	for(BdfObject* value : values) {
+		if(value->type != type) {
+			return nullptr;
+		}
+	}
+
+	// Primitives are stored the same way as the elements of their array type,
+	// so the column can be built by copying the data of each value.
+	BdfObject* array = lookupTable->pool.create<BdfObject>(lookupTable);
+	array->type = type + (BdfTypes::ARRAY_BOOLEAN - BdfTypes::BOOLEAN);
+	array->s = width * values.size();
+	array->data = array->newData(array->s);
+
+	for(size_t i=0;i<values.size();i++) {
+		memcpy(array->data + i * width, values[i]->data, width);
+	}
+
+	return array;
+}
+
+BdfColumns* BdfColumns::create(const BdfList* list, int* locations)
+{
+	BdfList::Item* first = list->startItem;
+
+	if(first == nullptr || first->object == nullptr || first->object->type != BdfTypes::NAMED_LIST) {
+		return nullptr;
+	}
+
+	BdfNamedList* head = (BdfNamedList*)first->object->object;
+
+	if(head->start == nullptr) {
+		return nullptr;
+	}
+
+	// Every row needs the same keys in the same order
+	std::vector<BdfNamedList::Item*> cursors;
+
+	for(BdfList::Item* row = first; row != nullptr; row = row->next)
+	{
+		if(row->object == nullptr || row->object->type != BdfTypes::NAMED_LIST) {
+			return nullptr;
+		}
+
+		BdfNamedList::Item* a = head->start;
+		BdfNamedList::Item* b = ((BdfNamedList*)row->object->object)->start;
+
+		while(a != nullptr && b != nullptr && a->key == b->key) {
+			a = a->next;
+			b = b->next;
+		}
+
+		if(a != nullptr || b != nullptr) {
+			return nullptr;
+		}
+
+		cursors.push_back(((BdfNamedList*)row->object->object)->start);
+	}
+
+	BdfColumns* columns = new BdfColumns(list);
+	columns->rows = cursors.size();
+
+	std::vector<BdfObject*> values(cursors.size());
+
+	for(BdfNamedList::Item* key = head->start; key != nullptr; key = key->next)
+	{
+		Column column;
+		column.key = key->key;
+
+		for(size_t i=0;i<cursors.size();i++) {
+			values[i] = cursors[i]->object;
+			cursors[i] = cursors[i]->next;
+		}
+
+		column.array = createArray(list->lookupTable, values);
+
+		if(column.array != nullptr)
+		{
+			column.size = column.array->serializeSeeker(locations);
+		}
+
+		else
+		{
+			int payload_size = 0;
+
+			for(BdfObject* value : values) {
+				payload_size += value->last_seek;
+			}
+
+			column.size = getListColumnSize(payload_size);
+			column.values = values;
+		}
+
+		columns->size += varintSize(locations[column.key]) + column.size;
+		columns->columns.push_back(std::move(column));
+	}
+
+	columns->size += varintSize(columns->rows) + varintSize(columns->columns.size());
+
+	return columns;
+}
+
+int BdfColumns::serializeSeeker() const noexcept {
+	return size;
+}
+
+int BdfColumns::serialize(char* data, int* locations) const
+{
+	int pos = put_varint(data, rows);
+	pos += put_varint(data + pos, columns.size());
+
+	for(const Column &column : columns)
+	{
+		pos += put_varint(data + pos, locations[column.key]);
+
+		if(column.array != nullptr) {
+			pos += column.array->serialize(data + pos, locations, 0);
+			continue;
+		}
+
+		char size_bytes_tag;
+		int size_bytes;
+
+		if(column.size > 65535) {
+			size_bytes_tag = 0;
+			size_bytes = 4;
+		} else if(column.size > 255) {
+			size_bytes_tag = 1;
+			size_bytes = 2;
+		} else {
+			size_bytes_tag = 2;
+			size_bytes = 1;
+		}
+
+		data[pos] = BdfObject::getFlags(BdfTypes::LIST, size_bytes_tag, 0);
+
+		switch(size_bytes_tag)
+		{
+			case 0:
+				put_netsi(data + pos + 1, column.size);
+				break;
+			case 1:
+				put_netus(data + pos + 1, column.size);
+				break;
+			default:
+				data[pos + 1] = column.size & 255;
+		}
+
+		int upto = pos + 1 + size_bytes;
+
+		for(BdfObject* value : column.values) {
+			upto += value->serialize(data + upto, locations, 0);
+		}
+
+		pos += column.size;
+	}
+
+	return pos;
+}
+
+void BdfColumns::appendValue(BdfNamedList* row, int key, BdfObject* object)
+{
+	BdfNamedList::Item* item = row->lookupTable->pool.create<BdfNamedList::Item>(key, object, nullptr);
+	row->lookupTable->addKeyUse(key);
+
+	*row->end = item;
+	row->end = &item->next;
+}
+
+BdfObject* BdfColumns::readElement(BdfLookupTable* lookupTable, char type, const char* data)
+{
+	int width = getElementSize(type);
+
+	BdfObject* value = lookupTable->pool.create<BdfObject>(lookupTable);
+	value->type = type;
+	value->s = width;
+	value->data = value->newData(width);
+	memcpy(value->data, data, width);
+
+	return value;
+}
+
+BdfObject* BdfColumns::readArrayElement(BdfLookupTable* lookupTable, const char* data, int size, uint64_t index)
+{
+	char type, size_tag;
+	BdfObject::getFlagData(data, &type, &size_tag, NULL);
+
+	// Fixed width elements can be read straight from the data
+	if(type >= BdfTypes::ARRAY_BOOLEAN && type <= BdfTypes::ARRAY_FLOAT)
+	{
+		int offset = 1 + BdfObject::getSizeBytes(size_tag);
+		char element_type = type - (BdfTypes::ARRAY_BOOLEAN - BdfTypes::BOOLEAN);
+		int width = getElementSize(element_type);
+
+		if(index >= (uint64_t)(size - offset) / width) {
+			return nullptr;
+		}
+
+		return readElement(lookupTable, element_type, data + offset + index * width);
+	}
+
+	// Compact arrays have to be decoded up to the element
+	BdfObject array(lookupTable, data, size);
+
+	if(array.type < BdfTypes::ARRAY_BOOLEAN || array.type > BdfTypes::ARRAY_FLOAT) {
+		return nullptr;
+	}
+
+	char element_type = array.type - (BdfTypes::ARRAY_BOOLEAN - BdfTypes::BOOLEAN);
+	int width = getElementSize(element_type);
+
+	if(index >= (uint64_t)array.s / width) {
+		return nullptr;
+	}
+
+	return readElement(lookupTable, element_type, array.data + index * width);
+}
+
+BdfList* BdfColumns::expand(BdfLookupTable* lookupTable, const char* data, int size)
+{
+	uint64_t rows, column_count;
+	int pos = get_varint(data, size, &rows);
+
+	if(pos == -1) {
+		return nullptr;
+	}
+
+	int varint_size = get_varint(data + pos, size - pos, &column_count);
+
+	if(varint_size == -1) {
+		return nullptr;
+	}
+
+	pos += varint_size;
+
+	// Every column takes at least 1 byte per row, plus its key and flag byte
+	if(column_count == 0 || rows > (uint64_t)(size - pos) || column_count > (uint64_t)(size - pos) / 2) {
+		return nullptr;
+	}
+
+	BdfList* list = lookupTable->pool.create<BdfList>(lookupTable);
+	std::vector<BdfNamedList*> rowLists(rows);
+
+	for(uint64_t i=0;i<rows;i++) {
+		rowLists[i] = lookupTable->pool.create<BdfNamedList>(lookupTable);
+		list->add(lookupTable->pool.create<BdfObject>(lookupTable)->setNamedList(rowLists[i]));
+	}
+
+	for(uint64_t c=0;c<column_count;c++)
+	{
+		uint64_t key;
+		varint_size = get_varint(data + pos, size - pos, &key);
+
+		if(varint_size == -1 || key > INT_MAX) {
+			delete list;
+			return nullptr;
+		}
+
+		pos += varint_size;
+
+		int column_size = BdfObject::getCheckedSize(data + pos, size - pos);
+
+		if(column_size == -1) {
+			delete list;
+			return nullptr;
+		}
+
+		BdfObject column(lookupTable, data + pos, column_size);
+		pos += column_size;
+
+		// Typed array
+		if(column.type >= BdfTypes::ARRAY_BOOLEAN && column.type <= BdfTypes::ARRAY_FLOAT)
+		{
+			char type = column.type - (BdfTypes::ARRAY_BOOLEAN - BdfTypes::BOOLEAN);
+			int width = getElementSize(type);
+
+			if((uint64_t)column.s != rows * width) {
+				delete list;
+				return nullptr;
+			}
+
+			for(uint64_t i=0;i<rows;i++) {
+				appendValue(rowLists[i], key, readElement(lookupTable, type, column.data + i * width));
+			}
+		}
+
+		// List of any objects, which are moved into the rows
+		else if(column.type == BdfTypes::LIST)
+		{
+			BdfList* values = (BdfList*)column.object;
+
+			if(values->size() != rows) {
+				delete list;
+				return nullptr;
+			}
+
+			BdfList::Item* item = values->startItem;
+
+			for(uint64_t i=0;i<rows;i++) {
+				appendValue(rowLists[i], key, item->object);
+				item->object = nullptr;
+				item = item->next;
+			}
+		}
+
+		else {
+			delete list;
+			return nullptr;
+		}
+	}
+
+	if(pos != size) {
+		delete list;
+		return nullptr;
+	}
+
+	return list;
+}
+
+BdfObject* BdfColumns::readColumn(BdfLookupTable* lookupTable, const char* data, int size, int key)
+{
+	char type, size_tag;
+	BdfObject::getFlagData(data, &type, &size_tag, NULL);
+
+	int offset = 1 + BdfObject::getSizeBytes(size_tag);
+
+	if(offset > size) {
+		return nullptr;
+	}
+
+	const char* payload = data + offset;
+	int payload_size = size - offset;
+
+	// The column is stored in one piece, so only that piece needs to be found and decoded
+	if(type == BdfTypes::LIST_COLUMNAR)
+	{
+		uint64_t rows, column_count;
+		int pos = get_varint(payload, payload_size, &rows);
+
+		if(pos == -1) {
+			return nullptr;
+		}
+
+		int varint_size = get_varint(payload + pos, payload_size - pos, &column_count);
+
+		if(varint_size == -1) {
+			return nullptr;
+		}
+
+		pos += varint_size;
+
+		for(uint64_t c=0;c<column_count;c++)
+		{
+			uint64_t column_key;
+			varint_size = get_varint(payload + pos, payload_size - pos, &column_key);
+
+			if(varint_size == -1) {
+				return nullptr;
+			}
+
+			pos += varint_size;
+
+			int column_size = BdfObject::getCheckedSize(payload + pos, payload_size - pos);
+
+			if(column_size == -1) {
+				return nullptr;
+			}
+
+			if(column_key == (uint64_t)key) {
+				return lookupTable->pool.create<BdfObject>(lookupTable, payload + pos, column_size);
+			}
+
+			pos += column_size;
+		}
+
+		return nullptr;
+	}
+
+	if(type != BdfTypes::LIST) {
+		return nullptr;
+	}
+
+	// Otherwise find the key in each row, skipping over everything else
+	std::vector<BdfObject*> values;
+
+	for(int pos=0;pos<payload_size;)
+	{
+		int row_size = BdfObject::getCheckedSize(payload + pos, payload_size - pos);
+
+		if(row_size == -1) {
+			break;
+		}
+
+		const char* row = payload + pos;
+		BdfObject* value = nullptr;
+
+		pos += row_size;
+
+		char row_type, row_size_tag;
+		BdfObject::getFlagData(row, &row_type, &row_size_tag, NULL);
+
+		int row_offset = 1 + BdfObject::getSizeBytes(row_size_tag);
+
+		for(int i=row_offset;row_type == BdfTypes::NAMED_LIST && i<row_size;)
+		{
+			int object_size = BdfObject::getCheckedSize(row + i, row_size - i);
+
+			char key_size_tag;
+			BdfObject::getFlagData(row + i, NULL, NULL, &key_size_tag);
+			int key_size = BdfObject::getSizeBytes(key_size_tag);
+
+			if(object_size == -1 || i + object_size + key_size > row_size) {
+				break;
+			}
+
+			const char* key_data = row + i + object_size;
+			int object_key = 0;
+
+			switch(key_size_tag)
+			{
+				case 2:
+					object_key = key_data[0] & 255;
+					break;
+				case 1:
+					object_key = get_netus(key_data);
+					break;
+				case 0:
+					object_key = get_netsi(key_data);
+					break;
+			}
+
+			if(object_key == key) {
+				value = lookupTable->pool.create<BdfObject>(lookupTable, row + i, object_size);
+				break;
+			}
+
+			i += object_size + key_size;
+		}
+
+		if(value == nullptr) {
+			value = lookupTable->pool.create<BdfObject>(lookupTable);
+		}
+
+		values.push_back(value);
+	}
+
+	BdfObject* array = createArray(lookupTable, values);
+
+	if(array != nullptr)
+	{
+		for(BdfObject* value : values) {
+			delete value;
+		}
+
+		return array;
+	}
+
+	BdfList* list = lookupTable->pool.create<BdfList>(lookupTable);
+
+	for(BdfObject* value : values) {
+		list->add(value);
+	}
+
+	return lookupTable->pool.create<BdfObject>(lookupTable)->setList(list);
+}
@@ -0,0 +1,598 @@
+
+#include "../include/Bdf.hpp"
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string.h>
+
+#ifdef BDF_HAS_ZLIB
+	#include <zlib.h>
+#endif
+
+#ifdef BDF_HAS_LZMA
+	#include <lzma.h>
+#endif
+
+#ifdef BDF_HAS_ZSTD
+	#include <zstd.h>
+#endif
+
+using namespace Bdf;
+
+// Size of the chunks read from and written to streams
+const size_t COMPRESSION_CHUNK_SIZE = 65536;
+
+namespace Bdf
+{
+	/**
+	 * Holds the state of whichever codec a Compressor or Decompressor is using.
+	 * @internal
+	 */
+	class BdfCompressionState
+	{
+	public:
+		BdfCompression::Codec codec;
+
+		// Compressed input not yet consumed by the codec (used by NONE and ZSTD)
+		const char* next_in = nullptr;
+		size_t avail_in = 0;
+
+		#ifdef BDF_HAS_ZLIB
+		z_stream zlib;
+		#endif
+
+		#ifdef BDF_HAS_LZMA
+		lzma_stream lzma = LZMA_STREAM_INIT;
+		#endif
+
+		#ifdef BDF_HAS_ZSTD
+		ZSTD_DStream* zstd_d = nullptr;
+		ZSTD_CStream* zstd_c = nullptr;
+		#endif
+	};
+}
+
+static std::runtime_error unsupportedCodec(BdfCompression::Codec codec)
+{
+	const char* names[] = {"none", "gzip", "xz", "zstd", "auto"};
+
+	return std::runtime_error(std::string("Support for ") + names[codec] + " compression was not compiled into this library.");
+}
+
+bool BdfCompression::isSupported(Codec codec) noexcept
+{
+	switch(codec)
+	{
+		case Codec::NONE:
+		case Codec::AUTO:
+			return true;
+		#ifdef BDF_HAS_ZLIB
+		case Codec::GZIP:
+			return true;
+		#endif
+		#ifdef BDF_HAS_LZMA
+		case Codec::XZ:
+			return true;
+		#endif
+		#ifdef BDF_HAS_ZSTD
+		case Codec::ZSTD:
+			return true;
+		#endif
+		default:
+			return false;
+	}
+}
+
+BdfCompression::Codec BdfCompression::detect(const char* data, size_t size) noexcept
+{
+	const unsigned char* d = (const unsigned char*)data;
+
+	if(size >= 2 && d[0] == 0x1f && d[1] == 0x8b) {
+		return Codec::GZIP;
+	}
+
+	if(size >= 6 && memcmp(d, "\xfd" "7zXZ\0", 6) == 0) {
+		return Codec::XZ;
+	}
+
+	if(size >= 4 && d[0] == 0x28 && d[1] == 0xb5 && d[2] == 0x2f && d[3] == 0xfd) {
+		return Codec::ZSTD;
+	}
+
+	return Codec::NONE;
+}
+
+// Decompressor
+
+BdfCompression::Decompressor::Decompressor(std::istream &pStream, Codec codec)
+{
+	stream = &pStream;
+	input = new char[COMPRESSION_CHUNK_SIZE];
+	finished = false;
+	state = new BdfCompressionState();
+	state->codec = Codec::NONE;
+
+	// Read the first chunk to find the magic bytes
+	if(codec == Codec::AUTO) {
+		fill();
+		codec = detect(state->next_in, state->avail_in);
+	}
+
+	if(!isSupported(codec)) {
+		delete state;
+		delete[] input;
+		throw unsupportedCodec(codec);
+	}
+
+	state->codec = codec;
+
+	switch(codec)
+	{
+		#ifdef BDF_HAS_ZLIB
+		case Codec::GZIP:
+		{
+			memset(&state->zlib, 0, sizeof(z_stream));
+			state->zlib.next_in = (Bytef*)state->next_in;
+			state->zlib.avail_in = state->avail_in;
+
+			// 15 + 32 detects both gzip and zlib headers
+			if(inflateInit2(&state->zlib, 15 + 32) != Z_OK) {
+				delete state;
+				delete[] input;
+				throw std::runtime_error("Could not initialise the gzip decompressor.");
+			}
+
+			break;
+		}
+		#endif
+
+		#ifdef BDF_HAS_LZMA
+		case Codec::XZ:
+		{
+			state->lzma.next_in = (const uint8_t*)state->next_in;
+			state->lzma.avail_in = state->avail_in;
+
+			if(lzma_stream_decoder(&state->lzma, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) {
+				delete state;
+				delete[] input;
+				throw std::runtime_error("Could not initialise the xz decompressor.");
+			}
+
+			break;
+		}
+		#endif
+
+		#ifdef BDF_HAS_ZSTD
+		case Codec::ZSTD:
+		{
+			state->zstd_d = ZSTD_createDStream();
+
+			if(state->zstd_d == nullptr || ZSTD_isError(ZSTD_initDStream(state->zstd_d))) {
+				ZSTD_freeDStream(state->zstd_d);
+				delete state;
+				delete[] input;
+				throw std::runtime_error("Could not initialise the zstd decompressor.");
+			}
+
+			break;
+		}
+		#endif
+
+		default:
+			break;
+	}
+}
+
+BdfCompression::Decompressor::~Decompressor()
+{
+	switch(state->codec)
+	{
+		#ifdef BDF_HAS_ZLIB
+		case Codec::GZIP:
+			inflateEnd(&state->zlib);
+			break;
+		#endif
+		#ifdef BDF_HAS_LZMA
+		case Codec::XZ:
+			lzma_end(&state->lzma);
+			break;
+		#endif
+		#ifdef BDF_HAS_ZSTD
+		case Codec::ZSTD:
+			ZSTD_freeDStream(state->zstd_d);
+			break;
+		#endif
+		default:
+			break;
+	}
+
+	delete state;
+	delete[] input;
+}
+
+bool BdfCompression::Decompressor::fill()
+{
+	if(!stream->good()) {
+		return false;
+	}
+
+	stream->read(input, COMPRESSION_CHUNK_SIZE);
+	size_t size = stream->gcount();
+
+	state->next_in = input;
+	state->avail_in = size;
+
+	return size > 0;
+}
+
+BdfCompression::Codec BdfCompression::Decompressor::getCodec() const noexcept {
+	return state->codec;
+}
+
+size_t BdfCompression::Decompressor::read(char* data, size_t size)
+{
+	size_t upto = 0;
+
+	while(upto < size && !finished)
+	{
+		switch(state->codec)
+		{
+			#ifdef BDF_HAS_ZLIB
+			case Codec::GZIP:
+			{
+				z_stream* z = &state->zlib;
+
+				if(z->avail_in == 0)
+				{
+					if(!fill()) {
+						finished = true;
+						break;
+					}
+
+					z->next_in = (Bytef*)state->next_in;
+					z->avail_in = state->avail_in;
+				}
+
+				z->next_out = (Bytef*)(data + upto);
+				z->avail_out = size - upto;
+
+				int result = inflate(z, Z_NO_FLUSH);
+				upto = size - z->avail_out;
+
+				if(result == Z_STREAM_END)
+				{
+					// Concatenated gzip members are read as one stream
+					if(z->avail_in == 0 && !fill()) {
+						finished = true;
+					} else {
+						if(z->avail_in == 0) {
+							z->next_in = (Bytef*)state->next_in;
+							z->avail_in = state->avail_in;
+						}
+
+						inflateReset(z);
+					}
+				}
+
+				else if(result != Z_OK && result != Z_BUF_ERROR) {
+					throw std::runtime_error(std::string("Corrupt gzip data: ") + (z->msg ? z->msg : "unknown error"));
+				}
+
+				break;
+			}
+			#endif
+
+			#ifdef BDF_HAS_LZMA
+			case Codec::XZ:
+			{
+				lzma_stream* s = &state->lzma;
+				lzma_action action = LZMA_RUN;
+
+				if(s->avail_in == 0)
+				{
+					if(fill()) {
+						s->next_in = (const uint8_t*)state->next_in;
+						s->avail_in = state->avail_in;
+					} else {
+						action = LZMA_FINISH;
+					}
+				}
+
+				s->next_out = (uint8_t*)(data + upto);
+				s->avail_out = size - upto;
+
+				lzma_ret result = lzma_code(s, action);
+				upto = size - s->avail_out;
+
+				if(result == LZMA_STREAM_END) {
+					finished = true;
+				} else if(result != LZMA_OK && result != LZMA_BUF_ERROR) {
+					throw std::runtime_error("Corrupt xz data (liblzma error " + std::to_string(result) + ").");
+				} else if(action == LZMA_FINISH && result == LZMA_BUF_ERROR) {
+					finished = true;
+				}
+
+				break;
+			}
+			#endif
+
+			#ifdef BDF_HAS_ZSTD
+			case Codec::ZSTD:
+			{
+				if(state->avail_in == 0 && !fill()) {
+					finished = true;
+					break;
+				}
+
+				ZSTD_inBuffer in = {state->next_in, state->avail_in, 0};
+				ZSTD_outBuffer out = {data + upto, size - upto, 0};
+
+				size_t result = ZSTD_decompressStream(state->zstd_d, &out, &in);
+
+				if(ZSTD_isError(result)) {
+					throw std::runtime_error(std::string("Corrupt zstd data: ") + ZSTD_getErrorName(result));
+				}
+
+				state->next_in += in.pos;
+				state->avail_in -= in.pos;
+				upto += out.pos;
+
+				break;
+			}
+			#endif
+
+			default:
+			{
+				// Uncompressed data left over from detecting the codec is used first
+				if(state->avail_in > 0)
+				{
+					size_t amount = std::min(state->avail_in, size - upto);
+					memcpy(data + upto, state->next_in, amount);
+
+					state->next_in += amount;
+					state->avail_in -= amount;
+					upto += amount;
+
+					break;
+				}
+
+				stream->read(data + upto, size - upto);
+				size_t amount = stream->gcount();
+				upto += amount;
+
+				if(amount == 0 || !stream->good()) {
+					finished = true;
+				}
+
+				break;
+			}
+		}
+	}
+
+	return upto;
+}
+
+// Compressor
+
+BdfCompression::Compressor::Compressor(std::ostream &pStream, Codec codec, int level)
+{
+	if(codec == Codec::AUTO)
+	{
+		Codec fastest[] = {Codec::ZSTD, Codec::GZIP, Codec::XZ, Codec::NONE};
+
+		for(Codec option : fastest)
+		{
+			if(isSupported(option)) {
+				codec = option;
+				break;
+			}
+		}
+	}
+
+	if(!isSupported(codec)) {
+		throw unsupportedCodec(codec);
+	}
+
+	stream = &pStream;
+	output = new char[COMPRESSION_CHUNK_SIZE];
+	finished = false;
+	state = new BdfCompressionState();
+	state->codec = codec;
+
+	switch(codec)
+	{
+		#ifdef BDF_HAS_ZLIB
+		case Codec::GZIP:
+		{
+			memset(&state->zlib, 0, sizeof(z_stream));
+
+			// 15 + 16 writes a gzip header instead of a zlib header
+			if(deflateInit2(&state->zlib, level == -1 ? Z_DEFAULT_COMPRESSION : level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+				delete state;
+				delete[] output;
+				throw std::runtime_error("Could not initialise the gzip compressor.");
+			}
+
+			break;
+		}
+		#endif
+
+		#ifdef BDF_HAS_LZMA
+		case Codec::XZ:
+		{
+			if(lzma_easy_encoder(&state->lzma, level == -1 ? LZMA_PRESET_DEFAULT : level, LZMA_CHECK_CRC64) != LZMA_OK) {
+				delete state;
+				delete[] output;
+				throw std::runtime_error("Could not initialise the xz compressor.");
+			}
+
+			break;
+		}
+		#endif
+
+		#ifdef BDF_HAS_ZSTD
+		case Codec::ZSTD:
+		{
+			state->zstd_c = ZSTD_createCStream();
+
+			if(state->zstd_c == nullptr || ZSTD_isError(ZSTD_CCtx_setParameter(state->zstd_c, ZSTD_c_compressionLevel,
+					level == -1 ? ZSTD_CLEVEL_DEFAULT : level)))
+			{
+				ZSTD_freeCStream(state->zstd_c);
+				delete state;
+				delete[] output;
+				throw std::runtime_error("Could not initialise the zstd compressor.");
+			}
+
+			break;
+		}
+		#endif
+
+		default:
+			break;
+	}
+}
+
+BdfCompression::Compressor::~Compressor()
+{
+	switch(state->codec)
+	{
+		#ifdef BDF_HAS_ZLIB
+		case Codec::GZIP:
+			deflateEnd(&state->zlib);
+			break;
+		#endif
+		#ifdef BDF_HAS_LZMA
+		case Codec::XZ:
+			lzma_end(&state->lzma);
+			break;
+		#endif
+		#ifdef BDF_HAS_ZSTD
+		case Codec::ZSTD:
+			ZSTD_freeCStream(state->zstd_c);
+			break;
+		#endif
+		default:
+			break;
+	}
+
+	delete state;
+	delete[] output;
+}
+
+/*
+ * Runs the codec over size bytes at data (which may be empty), writing all
+ * output produced to stream. If end is true, the compressed stream is ended.
+ */
+static void compressChunks(BdfCompressionState* state, std::ostream* stream, char* output, const char* data, size_t size, bool end)
+{
+	switch(state->codec)
+	{
+		#ifdef BDF_HAS_ZLIB
+		case BdfCompression::Codec::GZIP:
+		{
+			z_stream* z = &state->zlib;
+			z->next_in = (Bytef*)data;
+			z->avail_in = size;
+
+			for(;;)
+			{
+				z->next_out = (Bytef*)output;
+				z->avail_out = COMPRESSION_CHUNK_SIZE;
+
+				int result = deflate(z, end ? Z_FINISH : Z_NO_FLUSH);
+				stream->write(output, COMPRESSION_CHUNK_SIZE - z->avail_out);
+
+				if(result == Z_STREAM_ERROR) {
+					throw std::runtime_error("gzip compression failed.");
+				}
+
+				if(end ? (result == Z_STREAM_END) : (z->avail_in == 0 && z->avail_out != 0)) {
+					break;
+				}
+			}
+
+			return;
+		}
+		#endif
+
+		#ifdef BDF_HAS_LZMA
+		case BdfCompression::Codec::XZ:
+		{
+			lzma_stream* s = &state->lzma;
+			s->next_in = (const uint8_t*)data;
+			s->avail_in = size;
+
+			for(;;)
+			{
+				s->next_out = (uint8_t*)output;
+				s->avail_out = COMPRESSION_CHUNK_SIZE;
+
+				lzma_ret result = lzma_code(s, end ? LZMA_FINISH : LZMA_RUN);
+				stream->write(output, COMPRESSION_CHUNK_SIZE - s->avail_out);
+
+				if(result != LZMA_OK && result != LZMA_STREAM_END) {
+					throw std::runtime_error("xz compression failed (liblzma error " + std::to_string(result) + ").");
+				}
+
+				if(end ? (result == LZMA_STREAM_END) : (s->avail_in == 0 && s->avail_out != 0)) {
+					break;
+				}
+			}
+
+			return;
+		}
+		#endif
+
+		#ifdef BDF_HAS_ZSTD
+		case BdfCompression::Codec::ZSTD:
+		{
+			ZSTD_inBuffer in = {data, size, 0};
+
+			for(;;)
+			{
+				ZSTD_outBuffer out = {output, COMPRESSION_CHUNK_SIZE, 0};
+
+				size_t remaining = ZSTD_compressStream2(state->zstd_c, &out, &in, end ? ZSTD_e_end : ZSTD_e_continue);
+				stream->write(output, out.pos);
+
+				if(ZSTD_isError(remaining)) {
+					throw std::runtime_error(std::string("zstd compression failed: ") + ZSTD_getErrorName(remaining));
+				}
+
+				if(end ? (remaining == 0) : (in.pos == in.size)) {
+					break;
+				}
+			}
+
+			return;
+		}
+		#endif
+
+		default:
+			stream->write(data, size);
+			return;
+	}
+}
+
+void BdfCompression::Compressor::write(const char* data, size_t size)
+{
+	if(finished) {
+		throw std::logic_error("Cannot write to a compressor after finish() has been called.");
+	}
+
+	if(size > 0) {
+		compressChunks(state, stream, output, data, size, false);
+	}
+}
+
+void BdfCompression::Compressor::finish()
+{
+	if(finished) {
+		return;
+	}
+
+	compressChunks(state, stream, output, nullptr, 0, true);
+	stream->flush();
+	finished = true;
+}
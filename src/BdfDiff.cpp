@@ -0,0 +1,576 @@
+
+#include "../include/Bdf.hpp"
+#include "../include/BdfHelpers.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <unordered_map>
+#include <string.h>
+
+using namespace Bdf;
+using namespace BdfHelpers;
+
+static bool isSameDiffObject(const BdfObject* from, const BdfObject* to)
+{
+	if(from == nullptr || to == nullptr) {
+		return from == to;
+	}
+
+	return from->hash() == to->hash();
+}
+
+void BdfDiff::initChanges()
+{
+	BdfObject* root = changes.getObject();
+
+	list = root->getList();
+	operationKey = root->getKeyLocation("op");
+	pathKey = root->getKeyLocation("path");
+	valueKey = root->getKeyLocation("value");
+}
+
+BdfDiff::BdfDiff(const BdfObject* from, const BdfObject* to)
+{
+	initChanges();
+
+	std::vector<BdfPath::Step> path;
+	diff(path, from, to);
+}
+
+BdfDiff::BdfDiff(BdfReader* from, BdfReader* to) : BdfDiff(from->getObject(), to->getObject()) {
+}
+
+BdfDiff::BdfDiff(const char* data, int size) : changes(data, size)
+{
+	if(changes.getObject()->getType() != BdfTypes::LIST) {
+		throw std::invalid_argument("The data is not a BDF patch.");
+	}
+
+	initChanges();
+
+	// Check every change once, so apply() only has to check them against the document
+	for(BdfList::Item* item = list->startItem; item != nullptr; item = item->next)
+	{
+		if(item->object == nullptr || item->object->type != BdfTypes::NAMED_LIST) {
+			throw std::invalid_argument("The data is not a BDF patch.");
+		}
+
+		BdfNamedList* change = (BdfNamedList*)item->object->object;
+		BdfObject* operation = getChangeField(change, operationKey);
+		BdfObject* path = getChangeField(change, pathKey);
+		BdfObject* value = getChangeField(change, valueKey);
+
+		if(operation == nullptr || operation->type != BdfTypes::BYTE || operation->data[0] > INSERT ||
+				path == nullptr || path->type != BdfTypes::LIST) {
+			throw std::invalid_argument("The data is not a BDF patch.");
+		}
+
+		BdfList::Item* step = ((BdfList*)path->object)->startItem;
+		BdfList::Item* last = nullptr;
+
+		for(; step != nullptr; step = step->next)
+		{
+			if(step->object == nullptr || (step->object->type != BdfTypes::STRING && step->object->type != BdfTypes::LONG)) {
+				throw std::invalid_argument("The data is not a BDF patch.");
+			}
+
+			last = step;
+		}
+
+		switch(operation->data[0])
+		{
+			case SET:
+				if(value == nullptr) {
+					throw std::invalid_argument("A change that sets an object has no value.");
+				}
+
+				break;
+			case REMOVE:
+				if(last == nullptr) {
+					throw std::invalid_argument("A change that removes an object has an empty path.");
+				}
+
+				break;
+			case INSERT:
+				if(value == nullptr || last == nullptr || last->object->type != BdfTypes::LONG) {
+					throw std::invalid_argument("A change that inserts an object doesn't have a value and a list index.");
+				}
+
+				break;
+		}
+	}
+}
+
+size_t BdfDiff::size() const noexcept
+{
+	size_t size = 0;
+
+	for(BdfList::Item* item = list->startItem; item != nullptr; item = item->next) {
+		size += 1;
+	}
+
+	return size;
+}
+
+void BdfDiff::diff(std::vector<BdfPath::Step> &path, const BdfObject* from, const BdfObject* to)
+{
+	// Subtrees with the same hash are unchanged, so they are skipped without comparing them
+	if(isSameDiffObject(from, to)) {
+		return;
+	}
+
+	if(from == nullptr || to == nullptr || from->type != to->type || from->object == NULL || to->object == NULL) {
+		addChange(SET, path, to);
+		return;
+	}
+
+	switch(to->type)
+	{
+		case BdfTypes::LIST:
+			diffLists(path, (BdfList*)from->object, (BdfList*)to->object);
+			return;
+		case BdfTypes::NAMED_LIST:
+			diffNamedLists(path, (BdfNamedList*)from->object, (BdfNamedList*)to->object);
+			return;
+		default:
+			addChange(SET, path, to);
+	}
+}
+
+void BdfDiff::diffLists(std::vector<BdfPath::Step> &path, const BdfList* from, const BdfList* to)
+{
+	BdfList::Item* from_item = from->startItem;
+	BdfList::Item* to_item = to->startItem;
+	uint64_t index = 0;
+
+	// Skip the items both lists start with
+	while(from_item != nullptr && to_item != nullptr && isSameDiffObject(from_item->object, to_item->object))
+	{
+		from_item = from_item->next;
+		to_item = to_item->next;
+		index += 1;
+	}
+
+	if(from_item == nullptr && to_item == nullptr) {
+		return;
+	}
+
+	uint64_t from_left = 0;
+	uint64_t to_left = 0;
+
+	for(BdfList::Item* item = from_item; item != nullptr; item = item->next) {
+		from_left += 1;
+	}
+
+	for(BdfList::Item* item = to_item; item != nullptr; item = item->next) {
+		to_left += 1;
+	}
+
+	// Skip the items both lists end with, so inserting or removing items in the middle of
+	// a list only adds a change for each item inserted or removed
+	BdfList::Item* from_last = from->endItem;
+	BdfList::Item* to_last = to->endItem;
+
+	while(from_left > 0 && to_left > 0 && isSameDiffObject(from_last->object, to_last->object))
+	{
+		from_last = from_last->last;
+		to_last = to_last->last;
+		from_left -= 1;
+		to_left -= 1;
+	}
+
+	// Diff the items left in both lists by position
+	uint64_t paired = (from_left < to_left) ? from_left : to_left;
+	BdfPath::Step step;
+	step.isIndex = true;
+
+	for(uint64_t i = 0; i < paired; i++)
+	{
+		step.index = index + i;
+		path.push_back(step);
+		diff(path, from_item->object, to_item->object);
+		path.pop_back();
+
+		from_item = from_item->next;
+		to_item = to_item->next;
+	}
+
+	// Remove the items only from has, starting from the end so the indicies before them don't change
+	for(uint64_t i = from_left; i > paired; i--)
+	{
+		step.index = index + i - 1;
+		path.push_back(step);
+		addChange(REMOVE, path, nullptr);
+		path.pop_back();
+	}
+
+	// Insert the items only to has
+	for(uint64_t i = paired; i < to_left; i++)
+	{
+		step.index = index + i;
+		path.push_back(step);
+		addChange(INSERT, path, to_item->object);
+		path.pop_back();
+
+		to_item = to_item->next;
+	}
+}
+
+void BdfDiff::diffNamedLists(std::vector<BdfPath::Step> &path, const BdfNamedList* from, const BdfNamedList* to)
+{
+	// Match the items by key name, since both named lists can use different lookup tables
+	std::unordered_map<std::string, BdfNamedList::Item*> from_items;
+
+	for(BdfNamedList::Item* item = from->start; item != NULL; item = item->next) {
+		from_items[from->lookupTable->getName(item->key)] = item;
+	}
+
+	BdfPath::Step step;
+	step.index = 0;
+	step.isIndex = false;
+
+	for(BdfNamedList::Item* item = to->start; item != NULL; item = item->next)
+	{
+		step.key = to->lookupTable->getName(item->key);
+		path.push_back(step);
+
+		auto found = from_items.find(step.key);
+
+		if(found == from_items.end()) {
+			addChange(SET, path, item->object);
+		} else {
+			diff(path, found->second->object, item->object);
+			from_items.erase(found);
+		}
+
+		path.pop_back();
+	}
+
+	if(from_items.empty()) {
+		return;
+	}
+
+	// Remove the keys only from has, in the order they are stored in
+	for(BdfNamedList::Item* item = from->start; item != NULL; item = item->next)
+	{
+		step.key = from->lookupTable->getName(item->key);
+
+		if(from_items.count(step.key) != 0)
+		{
+			path.push_back(step);
+			addChange(REMOVE, path, nullptr);
+			path.pop_back();
+		}
+	}
+}
+
+void BdfDiff::addChange(Operation operation, const std::vector<BdfPath::Step> &path, const BdfObject* value)
+{
+	BdfObject* root = changes.getObject();
+	BdfNamedList* change = root->newNamedList();
+	BdfList* steps = root->newList();
+
+	for(const BdfPath::Step &step : path)
+	{
+		if(step.isIndex) {
+			steps->add(root->newObject()->setLong(step.index));
+		} else {
+			steps->add(root->newObject()->setString(step.key));
+		}
+	}
+
+	change->set(operationKey, root->newObject()->setByte(operation));
+	change->set(pathKey, root->newObject()->setList(steps));
+
+	if(operation != REMOVE) {
+		change->set(valueKey, copyObject(value, root->lookupTable, copiedKeys));
+	}
+
+	list->add(root->newObject()->setNamedList(change));
+}
+
+BdfObject* BdfDiff::getChangeField(BdfNamedList* change, int key) const noexcept
+{
+	for(BdfNamedList::Item* item = change->start; item != NULL; item = item->next)
+	{
+		if(item->key == key) {
+			return item->object;
+		}
+	}
+
+	return nullptr;
+}
+
+void BdfDiff::apply(BdfReader* reader) const {
+	apply(reader->getObject());
+}
+
+void BdfDiff::apply(BdfObject* root) const
+{
+	// The locations in root's lookup table of the keys copied from the values in the patch
+	std::vector<int> keys;
+
+	// Changes to a copy of a shared root are made to the copy, which is then held where root was
+	root = root->unshare();
+
+	for(BdfList::Item* item = list->startItem; item != nullptr; item = item->next) {
+		applyChange(root, (BdfNamedList*)item->object->object, keys);
+	}
+}
+
+void BdfDiff::applyChange(BdfObject* root, BdfNamedList* change, std::vector<int> &keys) const
+{
+	char operation = getChangeField(change, operationKey)->data[0];
+	BdfList* steps = (BdfList*)getChangeField(change, pathKey)->object;
+	BdfObject* value = getChangeField(change, valueKey);
+	BdfObject* parent = root;
+	BdfList::Item* step = steps->startItem;
+
+	// An empty path replaces the root object with a copy of value
+	if(step == nullptr)
+	{
+		BdfObject* copy = copyObject(value, root->lookupTable, keys);
+
+		root->freeAll();
+		root->type = copy->type;
+		root->object = copy->object;
+		root->interned = copy->interned;
+		root->data = copy->data;
+		root->s = copy->s;
+		root->data_capacity = copy->data_capacity;
+
+		if(root->type == BdfTypes::LIST && root->object != NULL) {
+			((BdfList*)root->object)->owner = root;
+		} else if(root->type == BdfTypes::NAMED_LIST && root->object != NULL) {
+			((BdfNamedList*)root->object)->owner = root;
+		}
+
+		copy->type = BdfTypes::UNDEFINED;
+		copy->object = NULL;
+		copy->interned = false;
+		copy->data = NULL;
+
+		BdfObject::release(copy);
+		return;
+	}
+
+	// Find the object the last step of the path is in
+	for(; parent != nullptr && step->next != nullptr; step = step->next)
+	{
+		BdfObject* key = step->object;
+
+		if(key->type == BdfTypes::LONG)
+		{
+			uint64_t index = get_netul(key->data);
+			BdfList::Item* item = nullptr;
+
+			if(parent->type == BdfTypes::LIST && parent->object != NULL) {
+				item = ((BdfList*)parent->object)->startItem;
+			}
+
+			for(uint64_t i = 0; i < index && item != nullptr; i++) {
+				item = item->next;
+			}
+
+			parent = (item == nullptr) ? nullptr : item->object;
+		}
+
+		else
+		{
+			int location = root->lookupTable->findLocation(*(std::string*)key->object);
+			BdfNamedList::Item* item = nullptr;
+
+			if(parent->type == BdfTypes::NAMED_LIST && parent->object != NULL && location != -1) {
+				item = ((BdfNamedList*)parent->object)->start;
+			}
+
+			while(item != nullptr && item->key != location) {
+				item = item->next;
+			}
+
+			parent = (item == nullptr) ? nullptr : item->object;
+		}
+	}
+
+	BdfObject* key = step->object;
+	bool found = false;
+
+	if(parent != nullptr && key->type == BdfTypes::LONG && parent->type == BdfTypes::LIST && parent->object != NULL)
+	{
+		BdfList* target = (BdfList*)parent->object;
+		uint64_t index = get_netul(key->data);
+		uint64_t size = target->size();
+
+		if(index < size || (operation == INSERT && index == size))
+		{
+			found = true;
+
+			switch(operation)
+			{
+				case SET:
+					target->set((int)index, copyObject(value, root->lookupTable, keys));
+					break;
+				case REMOVE:
+					target->remove((int)index);
+					break;
+				case INSERT:
+					if(index == size) {
+						target->add(copyObject(value, root->lookupTable, keys));
+					} else {
+						target->insertLast(index, copyObject(value, root->lookupTable, keys));
+					}
+
+					break;
+			}
+		}
+	}
+
+	else if(parent != nullptr && key->type == BdfTypes::STRING && parent->type == BdfTypes::NAMED_LIST && parent->object != NULL)
+	{
+		BdfNamedList* target = (BdfNamedList*)parent->object;
+		const std::string &name = *(std::string*)key->object;
+
+		if(operation == SET)
+		{
+			found = true;
+			target->set((int)root->lookupTable->getLocation(name), copyObject(value, root->lookupTable, keys));
+		}
+
+		else if(operation == REMOVE)
+		{
+			int location = root->lookupTable->findLocation(name);
+
+			if(location != -1 && target->exists(location))
+			{
+				found = true;
+				target->remove(location);
+			}
+		}
+	}
+
+	if(!found)
+	{
+		BdfPath path;
+
+		for(BdfList::Item* item = steps->startItem; item != nullptr; item = item->next)
+		{
+			BdfPath::Step path_step;
+			path_step.isIndex = (item->object->type == BdfTypes::LONG);
+			path_step.index = path_step.isIndex ? get_netul(item->object->data) : 0;
+			path_step.key = path_step.isIndex ? "" : *(std::string*)item->object->object;
+
+			path.steps.push_back(path_step);
+		}
+
+		throw std::out_of_range("The patch does not match the document at " + path.toString());
+	}
+}
+
+BdfObject* BdfDiff::copyObject(const BdfObject* object, BdfLookupTable* lookupTable, std::vector<int> &keys)
+{
+	BdfObject* copy = lookupTable->pool.create<BdfObject>(lookupTable);
+
+	if(object == nullptr) {
+		return copy;
+	}
+
+	try
+	{
+		switch(object->type)
+		{
+			case BdfTypes::UNDEFINED:
+				break;
+			case BdfTypes::STRING:
+				copy->setString((object->object == NULL) ? std::string() : *(std::string*)object->object);
+				break;
+			case BdfTypes::LIST:
+			{
+				BdfList* list = lookupTable->pool.create<BdfList>(lookupTable);
+				copy->setList(list);
+
+				if(object->object == NULL) {
+					break;
+				}
+
+				for(BdfList::Item* item = ((BdfList*)object->object)->startItem; item != nullptr; item = item->next) {
+					list->add(copyObject(item->object, lookupTable, keys));
+				}
+
+				break;
+			}
+			case BdfTypes::NAMED_LIST:
+			{
+				BdfNamedList* named = lookupTable->pool.create<BdfNamedList>(lookupTable);
+				copy->setNamedList(named);
+
+				if(object->object == NULL) {
+					break;
+				}
+
+				BdfNamedList* source = (BdfNamedList*)object->object;
+
+				for(BdfNamedList::Item* item = source->start; item != NULL; item = item->next)
+				{
+					int key = item->key;
+
+					// Keys are copied by name the first time they are seen
+					if(source->lookupTable != lookupTable)
+					{
+						if((size_t)key >= keys.size()) {
+							keys.resize(key + 1, -1);
+						}
+
+						if(keys[key] == -1) {
+							keys[key] = lookupTable->getLocation(source->lookupTable->getName(key));
+						}
+
+						key = keys[key];
+					}
+
+					// Keys are unique within a named list, so the item can be added to the end without searching
+					BdfObject* value = copyObject(item->object, lookupTable, keys);
+
+					BdfNamedList::Item* copied = lookupTable->pool.create<BdfNamedList::Item>(key, value, nullptr);
+					lookupTable->addKeyUse(key);
+
+					*named->end = copied;
+					named->end = &copied->next;
+					named->adopt(value);
+				}
+
+				break;
+			}
+			default:
+				copy->type = object->type;
+				copy->s = (object->data == NULL) ? 0 : object->s;
+
+				BDF_STATS_ALLOC(lookupTable->stats, copy->s);
+				copy->data = copy->newData(copy->s);
+
+				if(copy->s > 0) {
+					memcpy(copy->data, object->data, copy->s);
+				}
+		}
+	}
+
+	catch(...)
+	{
+		BdfObject::release(copy);
+		throw;
+	}
+
+	return copy;
+}
+
+void BdfDiff::serialize(char** pData, int* pSize) {
+	changes.serialize(pData, pSize);
+}
+
+void BdfDiff::serialize(char** pData, int* pSize, const BdfSerializeOptions &options) {
+	changes.serialize(pData, pSize, options);
+}
+
+void BdfDiff::serializeHumanReadable(std::ostream &stream, const BdfIndent &indent) {
+	changes.serializeHumanReadable(stream, indent);
+}
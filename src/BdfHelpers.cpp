@@ -229,3 +229,101 @@ double BdfHelpers::get_netd(const char* data)
 	return *(double*)&num;
 }
 
+int BdfHelpers::varintSize(uint64_t num)
+{
+	int size = 1;
+
+	while(num > 127) {
+		num >>= 7;
+		size += 1;
+	}
+
+	return size;
+}
+
+int BdfHelpers::put_varint(char* data, uint64_t num)
+{
+	int size = 0;
+
+	while(num > 127) {
+		data[size++] = (char)((num & 127) | 128);
+		num >>= 7;
+	}
+
+	data[size++] = (char)num;
+
+	return size;
+}
+
+int BdfHelpers::get_varint(const char* data, int size, uint64_t* num)
+{
+	uint64_t v = 0;
+
+	// A 64 bit number never needs more than 10 bytes
+	for(int i=0;i<size && i<10;i++)
+	{
+		uint64_t b = data[i] & 255;
+		v |= (b & 127) << (i * 7);
+
+		if(b < 128) {
+			*num = v;
+			return i + 1;
+		}
+	}
+
+	return -1;
+}
+
+uint64_t BdfHelpers::hash_mix(uint64_t h)
+{
+	// The finaliser of MurmurHash3
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+
+	return h;
+}
+
+uint64_t BdfHelpers::hash_bytes(const char* data, size_t size, uint64_t seed)
+{
+	const uint64_t m = 0xc6a4a7935bd1e995ULL;
+	uint64_t h = seed ^ (size * m);
+	size_t i = 0;
+
+	// Read 8 bytes at a time in network order, so the hash is the same on every platform
+	for(; i + 8 <= size; i += 8)
+	{
+		uint64_t k = get_netul(data + i);
+
+		k *= m;
+		k ^= k >> 47;
+		k *= m;
+
+		h ^= k;
+		h *= m;
+	}
+
+	if(i < size)
+	{
+		uint64_t k = 0;
+
+		for(; i < size; i++) {
+			k = (k << 8) | (uint8_t)data[i];
+		}
+
+		h ^= k;
+		h *= m;
+	}
+
+	return hash_mix(h);
+}
+
+void BdfHelpers::addStatsTime(uint64_t* total, std::chrono::steady_clock::time_point* timer)
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	*total += std::chrono::duration_cast<std::chrono::nanoseconds>(now - *timer).count();
+	*timer = now;
+}
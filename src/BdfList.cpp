@@ -14,29 +14,26 @@ BdfList::BdfList(BdfLookupTable* lookupTable, const char* data, int size)
 	this->startItem = nullptr;
 	this->endItem = nullptr;
 	this->endptr = &this->startItem;
+	this->lookupTable = lookupTable;
+	this->owner = nullptr;
+	this->columns = nullptr;
+
+	BDF_STATS_ALLOC(lookupTable->stats, sizeof(BdfList));
 		
 	int i = 0;
 
 	while(i < size)
 	{
-		char object_size_tag;
-		BdfObject::getFlagData(data, nullptr, &object_size_tag, nullptr);
-
-		char object_size_bytes = BdfObject::getSizeBytes(object_size_tag);
-		
-		if(i + object_size_bytes >= size) {
-			return;
-		}
-
-		// Get the size of the object
-		int object_size = BdfObject::getSize(data + i);
+		// Get the size of the object. Primitives have no size tag, so only
+		// objects that store one need their size tag to fit.
+		int object_size = BdfObject::getCheckedSize(data + i, size - i);
 	
-		if(object_size <= 0 || i + object_size > size) {
+		if(object_size == -1) {
 			return;
 		}
 
 		// Add the object to the elements list
-		add(new BdfObject(lookupTable, data + i, object_size));
+		add(lookupTable->pool.create<BdfObject>(lookupTable, data + i, object_size));
 
 		// Increase the iterator by the amount of bytes
 		i += object_size;
@@ -52,6 +49,11 @@ BdfList::BdfList(BdfLookupTable* lookupTable, BdfStringReader* sr)
 	this->startItem = nullptr;
 	this->endItem = nullptr;
 	this->endptr = &this->startItem;
+	this->lookupTable = lookupTable;
+	this->owner = nullptr;
+	this->columns = nullptr;
+
+	BDF_STATS_ALLOC(lookupTable->stats, sizeof(BdfList));
 		
 	sr->upto += 1;
 
@@ -68,7 +70,7 @@ BdfList::BdfList(BdfLookupTable* lookupTable, BdfStringReader* sr)
 				return;
 			}
 
-			BdfObject* bdf = new BdfObject(lookupTable, sr);
+			BdfObject* bdf = lookupTable->pool.create<BdfObject>(lookupTable, sr);
 			add(bdf);
 
 			// There should be a comma after this
@@ -91,7 +93,7 @@ BdfList::BdfList(BdfLookupTable* lookupTable, BdfStringReader* sr)
 
 	catch(BdfError &e)
 	{
-		clear();
+		clearItems();
 		
 		throw;
 	}
@@ -99,7 +101,8 @@ BdfList::BdfList(BdfLookupTable* lookupTable, BdfStringReader* sr)
 
 BdfList::~BdfList()
 {
-	clear();
+	delete columns;
+	clearItems();
 }
 
 BdfObject* BdfList::get(int index) const
@@ -109,10 +112,19 @@ BdfObject* BdfList::get(int index) const
 
 BdfList* BdfList::set(int index, BdfObject* o)
 {
+	BdfList* copy = unshare();
+
+	if(copy != this) {
+		return copy->set(index, o);
+	}
+
 	Item* item = getAtIndex(index);
 
-	delete item->object;
+	lookupTable->generation += 1;
+
+	BdfObject::release(item->object, this);
 	item->object = o;
+	adopt(o);
 
 	return this;
 }
@@ -143,6 +155,8 @@ BdfObject* BdfList::getEnd() noexcept {
 
 BdfList* BdfList::insertNext(Item* item, BdfObject* object)
 {
+	lookupTable->generation += 1;
+
 	if(item->next == nullptr)
 	{
 		add(object);
@@ -150,10 +164,12 @@ BdfList* BdfList::insertNext(Item* item, BdfObject* object)
 
 	else
 	{
-		Item* item_new = new Item();
+		BDF_STATS_ALLOC(lookupTable->stats, sizeof(Item));
+		Item* item_new = lookupTable->pool.create<Item>();
 
 		item_new->object = object;
 		item_new->last = item;
+		adopt(object);
 		item_new->next = item->next;
 
 		item->next->last = item_new;
@@ -163,11 +179,24 @@ BdfList* BdfList::insertNext(Item* item, BdfObject* object)
 	return this;
 }
 
-BdfList* BdfList::insertNext(uint64_t index, BdfObject* o) {
+BdfList* BdfList::insertNext(uint64_t index, BdfObject* o)
+{
+	BdfList* copy = unshare();
+
+	if(copy != this) {
+		return copy->insertNext(index, o);
+	}
+
 	return this->insertNext(this->getAtIndex(index), o);
 }
 
 BdfList* BdfList::insertNext(BdfObject* needle, BdfObject* o, bool fallbackToAdd) {
+	BdfList* copy = unshare();
+
+	if(copy != this) {
+		return copy->insertNext(needle, o, fallbackToAdd);
+	}
+
 	BdfList::ConstIterator it = this->find(needle);
 	
 	if (it) {
@@ -183,9 +212,13 @@ BdfList* BdfList::insertNext(BdfObject* needle, BdfObject* o, bool fallbackToAdd
 
 BdfList* BdfList::insertLast(Item* item, BdfObject* object)
 {
-	Item* item_new = new Item();
+	lookupTable->generation += 1;
+
+	BDF_STATS_ALLOC(lookupTable->stats, sizeof(Item));
+	Item* item_new = lookupTable->pool.create<Item>();
 
 	item_new->object = object;
+	adopt(object);
 
 	if(item->last == nullptr)
 	{
@@ -208,11 +241,24 @@ BdfList* BdfList::insertLast(Item* item, BdfObject* object)
 	return this;
 }
 
-BdfList* BdfList::insertLast(uint64_t index, BdfObject* o) {
+BdfList* BdfList::insertLast(uint64_t index, BdfObject* o)
+{
+	BdfList* copy = unshare();
+
+	if(copy != this) {
+		return copy->insertLast(index, o);
+	}
+
 	return this->insertLast(this->getAtIndex(index), o);
 }
 
 BdfList* BdfList::insertLast(BdfObject* needle, BdfObject* o, bool fallbackToAdd) {
+	BdfList* copy = unshare();
+
+	if(copy != this) {
+		return copy->insertLast(needle, o, fallbackToAdd);
+	}
+
 	BdfList::ConstIterator it = this->find(needle);
 	
 	if (it) {
@@ -228,6 +274,8 @@ BdfList* BdfList::insertLast(BdfObject* needle, BdfObject* o, bool fallbackToAdd
 
 BdfList* BdfList::remove(Item* item) noexcept
 {
+	lookupTable->generation += 1;
+
 	if(item->next == nullptr && item->last == nullptr)
 	{
 		this->startItem = nullptr;
@@ -256,14 +304,20 @@ BdfList* BdfList::remove(Item* item) noexcept
 
 	BdfObject* object = item->object;
 
-	delete item;
-	delete object;
+	lookupTable->pool.destroy(item);
+	BdfObject::release(object, this);
 
 	return this;
 }
 
-BdfList* BdfList::remove(BdfObject* item) noexcept
+BdfList* BdfList::remove(BdfObject* item)
 {
+	BdfList* copy = unshare();
+
+	if(copy != this) {
+		return copy->remove(item);
+	}
+
 	Item* cur = this->startItem;
 
 	while(cur != nullptr && cur->object != item)
@@ -281,7 +335,16 @@ BdfList* BdfList::remove(BdfObject* item) noexcept
 
 BdfList* BdfList::add(BdfObject* o)
 {
-	Item* item = new Item();
+	BdfList* copy = unshare();
+
+	if(copy != this) {
+		return copy->add(o);
+	}
+
+	lookupTable->generation += 1;
+
+	BDF_STATS_ALLOC(lookupTable->stats, sizeof(Item));
+	Item* item = lookupTable->pool.create<Item>();
 	
 	item->object = o;
 	item->last = this->endItem;
@@ -290,16 +353,39 @@ BdfList* BdfList::add(BdfObject* o)
 	*this->endptr = item;
 	this->endptr = &item->next;
 	this->endItem = item;
+	adopt(o);
 		
 	return this;
 }
 
 BdfList* BdfList::remove(int index)
 {
+	BdfList* copy = unshare();
+
+	if(copy != this) {
+		return copy->remove(index);
+	}
+
 	return remove(getAtIndex(index));
 }
 
-BdfList* BdfList::clear() noexcept {
+BdfList* BdfList::clear()
+{
+	BdfList* copy = unshare();
+
+	if(copy != this) {
+		return copy->clear();
+	}
+
+	clearItems();
+
+	return this;
+}
+
+void BdfList::clearItems() noexcept
+{
+	lookupTable->generation += 1;
+
 	// Use iterators to clear the list.
 	// 1. Get an ItemIterator to the end.
 	// 2. Delete our current Item's object.
@@ -308,17 +394,16 @@ BdfList* BdfList::clear() noexcept {
 	BdfList::ItemIterator it = BdfList::ItemIterator(this->getEndItem());
 	
 	while (it) {
-		delete (*it)->object;
-		delete (*it)->next;
+		BdfObject::release((*it)->object, this);
+		lookupTable->pool.destroy((*it)->next);
 		--it;
 	}
 	
-	delete this->startItem;
+	lookupTable->pool.destroy(this->startItem);
 	
 	this->startItem = nullptr;
 	this->endItem = nullptr;
-	
-	return this;
+	this->endptr = &this->startItem;
 }
 
 void BdfList::getLocationUses(int* locations) const
@@ -343,11 +428,71 @@ int BdfList::serializeSeeker(int* locations) const
 		upto = upto->next;
 	}
 
+	delete columns;
+	columns = nullptr;
+
+	BdfSerializeOptions::ListEncoding encoding = lookupTable->serializeOptions.listEncoding;
+
+	if(encoding == BdfSerializeOptions::ListEncoding::ROWS) {
+		return size;
+	}
+
+	// Lists of named lists with the same keys can be stored as columns
+	columns = BdfColumns::create(this, locations);
+
+	if(columns == nullptr) {
+		return size;
+	}
+
+	if(encoding == BdfSerializeOptions::ListEncoding::COLUMNAR || columns->serializeSeeker() < size) {
+		return columns->serializeSeeker();
+	}
+
+	delete columns;
+	columns = nullptr;
+
 	return size;
 }
 
+bool BdfList::serializesAsColumns() const noexcept {
+	return columns != nullptr;
+}
+
+BdfMemoryUsage BdfList::memoryUsage() const
+{
+	BdfMemoryUsage usage;
+	usage.nodes = sizeof(BdfList);
+
+	for(Item* item = startItem; item != nullptr; item = item->next)
+	{
+		usage.items += sizeof(Item);
+
+		if(item->object != nullptr) {
+			usage += item->object->memoryUsage();
+		}
+	}
+
+	return usage;
+}
+
 int BdfList::serialize(char *data, int* locations) const
 {
+	if(columns != nullptr)
+	{
+		// The arrays making up the columns are deleted along with them, so their payloads are always copied
+		std::vector<BdfLookupTable::Gathered>* gathered = lookupTable->gathered;
+		lookupTable->gathered = nullptr;
+
+		int size = columns->serialize(data, locations);
+
+		lookupTable->gathered = gathered;
+
+		delete columns;
+		columns = nullptr;
+
+		return size;
+	}
+
 	Item* upto = this->startItem;
 	int pos = 0;
 
@@ -360,6 +505,22 @@ int BdfList::serialize(char *data, int* locations) const
 	return pos;
 }
 
+int BdfList::getGatheredSize() const noexcept
+{
+	// Payloads are never gathered from lists stored as columns
+	if(columns != nullptr) {
+		return 0;
+	}
+
+	int size = 0;
+
+	for(Item* item = startItem; item != nullptr; item = item->next) {
+		size += item->object->getGatheredSize();
+	}
+
+	return size;
+}
+
 void BdfList::serializeHumanReadable(std::ostream &out, const BdfIndent &indent, int it)
 {
 	if(this->startItem == nullptr)
@@ -399,7 +560,14 @@ uint64_t BdfList::size() const noexcept {
 	return std::distance(this->ibegin(), this->iend());
 }
 
-BdfList* BdfList::reserve(uint64_t size) {
+BdfList* BdfList::reserve(uint64_t size)
+{
+	BdfList* copy = unshare();
+
+	if(copy != this) {
+		return copy->reserve(size);
+	}
+
 	uint64_t currentSize = this->size();
 	
 	// 1. currentSize = 5, size = 8
@@ -414,20 +582,29 @@ BdfList* BdfList::reserve(uint64_t size) {
 	// return this.
 	if (currentSize < size) {	
 		for (uint64_t i = currentSize; i < size; i++) {
-			this->add(new BdfObject(this->lookupTable));
+			this->add(this->lookupTable->pool.create<BdfObject>(this->lookupTable));
 		}
 	}
 	
 	return this;
 }
 
-BdfList* BdfList::shrinkUndefinedObjects() {
+BdfList* BdfList::shrinkUndefinedObjects()
+{
+	BdfList* copy = unshare();
+
+	if(copy != this) {
+		return copy->shrinkUndefinedObjects();
+	}
+
+	lookupTable->generation += 1;
+
 	BdfList::ItemIterator it(this->endItem);
 	
 	while (!*(it->object)) {
-		delete it->object;
+		BdfObject::release(it->object, this);
 		--it;
-		delete (*it)->next;
+		lookupTable->pool.destroy((*it)->next);
 		(*it)->next = nullptr;
 	}
 	
@@ -435,12 +612,13 @@ BdfList* BdfList::shrinkUndefinedObjects() {
 }
 
 BdfList::ConstIterator BdfList::find(BdfObject* needle) const noexcept {
-	// Search the entire BdfList until we find it.
+	// Search the entire BdfList until we find it, only comparing objects whose hash matches in full.
+	uint64_t needleHash = needle->hash();
 	BdfList::ConstIterator first = this->cbegin();
 	BdfList::ConstIterator last = this->cend();
 	
 	while (first != last) {
-		if (**first == *needle) {
+		if (*first != nullptr && (*first)->hash() == needleHash && **first == *needle) {
 			return first;
 		}
 		++first;
@@ -450,13 +628,14 @@ BdfList::ConstIterator BdfList::find(BdfObject* needle) const noexcept {
 }
 
 std::optional<uint64_t> BdfList::findIndex(BdfObject* needle) const noexcept {
-	// Search the entire BdfList until we find it.
+	// Search the entire BdfList until we find it, only comparing objects whose hash matches in full.
 	uint64_t itNo;
+	uint64_t needleHash = needle->hash();
 	BdfList::ConstIterator first = this->cbegin();
 	BdfList::ConstIterator last = this->cend();
 	
 	for (itNo = 0; first != last; ++first, ++itNo) {
-		if (**first == *needle) {
+		if (*first != nullptr && (*first)->hash() == needleHash && **first == *needle) {
 			return itNo;
 		}
 		
@@ -484,7 +663,90 @@ std::partial_ordering BdfList::operator<=>(const BdfList& rhs) const noexcept {
 }
 
 bool BdfList::operator==(const BdfList& rhs) const noexcept {
-	return ((*this <=> rhs) == std::partial_ordering::equivalent);
+	BdfList::ConstIterator lhsIt = this->cbegin();
+	BdfList::ConstIterator rhsIt = rhs.cbegin();
+	
+	// Compare with BdfObject::operator== rather than operator<=>, so cached hashes can tell objects apart.
+	while (lhsIt && rhsIt) {
+		if (*lhsIt == nullptr || *rhsIt == nullptr) {
+			if (*lhsIt != *rhsIt) {
+				return false;
+			}
+		} else if (!(**lhsIt == **rhsIt)) {
+			return false;
+		}
+		
+		++lhsIt;
+		++rhsIt;
+	}
+	
+	return !lhsIt && !rhsIt;
+}
+
+uint64_t BdfList::hash() const noexcept
+{
+	// Combine the hashes in order, so lists holding the same objects in a different order hash differently
+	uint64_t h = hash_mix(BdfTypes::LIST);
+
+	for(Item* item = this->startItem; item != nullptr; item = item->next) {
+		h = hash_mix(h + ((item->object == nullptr) ? 0 : item->object->hash()));
+	}
+
+	return h;
+}
+
+BdfList* BdfList::shallowCopy() const
+{
+	BdfList* list = lookupTable->pool.create<BdfList>(lookupTable);
+
+	// Items are added directly, since sharing objects doesn't change the document
+	for(Item* item = this->startItem; item != nullptr; item = item->next)
+	{
+		BDF_STATS_ALLOC(lookupTable->stats, sizeof(Item));
+		Item* copied = lookupTable->pool.create<Item>();
+
+		copied->object = (item->object == nullptr) ? nullptr : item->object->share();
+		copied->last = list->endItem;
+		copied->next = nullptr;
+
+		// The copy takes the place of this list in the document that can be changed
+		list->adopt(copied->object);
+
+		*list->endptr = copied;
+		list->endptr = &copied->next;
+		list->endItem = copied;
+	}
+
+	return list;
+}
+
+BdfList* BdfList::unshare()
+{
+	if(owner == nullptr || !lookupTable->isShared()) {
+		return this;
+	}
+
+	return (BdfList*)owner->unshare()->object;
+}
+
+BdfObject** BdfList::findSlot(const BdfObject* object) const noexcept
+{
+	for(Item* item = this->startItem; item != nullptr; item = item->next)
+	{
+		if(item->object == object) {
+			return &item->object;
+		}
+	}
+
+	return nullptr;
+}
+
+void BdfList::adopt(BdfObject* o) noexcept
+{
+	if(o != nullptr) {
+		o->parent = this;
+		o->parent_type = BdfTypes::LIST;
+	}
 }
 
 BdfList::Iterator BdfList::begin() noexcept {
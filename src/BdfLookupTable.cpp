@@ -5,21 +5,77 @@
 #include <vector>
 #include <string>
 #include <string.h>
+#include <algorithm>
 
 using namespace Bdf;
 using namespace BdfHelpers;
 
 BdfLookupTable::BdfLookupTable(BdfReader* pReader)
 {
-	reader = pReader;
+	readers.push_back(pReader);
+	shares = 1;
+	retired_size = 0;
+	writer = pReader;
+	stats = &pReader->stats;
+	generation = 1;
+	keysId = newKeysId();
+	namedLists = nullptr;
+	seekGeneration = 0;
+	gathered = nullptr;
+	gatherThreshold = 0;
 	keys_mapped = NULL;
 	keys_size_mapped = 0;
+	keys_capacity_mapped = 0;
 	keys_start = NULL;
 	keys_endp = &keys_start;
 	keys_size = 0;
+	keys_live = 0;
+	keys_free = NULL;
 }
 
-BdfLookupTable::BdfLookupTable(BdfReader* pReader, const char* data, int size) : BdfLookupTable(pReader)
+BdfLookupTable::BdfLookupTable(BdfReader* pReader, const char* data, int size) : BdfLookupTable(pReader) {
+	readKeys(data, size);
+}
+
+BdfLookupTable::~BdfLookupTable()
+{
+	// The retired documents use the pool and keys, so they go first
+	freeRetired();
+	free(keys_mapped);
+
+	trim();
+
+	Item* cur = keys_start;
+	Item* next;
+
+	while(cur != NULL)
+	{
+		next = cur->next;
+
+		delete cur;
+
+		cur = next;
+	}
+}
+
+BdfLookupTable::Item* BdfLookupTable::newKey(const char* key, size_t size)
+{
+	Item* item = keys_free;
+
+	if(item != NULL) {
+		keys_free = item->next;
+	} else {
+		BDF_STATS_ALLOC(stats, sizeof(Item) + size);
+		item = new Item();
+	}
+
+	item->key.assign(key, size);
+	item->next = NULL;
+
+	return item;
+}
+
+void BdfLookupTable::readKeys(const char* data, int size)
 {
 	for(int i=0;i<size;)
 	{
@@ -31,9 +87,7 @@ BdfLookupTable::BdfLookupTable(BdfReader* pReader, const char* data, int size) :
 			return;
 		}
 
-		Item* key_new = new Item();
-		key_new->key = std::string(data + i, key_size);
-		key_new->next = NULL;
+		Item* key_new = newKey(data + i, key_size);
 
 		*keys_endp = key_new;
 		keys_endp = &key_new->next;
@@ -43,28 +97,139 @@ BdfLookupTable::BdfLookupTable(BdfReader* pReader, const char* data, int size) :
 	}
 }
 
-BdfLookupTable::~BdfLookupTable()
+uint64_t BdfLookupTable::newKeysId() noexcept
 {
-	free(keys_mapped);
+	static std::atomic<uint64_t> next(1);
 
-	Item* cur = keys_start;
-	Item* next;
+	return next.fetch_add(1);
+}
 
-	while(cur != NULL)
+bool BdfLookupTable::isShared() const noexcept {
+	return shares > 1;
+}
+
+void BdfLookupTable::clear() noexcept
+{
+	// Move the keys to the free list, so their strings keep their buffers
+	*keys_endp = keys_free;
+	keys_free = keys_start;
+
+	keys_start = NULL;
+	keys_endp = &keys_start;
+	keys_size = 0;
+	keys_size_mapped = 0;
+	keys_live = 0;
+	key_uses.clear();
+
+	strings.clear();
+	strings_used.clear();
+	strings_mapped.clear();
+
+	generation += 1;
+	keysId = newKeysId();
+}
+
+void BdfLookupTable::trim() noexcept
+{
+	pool.clear();
+
+	while(keys_free != NULL)
 	{
-		next = cur->next;
+		Item* next = keys_free->next;
+		delete keys_free;
+		keys_free = next;
+	}
+}
 
-		delete cur;
+void BdfLookupTable::load(const char* data, int size)
+{
+	clear();
+	readKeys(data, size);
+}
 
-		cur = next;
+void BdfLookupTable::share(BdfReader* reader)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	readers.push_back(reader);
+	shares = readers.size();
+}
+
+void BdfLookupTable::release(BdfLookupTable* lookupTable, BdfReader* reader, BdfObject* document) noexcept
+{
+	if(lookupTable == nullptr) {
+		BdfObject::release(document);
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(lookupTable->mutex);
+	std::vector<BdfReader*> &readers = lookupTable->readers;
+
+	// A copy may be deleted on another thread, so the pool is left to the reader changing the document
+	if(reader != lookupTable->writer)
+	{
+		if(document != nullptr) {
+			lookupTable->retired.push_back(document);
+			lookupTable->retired_size = lookupTable->retired.size();
+		}
+
+		readers.erase(std::find(readers.begin(), readers.end(), reader));
+		lookupTable->shares = readers.size();
+
+		return;
+	}
+
+	lock.unlock();
+	BdfObject::release(document, reader);
+	lock.lock();
+
+	readers.erase(std::find(readers.begin(), readers.end(), reader));
+	lookupTable->shares = readers.size();
+
+	if(readers.empty())
+	{
+		lock.unlock();
+		delete lookupTable;
+
+		return;
+	}
+
+	// The oldest copy takes the place of the reader that was copied, so its document can be changed
+	lookupTable->writer = readers.front();
+	lookupTable->stats = &readers.front()->stats;
+
+	if(readers.front()->bdf != nullptr) {
+		readers.front()->bdf->relink();
 	}
 }
 
+void BdfLookupTable::freeRetired() noexcept
+{
+	std::vector<BdfObject*> documents;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		documents.swap(retired);
+		retired_size = 0;
+	}
+
+	for(BdfObject* document : documents) {
+		BdfObject::release(document);
+	}
+}
+
+bool BdfLookupTable::hasRetired() const noexcept {
+	return retired_size > 0;
+}
+
 void BdfLookupTable::remapKeys()
 {
-	if(keys_size != keys_size_mapped)
+	// Only grow the array, so a cleared table doesn't have to allocate it again
+	if(keys_size > keys_capacity_mapped)
 	{
 		keys_mapped = (Item**)realloc(keys_mapped, keys_size * sizeof(Item*));
+		keys_capacity_mapped = keys_size;
 	}
 
 	keys_size_mapped = keys_size;
@@ -80,7 +245,7 @@ void BdfLookupTable::remapKeys()
 	}
 }
 
-unsigned int BdfLookupTable::getLocation(std::string key)
+unsigned int BdfLookupTable::getLocation(std::string_view key)
 {
 	Item* cur = keys_start;
 	int upto = 0;
@@ -89,6 +254,7 @@ unsigned int BdfLookupTable::getLocation(std::string key)
 	{
 		if(cur->key == key)
 		{
+			BDF_STATS_ADD(stats, keyHits, 1);
 			return upto;
 		}
 			
@@ -96,10 +262,16 @@ unsigned int BdfLookupTable::getLocation(std::string key)
 		upto += 1;
 	}
 
-	Item* item = new Item();
+	BDF_STATS_ADD(stats, keyMisses, 1);
 
-	item->key = key;
-	item->next = NULL;
+	// Copies of the reader may be looking keys up on other threads
+	std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+
+	if(isShared()) {
+		lock.lock();
+	}
+
+	Item* item = newKey(key.data(), key.size());
 
 	*this->keys_endp = item;
 	this->keys_endp = &item->next;
@@ -107,22 +279,128 @@ unsigned int BdfLookupTable::getLocation(std::string key)
 	return keys_size++;
 }
 
-std::string BdfLookupTable::getName(unsigned int key)
+int BdfLookupTable::findLocation(std::string_view key) const noexcept
+{
+	std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+
+	if(isShared()) {
+		lock.lock();
+	}
+
+	Item* cur = keys_start;
+	int upto = 0;
+
+	while(cur != NULL)
+	{
+		if(cur->key == key) {
+			return upto;
+		}
+
+		cur = cur->next;
+		upto += 1;
+	}
+
+	return -1;
+}
+
+const std::string& BdfLookupTable::getName(unsigned int key)
 {
+	static const std::string empty;
+
 	if(keys_size != keys_size_mapped) remapKeys();
-	if(key < 0 || key >= keys_size) return "";
+	if(key >= keys_size) return empty;
 
 	return keys_mapped[key]->key;
 }
 
 bool BdfLookupTable::hasKeyLocation(unsigned int key) {
-	return key >= 0 && key < keys_size;
+	return key < keys_size;
+}
+
+void BdfLookupTable::addKeyUse(int key)
+{
+	if((size_t)key >= key_uses.size()) {
+		key_uses.resize(key + 1, 0);
+	}
+
+	if(key_uses[key]++ == 0) {
+		keys_live += 1;
+	}
+}
+
+void BdfLookupTable::removeKeyUse(int key) noexcept
+{
+	if((size_t)key < key_uses.size() && --key_uses[key] == 0) {
+		keys_live -= 1;
+	}
+}
+
+int BdfLookupTable::compact()
+{
+	// Copies of the reader may be read from other threads, so keys are only renumbered once nothing shares them
+	if(isShared()) {
+		return 0;
+	}
+
+	std::vector<int> remap(keys_size, -1);
+	Item** link = &keys_start;
+	unsigned int next = 0;
+
+	// Unused keys are moved to the free list, so new keys can reuse their string buffers
+	for(unsigned int i=0;i<keys_size;i++)
+	{
+		Item* item = *link;
+
+		if(i < key_uses.size() && key_uses[i] > 0)
+		{
+			key_uses[next] = key_uses[i];
+			remap[i] = next;
+			next += 1;
+			link = &item->next;
+		}
+
+		else
+		{
+			*link = item->next;
+			item->next = keys_free;
+			keys_free = item;
+		}
+	}
+
+	int removed = keys_size - next;
+
+	keys_endp = link;
+	keys_size = next;
+	keys_size_mapped = 0;
+	key_uses.resize(std::min<size_t>(key_uses.size(), next));
+
+	for(BdfNamedList* named = namedLists; named != nullptr; named = named->table_next) {
+		for(BdfNamedList::Item* item = named->start; item != nullptr; item = item->next) {
+			item->key = remap[item->key];
+		}
+	}
+
+	// Key locations cached by paths and the last serialisation no longer match the table
+	keysId = newKeysId();
+	seekGeneration += 1;
+
+	return removed;
+}
+
+bool BdfLookupTable::isCompactDue() const noexcept
+{
+	unsigned int unused = keys_size - keys_live;
+	return !isShared() && unused >= COMPACT_MIN_KEYS && unused >= keys_live;
 }
 
 int BdfLookupTable::serialize(char* data, int* locations, int locations_size)
 {
 	int upto = 0;
 
+	// Keys are stored in the order of their locations, which isn't the order of the table for canonical data
+	std::vector<int> &keys = serialize_keys;
+	keys.clear();
+
 	for(int i=0;i<locations_size;i++)
 	{
 		int loc = locations[i];
@@ -131,7 +409,16 @@ int BdfLookupTable::serialize(char* data, int* locations, int locations_size)
 			continue;
 		}
 
-		std::string key = keys_mapped[i]->key;
+		if((size_t)loc >= keys.size()) {
+			keys.resize(loc + 1);
+		}
+
+		keys[loc] = i;
+	}
+
+	for(int i : keys)
+	{
+		const std::string &key = keys_mapped[i]->key;
 
 		memcpy(data + upto + 1, key.c_str(), key.size());
 		data[upto] = (char) key.size();
@@ -161,19 +448,83 @@ int BdfLookupTable::serializeSeeker(int* locations, int locations_size)
 	return size;
 }
 
-void BdfLookupTable::serializeGetLocations(int* locations)
+bool BdfLookupTable::hasDetachedNamedLists(const BdfObject* root) const noexcept
+{
+	// Going up from each named list is usually far quicker than walking the document, but not for deep
+	// documents, so give up once it takes more than a few steps for each named list.
+	size_t steps = 0;
+	size_t budget = 0;
+
+	for(BdfNamedList* named = namedLists; named != nullptr; named = named->table_next)
+	{
+		const BdfObject* object = named->owner;
+		budget += 8;
+
+		while(object != nullptr && object != root)
+		{
+			if(++steps > budget) {
+				return true;
+			}
+
+			object = object->getHolder();
+		}
+
+		if(object == nullptr) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void BdfLookupTable::serializeGetLocations(int* locations, BdfObject* root)
 {
 	if(keys_size != keys_size_mapped) remapKeys();
 	
-	int* uses = new int[keys_size];
+	strings_used.clear();
+	strings_mapped.clear();
+
+	// The items using each key are counted as they are added and deleted, but the counts also include
+	// objects outside this document, such as ones shared with a copy of the reader or named lists that
+	// were never added. The objects are walked instead when string values have to be counted anyway
+	// or only the keys used may be stored.
+	if(serializeOptions.stringTable || serializeOptions.canonical || isShared() || hasDetachedNamedLists(root))
+	{
+		serialize_uses.assign(keys_size, 0);
+		root->getLocationUses(serialize_uses.data());
+	}
+
+	else
+	{
+		serialize_uses.assign(key_uses.begin(), key_uses.begin() + std::min<size_t>(key_uses.size(), keys_size));
+		serialize_uses.resize(keys_size, 0);
+	}
+
+	int* uses = serialize_uses.data();
 	int next = 0;
 
-	// Fill the uses array with zeros
-	for(unsigned int i=0;i<keys_size;i++) {
-		uses[i] = 0;
-	}	
+	// Strings used more than once are stored in the string table,
+	// with the most used strings first so they get the smallest locations.
+	for(auto &it : strings_used) {
+		if(it.second.uses > 1) {
+			strings_mapped.push_back(it.first);
+		}
+	}
+
+	std::sort(strings_mapped.begin(), strings_mapped.end(), [this](std::string_view a, std::string_view b) {
+		const StringUse &use_a = strings_used[a];
+		const StringUse &use_b = strings_used[b];
 
-	reader->getObject()->getLocationUses(uses);
+		if(use_a.uses != use_b.uses) {
+			return use_a.uses > use_b.uses;
+		}
+
+		return use_a.first < use_b.first;
+	});
+
+	for(size_t i=0;i<strings_mapped.size();i++) {
+		strings_used[strings_mapped[i]].location = i;
+	}
 
 	for(unsigned int i=0;i<keys_size;i++)
 	{
@@ -185,9 +536,151 @@ void BdfLookupTable::serializeGetLocations(int* locations)
 		}
 	}
 
-	delete[] uses;
+	// Canonical data numbers the keys in the byte order of their names, not the order they were added in
+	if(serializeOptions.canonical)
+	{
+		std::vector<unsigned int> used;
+		used.reserve(next);
+
+		for(unsigned int i=0;i<keys_size;i++) {
+			if(uses[i] > 0) {
+				used.push_back(i);
+			}
+		}
+
+		std::sort(used.begin(), used.end(), [this](unsigned int a, unsigned int b) {
+			return keys_mapped[a]->key < keys_mapped[b]->key;
+		});
+
+		for(size_t i=0;i<used.size();i++) {
+			locations[used[i]] = i;
+		}
+	}
 }
 
-int BdfLookupTable::size() {
+int BdfLookupTable::size() const {
 	return keys_size;
 }
+
+BdfMemoryUsage BdfLookupTable::memoryUsage() const
+{
+	BdfMemoryUsage usage;
+	usage.nodes = sizeof(BdfLookupTable);
+	usage.keys = keys_capacity_mapped * sizeof(Item*);
+	usage.pooled = pool.size();
+
+	for(Item* cur = keys_free; cur != NULL; cur = cur->next) {
+		usage.pooled += sizeof(Item) - sizeof(std::string) + BdfMemoryUsage::getStringSize(cur->key);
+	}
+
+	for(Item* cur = keys_start; cur != NULL; cur = cur->next) {
+		usage.keys += sizeof(Item) - sizeof(std::string) + BdfMemoryUsage::getStringSize(cur->key);
+	}
+
+	usage.strings = strings.capacity() * sizeof(std::string);
+
+	for(const std::string &v : strings) {
+		usage.strings += BdfMemoryUsage::getStringSize(v) - sizeof(std::string);
+	}
+
+	return usage;
+}
+
+void BdfLookupTable::readStrings(const char* data, int size)
+{
+	uint64_t count;
+	int i = get_varint(data, size, &count);
+
+	// Every string takes at least 1 byte
+	if(i == -1 || count > (uint64_t)size) {
+		return;
+	}
+
+	strings.clear();
+	strings.reserve(count);
+
+	for(uint64_t j=0;j<count;j++)
+	{
+		uint64_t string_size;
+		int varint_size = get_varint(data + i, size - i, &string_size);
+
+		if(varint_size == -1 || string_size > (uint64_t)(size - i - varint_size)) {
+			return;
+		}
+
+		i += varint_size;
+		strings.emplace_back(data + i, string_size);
+		i += string_size;
+	}
+}
+
+const std::string* BdfLookupTable::getString(unsigned int location) const noexcept
+{
+	if(location >= strings.size()) {
+		return nullptr;
+	}
+
+	return &strings[location];
+}
+
+void BdfLookupTable::countString(const std::string &v)
+{
+	// Empty strings are never smaller as a reference
+	if(!serializeOptions.stringTable || v.empty()) {
+		return;
+	}
+
+	auto it = strings_used.try_emplace(v, StringUse{0, (int)strings_used.size(), -1}).first;
+	it->second.uses += 1;
+}
+
+int BdfLookupTable::getStringLocation(const std::string &v) const
+{
+	if(strings_mapped.empty()) {
+		return -1;
+	}
+
+	auto it = strings_used.find(v);
+
+	if(it == strings_used.end()) {
+		return -1;
+	}
+
+	return it->second.location;
+}
+
+int BdfLookupTable::serializeStringsSeeker() const
+{
+	if(strings_mapped.empty()) {
+		return 0;
+	}
+
+	int size = varintSize(strings_mapped.size());
+
+	for(std::string_view v : strings_mapped) {
+		size += varintSize(v.size()) + v.size();
+	}
+
+	return size;
+}
+
+int BdfLookupTable::serializeStrings(char* data)
+{
+	if(strings_mapped.empty()) {
+		return 0;
+	}
+
+	int upto = put_varint(data, strings_mapped.size());
+
+	for(std::string_view v : strings_mapped)
+	{
+		upto += put_varint(data + upto, v.size());
+		memcpy(data + upto, v.data(), v.size());
+		upto += v.size();
+	}
+
+	strings_used.clear();
+	strings_mapped.clear();
+
+	return upto;
+}
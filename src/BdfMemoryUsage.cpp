@@ -0,0 +1,54 @@
+
+#include "../include/BdfMemoryUsage.hpp"
+#include <sstream>
+
+using namespace Bdf;
+
+BdfMemoryUsage::BdfMemoryUsage()
+{
+	nodes = 0;
+	items = 0;
+	payloads = 0;
+	strings = 0;
+	keys = 0;
+	pooled = 0;
+}
+
+uint64_t BdfMemoryUsage::total() const noexcept {
+	return nodes + items + payloads + strings + keys + pooled;
+}
+
+BdfMemoryUsage& BdfMemoryUsage::operator+=(const BdfMemoryUsage &other) noexcept
+{
+	nodes += other.nodes;
+	items += other.items;
+	payloads += other.payloads;
+	strings += other.strings;
+	keys += other.keys;
+	pooled += other.pooled;
+
+	return *this;
+}
+
+std::string BdfMemoryUsage::toString() const
+{
+	std::stringstream out;
+
+	out << "nodes: " << nodes << ", items: " << items << ", payloads: " << payloads;
+	out << ", strings: " << strings << ", keys: " << keys << ", pooled: " << pooled << ", total: " << total();
+
+	return out.str();
+}
+
+uint64_t BdfMemoryUsage::getStringSize(const std::string &str) noexcept
+{
+	const char* data = str.data();
+	const char* start = (const char*)&str;
+
+	// Short strings are stored inside the std::string itself
+	if(data >= start && data < start + sizeof(std::string)) {
+		return sizeof(std::string);
+	}
+
+	return sizeof(std::string) + str.capacity() + 1;
+}
@@ -6,6 +6,7 @@
 #include <string>
 #include <string.h>
 #include <iostream>
+#include <algorithm>
 
 using namespace Bdf;
 using namespace BdfHelpers;
@@ -23,9 +24,14 @@ BdfNamedList::Item::Item(int pKey, BdfObject* pObject, Item* pNext)
 BdfNamedList::BdfNamedList(BdfLookupTable* pLookupTable, const char* data, int size)
 {
 	lookupTable = pLookupTable;
+	owner = nullptr;
 	start = NULL;
 	end = &start;
 
+	link();
+
+	BDF_STATS_ALLOC(lookupTable->stats, sizeof(BdfNamedList));
+
 	int i = 0;
 
 	while(i < size)
@@ -75,7 +81,7 @@ BdfNamedList::BdfNamedList(BdfLookupTable* pLookupTable, const char* data, int s
 		i += key_size;
 
 		// Add the list item
-		set(key, new BdfObject(lookupTable, object_data, object_size));
+		set(key, lookupTable->pool.create<BdfObject>(lookupTable, object_data, object_size));
 	}
 }
 
@@ -89,8 +95,13 @@ BdfNamedList::BdfNamedList(BdfLookupTable* pLookupTable, BdfStringReader* sr)
 	end = &start;
 
 	lookupTable = pLookupTable;
+	owner = nullptr;
 	sr->upto += 1;
 
+	link();
+
+	BDF_STATS_ALLOC(lookupTable->stats, sizeof(BdfNamedList));
+
 	// {"key": ..., "key2": ...}
 	try
 	{
@@ -121,7 +132,7 @@ BdfNamedList::BdfNamedList(BdfLookupTable* pLookupTable, BdfStringReader* sr)
 			sr->upto += 1;
 			sr->ignoreBlanks();
 	
-			BdfObject* bdf = new BdfObject(lookupTable, sr);
+			BdfObject* bdf = lookupTable->pool.create<BdfObject>(lookupTable, sr);
 			set(key, bdf);
 	
 			// There should be a comma after this
@@ -144,7 +155,8 @@ BdfNamedList::BdfNamedList(BdfLookupTable* pLookupTable, BdfStringReader* sr)
 
 	catch(BdfError &e)
 	{
-		clear();
+		clearItems();
+		unlink();
 			
 		throw;
 	}
@@ -152,11 +164,52 @@ BdfNamedList::BdfNamedList(BdfLookupTable* pLookupTable, BdfStringReader* sr)
 
 BdfNamedList::~BdfNamedList()
 {
-	clear();
+	clearItems();
+	unlink();
+}
+
+void BdfNamedList::link() noexcept
+{
+	table_prev = nullptr;
+	table_next = lookupTable->namedLists;
+
+	if(table_next != nullptr) {
+		table_next->table_prev = this;
+	}
+
+	lookupTable->namedLists = this;
+}
+
+void BdfNamedList::unlink() noexcept
+{
+	if(table_prev != nullptr) {
+		table_prev->table_next = table_next;
+	} else {
+		lookupTable->namedLists = table_next;
+	}
+
+	if(table_next != nullptr) {
+		table_next->table_prev = table_prev;
+	}
 }
 
 BdfNamedList* BdfNamedList::clear()
 {
+	BdfNamedList* copy = unshare();
+
+	if(copy != this) {
+		return copy->clear();
+	}
+
+	clearItems();
+
+	return this;
+}
+
+void BdfNamedList::clearItems() noexcept
+{
+	lookupTable->generation += 1;
+
 	Item* cur = this->start;
 	Item* next;
 
@@ -164,13 +217,155 @@ BdfNamedList* BdfNamedList::clear()
 	{
 		next = cur->next;
 
-		delete cur->object;
-		delete cur;
+		BdfObject::release(cur->object, this);
+		lookupTable->removeKeyUse(cur->key);
+		lookupTable->pool.destroy(cur);
 
 		cur = next;
 	}
 
-	return this;
+	start = NULL;
+	end = &start;
+}
+
+BdfMemoryUsage BdfNamedList::memoryUsage() const
+{
+	BdfMemoryUsage usage;
+	usage.nodes = sizeof(BdfNamedList);
+
+	for(Item* item = start; item != NULL; item = item->next)
+	{
+		usage.items += sizeof(Item);
+
+		if(item->object != NULL) {
+			usage += item->object->memoryUsage();
+		}
+	}
+
+	return usage;
+}
+
+uint64_t BdfNamedList::hash() const noexcept
+{
+	uint64_t h = 0;
+
+	// Sum the hashes of the items, so the order they were set in doesn't matter
+	for(Item* item = start; item != NULL; item = item->next)
+	{
+		const std::string &key = lookupTable->getName(item->key);
+		uint64_t object_hash = (item->object == NULL) ? 0 : item->object->hash();
+
+		h += hash_mix(hash_bytes(key.data(), key.size(), BdfTypes::NAMED_LIST) + hash_mix(object_hash));
+	}
+
+	return hash_mix(h ^ BdfTypes::NAMED_LIST);
+}
+
+BdfNamedList* BdfNamedList::shallowCopy() const
+{
+	BdfNamedList* named = lookupTable->pool.create<BdfNamedList>(lookupTable);
+
+	// Keys are already unique, so the items can be added to the end without searching
+	for(Item* item = start; item != NULL; item = item->next)
+	{
+		BDF_STATS_ALLOC(lookupTable->stats, sizeof(Item));
+		Item* copied = lookupTable->pool.create<Item>(item->key, (item->object == NULL) ? NULL : item->object->share(), nullptr);
+		lookupTable->addKeyUse(item->key);
+
+		*named->end = copied;
+		named->end = &copied->next;
+
+		// The copy takes the place of this named list in the document that can be changed
+		named->adopt(copied->object);
+	}
+
+	return named;
+}
+
+BdfNamedList* BdfNamedList::unshare()
+{
+	if(owner == nullptr || !lookupTable->isShared()) {
+		return this;
+	}
+
+	return (BdfNamedList*)owner->unshare()->object;
+}
+
+BdfObject** BdfNamedList::findSlot(const BdfObject* object) const noexcept
+{
+	for(Item* item = start; item != NULL; item = item->next)
+	{
+		if(item->object == object) {
+			return &item->object;
+		}
+	}
+
+	return nullptr;
+}
+
+void BdfNamedList::adopt(BdfObject* object) noexcept
+{
+	if(object != NULL) {
+		object->parent = this;
+		object->parent_type = BdfTypes::NAMED_LIST;
+	}
+}
+
+bool BdfNamedList::operator==(const BdfNamedList &rhs) const noexcept
+{
+	int size = 0;
+	int rhs_size = 0;
+
+	for(Item* item = start; item != NULL; item = item->next) {
+		size += 1;
+	}
+
+	for(Item* item = rhs.start; item != NULL; item = item->next) {
+		rhs_size += 1;
+	}
+
+	if(size != rhs_size) {
+		return false;
+	}
+
+	for(Item* item = start; item != NULL; item = item->next)
+	{
+		Item* other = rhs.start;
+
+		if(lookupTable == rhs.lookupTable)
+		{
+			while(other != NULL && other->key != item->key) {
+				other = other->next;
+			}
+		}
+
+		else
+		{
+			// Locations only mean something within their own lookup table
+			const std::string &key = lookupTable->getName(item->key);
+
+			while(other != NULL && rhs.lookupTable->getName(other->key) != key) {
+				other = other->next;
+			}
+		}
+
+		if(other == NULL) {
+			return false;
+		}
+
+		if(item->object == NULL || other->object == NULL)
+		{
+			if(item->object != other->object) {
+				return false;
+			}
+		}
+
+		else if(!(*item->object == *other->object)) {
+			return false;
+		}
+	}
+
+	return true;
 }
 
 std::vector<int> BdfNamedList::keys()
@@ -185,7 +380,7 @@ std::vector<int> BdfNamedList::keys()
 		cur = cur->next;
 	}
 
-	keys.resize(size);
+	keys.reserve(size);
 	cur = this->start;
 
 	while(cur != NULL)
@@ -197,7 +392,14 @@ std::vector<int> BdfNamedList::keys()
 	return keys;
 }
 
-bool BdfNamedList::exists(std::string key) {
+bool BdfNamedList::exists(std::string_view key)
+{
+	// Copies of the reader may be read from other threads, so only the reader changing the document adds keys
+	if(lookupTable->isShared()) {
+		int location = lookupTable->findLocation(key);
+		return location != -1 && exists(location);
+	}
+
 	return exists(lookupTable->getLocation(key));
 }
 
@@ -218,19 +420,35 @@ bool BdfNamedList::exists(int key)
 	return false;
 }
 
-BdfNamedList* BdfNamedList::set(std::string key, BdfObject* v) {
+BdfNamedList* BdfNamedList::set(std::string_view key, BdfObject* v)
+{
+	BdfNamedList* copy = unshare();
+
+	if(copy != this) {
+		return copy->set(key, v);
+	}
+
 	return set(lookupTable->getLocation(key), v);
 }
 
 BdfNamedList* BdfNamedList::set(int key, BdfObject* v)
 {
+	BdfNamedList* copy = unshare();
+
+	if(copy != this) {
+		return copy->set(key, v);
+	}
+
+	lookupTable->generation += 1;
+	adopt(v);
+
 	Item* cur = this->start;
 
 	while(cur != NULL)
 	{
 		if(cur->key == key)
 		{
-			delete cur->object;
+			BdfObject::release(cur->object, this);
 			cur->object = v;
 
 			return this;
@@ -239,7 +457,9 @@ BdfNamedList* BdfNamedList::set(int key, BdfObject* v)
 		cur = cur->next;
 	}
 
-	Item* item = new Item(key, v, NULL);
+	BDF_STATS_ALLOC(lookupTable->stats, sizeof(Item));
+	Item* item = lookupTable->pool.create<Item>(key, v, nullptr);
+	lookupTable->addKeyUse(key);
 
 	*this->end = item;
 	this->end = &item->next;
@@ -247,12 +467,27 @@ BdfNamedList* BdfNamedList::set(int key, BdfObject* v)
 	return this;
 }
 
-BdfObject* BdfNamedList::remove(std::string key) {
+BdfObject* BdfNamedList::remove(std::string_view key)
+{
+	BdfNamedList* copy = unshare();
+
+	if(copy != this) {
+		return copy->remove(key);
+	}
+
 	return remove(lookupTable->getLocation(key));
 }
 
 BdfObject* BdfNamedList::remove(int key)
 {
+	BdfNamedList* copy = unshare();
+
+	if(copy != this) {
+		return copy->remove(key);
+	}
+
+	lookupTable->generation += 1;
+
 	Item** cur = &this->start;
 
 	while(*cur != NULL)
@@ -262,8 +497,13 @@ BdfObject* BdfNamedList::remove(int key)
 			BdfObject* object = (*cur)->object;
 			Item* next = (*cur)->next;
 
-			delete (*cur)->object;
-			delete *cur;
+			if(end == &(*cur)->next) {
+				end = cur;
+			}
+
+			BdfObject::release((*cur)->object, this);
+			lookupTable->removeKeyUse(key);
+			lookupTable->pool.destroy(*cur);
 
 			*cur = next;
 
@@ -276,7 +516,20 @@ BdfObject* BdfNamedList::remove(int key)
 	return NULL;
 }
 
-BdfObject* BdfNamedList::get(std::string key) {
+BdfObject* BdfNamedList::get(std::string_view key)
+{
+	// Keys already in the table are found without changing it, so copies of the reader can be read from other threads
+	if(lookupTable->isShared())
+	{
+		int location = lookupTable->findLocation(key);
+
+		if(location != -1) {
+			return get(location);
+		}
+
+		return unshare()->get(lookupTable->getLocation(key));
+	}
+
 	return get(lookupTable->getLocation(key));
 }
 
@@ -294,7 +547,14 @@ BdfObject* BdfNamedList::get(int key)
 		cur = cur->next;
 	}
 
-	BdfObject* v = new BdfObject(lookupTable);
+	// Missing keys are added, which changes the named list
+	BdfNamedList* copy = unshare();
+
+	if(copy != this) {
+		return copy->get(key);
+	}
+
+	BdfObject* v = lookupTable->pool.create<BdfObject>(lookupTable);
 	set(key, v);
 
 	return v;
@@ -324,51 +584,84 @@ int BdfNamedList::serializeSeeker(int* locations)
 	return size;
 }
 
+static int serializeItem(char* data, BdfObject* object, int location, int* locations)
+{
+	char size_bytes_tag;
+	char size_bytes;
+
+	if(location > 65535) {
+		size_bytes_tag = 0;
+		size_bytes = 4;
+	} else if(location > 255) {
+		size_bytes_tag = 1;
+		size_bytes = 2;
+	} else {
+		size_bytes_tag = 2;
+		size_bytes = 1;
+	}
+
+	int size = object->serialize(data, locations, size_bytes_tag);
+
+	switch(size_bytes_tag)
+	{
+		case 0:
+			put_netsi(data + size, location);
+			break;
+		case 1:
+			put_netus(data + size, location);
+			break;
+		default:
+			data[size] = location & 255;
+	}
+
+	return size + size_bytes;
+}
+
 int BdfNamedList::serialize(char* data, int* locations)
 {
 	int pos = 0;
 	Item* cur = this->start;
 
-	while(cur != NULL)
+	// Canonical data stores the items in the order of their keys' locations, which follow the key names
+	if(lookupTable->serializeOptions.canonical)
 	{
-		int location = locations[cur->key];
+		std::vector<Item*> items;
 
-		char size_bytes_tag;
-		char size_bytes;
-
-		if(location > 65535) {
-			size_bytes_tag = 0;
-			size_bytes = 4;
-		} else if(location > 255) {
-			size_bytes_tag = 1;
-			size_bytes = 2;
-		} else {
-			size_bytes_tag = 2;
-			size_bytes = 1;
+		for(; cur != NULL; cur = cur->next) {
+			items.push_back(cur);
 		}
 
-		int size = cur->object->serialize(data + pos, locations, size_bytes_tag);
-		int offset = pos + size;
+		std::sort(items.begin(), items.end(), [locations](Item* a, Item* b) {
+			return locations[a->key] < locations[b->key];
+		});
 
-		switch(size_bytes_tag)
-		{
-			case 0:
-				put_netsi(data + offset, location);
-				break;
-			case 1:
-				put_netus(data + offset, location);
-				break;
-			default:
-				data[offset] = location & 255;
+		for(Item* item : items) {
+			pos += serializeItem(data + pos, item->object, locations[item->key], locations);
 		}
 
-		pos += size + size_bytes;
+		return pos;
+	}
+
+	while(cur != NULL)
+	{
+		pos += serializeItem(data + pos, cur->object, locations[cur->key], locations);
 		cur = cur->next;
 	}
 
 	return pos;
 }
 
+int BdfNamedList::getGatheredSize() const noexcept
+{
+	int size = 0;
+
+	for(Item* cur = start; cur != NULL; cur = cur->next) {
+		size += cur->object->getGatheredSize();
+	}
+
+	return size;
+}
+
 void BdfNamedList::serializeHumanReadable(std::ostream &out, const BdfIndent &indent, int it) const
 {
 	if(this->start == NULL)
@@ -392,7 +685,7 @@ void BdfNamedList::serializeHumanReadable(std::ostream &out, const BdfIndent &in
 				out << indent.indent;
 			}
 			
-			std::string name = lookupTable->getName(cur->key);
+			const std::string &name = lookupTable->getName(cur->key);
 	
 			out << serializeString(name) << ": ";
 			cur->object->serializeHumanReadable(out, indent, it + 1);
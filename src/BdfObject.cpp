@@ -6,6 +6,10 @@
 #include <sstream>
 #include <math.h>
 #include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+#include <climits>
 
 using namespace Bdf;
 using namespace BdfHelpers;
@@ -25,6 +29,17 @@ char BdfObject::getSizeBytes(char size_bytes_tag)
 	}
 }
 
+char BdfObject::getLocationSizeTag(int location)
+{
+	if(location > 65535) {
+		return 0;
+	} else if(location > 255) {
+		return 1;
+	} else {
+		return 2;
+	}
+}
+
 int getDefaultSize(char type)
 {
 	switch(type)
@@ -63,6 +78,11 @@ int BdfObject::getSize(const char* data)
 
 	char size_bytes = getSizeBytes(size_tag);
 
+	// String references only store the location of the string
+	if(type == BdfTypes::STRING_REF) {
+		return 1 + size_bytes;
+	}
+
 	switch(size_bytes)
 	{
 		case 4: return get_netsi(data + 1);
@@ -73,12 +93,43 @@ int BdfObject::getSize(const char* data)
 	return 0;
 }
 
+int BdfObject::getCheckedSize(const char* data, int available)
+{
+	if(available < 1) {
+		return -1;
+	}
+
+	char type, size_tag;
+	getFlagData(data, &type, &size_tag, NULL);
+
+	if(shouldStoreSize(type) && 1 + getSizeBytes(size_tag) > available) {
+		return -1;
+	}
+
+	int size = getSize(data);
+
+	if(size <= 0 || size > available) {
+		return -1;
+	}
+
+	return size;
+}
+
 void BdfObject::getFlagData(const char* data, char* pType, char* pSizeBytes, char* pParentFlags)
 {
 	unsigned char flags = *(unsigned char*)data;
-	
-	unsigned char type = flags % 18;
-	flags = (flags - type) / 18;
+	unsigned char type;
+
+	// Flag bytes from 162 onwards hold the compact encodings, which
+	// are packed the same way but with room for 10 types instead of 18
+	if(flags >= 162) {
+		flags -= 162;
+		type = flags % 10 + 18;
+		flags /= 10;
+	} else {
+		type = flags % 18;
+		flags /= 18;
+	}
 
 	unsigned char size_bytes = flags % 3;
 	flags = (flags - size_bytes) / 3;
@@ -96,26 +147,224 @@ void BdfObject::getFlagData(const char* data, char* pType, char* pSizeBytes, cha
 		*pParentFlags = parent_flags;
 }
 
+unsigned char BdfObject::getFlags(char type, char size_bytes_tag, char parent_flags)
+{
+	if(type >= 18) {
+		return (unsigned char)(162 + (type - 18) + (size_bytes_tag * 10) + (parent_flags * 3 * 10));
+	}
+
+	return (unsigned char)(type + (size_bytes_tag * 18) + (parent_flags * 3 * 18));
+}
+
+template<typename U> static U getNetArrayElement(const char* data);
+template<> uint16_t getNetArrayElement<uint16_t>(const char* data) { return get_netus(data); }
+template<> uint32_t getNetArrayElement<uint32_t>(const char* data) { return get_netui(data); }
+template<> uint64_t getNetArrayElement<uint64_t>(const char* data) { return get_netul(data); }
+
+template<typename U> static void putNetArrayElement(char* data, U num);
+template<> void putNetArrayElement<uint16_t>(char* data, uint16_t num) { put_netus(data, num); }
+template<> void putNetArrayElement<uint32_t>(char* data, uint32_t num) { put_netui(data, num); }
+template<> void putNetArrayElement<uint64_t>(char* data, uint64_t num) { put_netul(data, num); }
+
+/*
+ * Gets the difference between v and last zigzag encoded, so small
+ * negative differences also become small unsigned numbers.
+ */
+template<typename U> static U zigzagDelta(U v, U last)
+{
+	U delta = (U)(v - last);
+	U sign = (U)(0 - (U)(delta >> (sizeof(U) * 8 - 1)));
+
+	return (U)((U)(delta << 1) ^ sign);
+}
+
+template<typename U> static U unzigzagDelta(U zigzag, U last)
+{
+	U delta = (U)((U)(zigzag >> 1) ^ (U)(0 - (U)(zigzag & 1)));
+
+	return (U)(last + delta);
+}
+
+/*
+ * Compact arrays are stored as a varint with the number of elements,
+ * followed by the zigzag encoded difference from the last element as a varint.
+ */
+template<typename U> static int getCompactArraySize(const char* data, int size)
+{
+	int count = size / sizeof(U);
+	int compact_size = varintSize(count);
+	U last = 0;
+
+	for(int i=0;i<count;i++)
+	{
+		U v = getNetArrayElement<U>(data + i * sizeof(U));
+		compact_size += varintSize(zigzagDelta(v, last));
+		last = v;
+	}
+
+	return compact_size;
+}
+
+template<typename U> static int serializeCompactArray(char* pData, const char* data, int size)
+{
+	int count = size / sizeof(U);
+	int pos = put_varint(pData, count);
+	U last = 0;
+
+	for(int i=0;i<count;i++)
+	{
+		U v = getNetArrayElement<U>(data + i * sizeof(U));
+		pos += put_varint(pData + pos, zigzagDelta(v, last));
+		last = v;
+	}
+
+	return pos;
+}
+
+template<typename U> static bool parseCompactArray(BdfPool* pool, const char* pData, int pSize, char** pArray, int* pArraySize)
+{
+	uint64_t count;
+	int pos = get_varint(pData, pSize, &count);
+
+	// Every element takes at least 1 byte, and the decoded array has to fit in an int
+	if(pos == -1 || count > (uint64_t)(pSize - pos) || count > INT_MAX / sizeof(U)) {
+		return false;
+	}
+
+	int size = (int)(count * sizeof(U));
+	char* array = (char*)pool->allocate(size);
+	U last = 0;
+	int i = 0;
+
+	while(i < (int)count)
+	{
+		// Runs of 8 single byte varints (no continuation bits set) are
+		// very common for sorted ids and counters, so decode them in one go
+		if((int)count - i >= 8 && pSize - pos >= 8)
+		{
+			uint64_t word;
+			memcpy(&word, pData + pos, 8);
+
+			if((word & 0x8080808080808080ULL) == 0)
+			{
+				for(int j=0;j<8;j++) {
+					last = unzigzagDelta((U)(pData[pos + j] & 127), last);
+					putNetArrayElement<U>(array + (i + j) * sizeof(U), last);
+				}
+
+				pos += 8;
+				i += 8;
+				continue;
+			}
+		}
+
+		uint64_t zigzag;
+		int varint_size = get_varint(pData + pos, pSize - pos, &zigzag);
+
+		if(varint_size == -1 || zigzag > (U)-1) {
+			pool->deallocate(array, size);
+			return false;
+		}
+
+		last = unzigzagDelta((U)zigzag, last);
+		putNetArrayElement<U>(array + i * sizeof(U), last);
+
+		pos += varint_size;
+		i += 1;
+	}
+
+	if(pos != pSize) {
+		pool->deallocate(array, size);
+		return false;
+	}
+
+	*pArray = array;
+	*pArraySize = size;
+
+	return true;
+}
+
+static char getCompactArrayType(char type)
+{
+	switch(type)
+	{
+		case BdfTypes::ARRAY_INTEGER:
+			return BdfTypes::ARRAY_INTEGER_VARINT;
+		case BdfTypes::ARRAY_LONG:
+			return BdfTypes::ARRAY_LONG_VARINT;
+		case BdfTypes::ARRAY_SHORT:
+			return BdfTypes::ARRAY_SHORT_VARINT;
+		default:
+			return type;
+	}
+}
+
 BdfObject::BdfObject(BdfLookupTable* pLookupTable, const char *pData, int pSize)
 {
 	s = 0;
 	last_seek = 0;
+	last_seek_type = BdfTypes::UNDEFINED;
+	interned = false;
 	data = NULL;
+	data_capacity = 0;
 	object = NULL;
 	type = BdfTypes::UNDEFINED;
 	lookupTable = pLookupTable;
+	hash_value = 0;
+	hash_generation = 0;
+	references = 1;
+	parent = NULL;
+	parent_type = BdfTypes::UNDEFINED;
+	frozen = false;
+
+	BDF_STATS_ALLOC(lookupTable->stats, sizeof(BdfObject));
 
 	if(pSize > 1)
 	{
+		BDF_STATS_NODE(lookupTable->stats, &type);
+
 		// Get the type and database values
-		unsigned char flags = *(unsigned char*)pData;
-		type = (char)(flags % 18);
-		flags = (char)((flags - type) / 18);
-		char size_bytes = getSizeBytes(flags % 3);
+		char size_bytes_tag;
+		getFlagData(pData, &type, &size_bytes_tag, NULL);
+		char size_bytes = getSizeBytes(size_bytes_tag);
 		
 		const char* oData = pData + 1;
 		s = pSize - 1;
 
+		if(type == BdfTypes::STRING_REF)
+		{
+			const std::string* str = nullptr;
+
+			if(s >= size_bytes)
+			{
+				switch(size_bytes)
+				{
+					case 4:
+						str = lookupTable->getString(get_netui(oData));
+						break;
+					case 2:
+						str = lookupTable->getString(get_netus(oData));
+						break;
+					default:
+						str = lookupTable->getString(oData[0] & 255);
+				}
+			}
+
+			if(str == nullptr) {
+				type = BdfTypes::UNDEFINED;
+				s = 0;
+				return;
+			}
+
+			// Share the string with every other reference to it
+			type = BdfTypes::STRING;
+			object = (void*)str;
+			interned = true;
+			s = str->size();
+
+			return;
+		}
+
 		if(shouldStoreSize(type)) {
 			oData += size_bytes;
 			s -= size_bytes;
@@ -130,20 +379,71 @@ BdfObject::BdfObject(BdfLookupTable* pLookupTable, const char *pData, int pSize)
 		switch(type)
 		{
 			case BdfTypes::STRING:
-				object = new std::string(oData, s);
+				BDF_STATS_ALLOC(lookupTable->stats, sizeof(std::string) + s);
+				object = lookupTable->pool.create<std::string>(oData, s);
 				break;
 			case BdfTypes::LIST:
-				object = new BdfList(lookupTable, oData, s);
+				object = lookupTable->pool.create<BdfList>(lookupTable, oData, s);
+				((BdfList*)object)->owner = this;
 				break;
 			case BdfTypes::NAMED_LIST:
-				object = new BdfNamedList(lookupTable, oData, s);
+				object = lookupTable->pool.create<BdfNamedList>(lookupTable, oData, s);
+				((BdfNamedList*)object)->owner = this;
 				break;
+			case BdfTypes::LIST_COLUMNAR:
+				// Expand the columns back into rows
+				type = BdfTypes::LIST;
+				object = BdfColumns::expand(lookupTable, oData, s);
+
+				if(object == NULL) {
+					type = BdfTypes::UNDEFINED;
+					s = 0;
+				} else {
+					((BdfList*)object)->owner = this;
+				}
+
+				return;
+			case BdfTypes::ARRAY_INTEGER_VARINT:
+			case BdfTypes::ARRAY_LONG_VARINT:
+			case BdfTypes::ARRAY_SHORT_VARINT:
+			{
+				bool valid;
+
+				// Decode compact arrays so they can be used like any other array
+				if(type == BdfTypes::ARRAY_INTEGER_VARINT) {
+					type = BdfTypes::ARRAY_INTEGER;
+					valid = parseCompactArray<uint32_t>(&lookupTable->pool, oData, s, &data, &s);
+				} else if(type == BdfTypes::ARRAY_LONG_VARINT) {
+					type = BdfTypes::ARRAY_LONG;
+					valid = parseCompactArray<uint64_t>(&lookupTable->pool, oData, s, &data, &s);
+				} else {
+					type = BdfTypes::ARRAY_SHORT;
+					valid = parseCompactArray<uint16_t>(&lookupTable->pool, oData, s, &data, &s);
+				}
+
+				if(!valid) {
+					type = BdfTypes::UNDEFINED;
+					s = 0;
+				}
+
+				data_capacity = (data == NULL) ? 0 : s;
+
+				return;
+			}
 			case BdfTypes::UNDEFINED:
 				return;
+			default:
+				// Encodings added by newer versions can't be read
+				if(type > BdfTypes::ARRAY_FLOAT) {
+					type = BdfTypes::UNDEFINED;
+					s = 0;
+					return;
+				}
 		}
 
 		if(object == NULL) {
-			data = new char[s];
+			BDF_STATS_ALLOC(lookupTable->stats, s);
+			data = newData(s);
 			memcpy(data, oData, s);
 		}
 	}
@@ -190,20 +490,32 @@ BdfObject::BdfObject(BdfLookupTable* pLookupTable, BdfStringReader* sr)
 {
 	s = 0;
 	last_seek = 0;
+	last_seek_type = BdfTypes::UNDEFINED;
+	interned = false;
 	data = NULL;
+	data_capacity = 0;
 	object = NULL;
 	type = BdfTypes::UNDEFINED;
 	lookupTable = pLookupTable;
+	hash_value = 0;
+	hash_generation = 0;
+	references = 1;
+	parent = NULL;
+	parent_type = BdfTypes::UNDEFINED;
+	frozen = false;
+
+	BDF_STATS_ALLOC(lookupTable->stats, sizeof(BdfObject));
+	BDF_STATS_NODE(lookupTable->stats, &this->type);
 
 	wchar_t c = sr->upto[0];
 	
 	if(c == '{') {
-		setNamedList(new BdfNamedList(lookupTable, sr));
+		setNamedList(lookupTable->pool.create<BdfNamedList>(lookupTable, sr));
 		return;
 	}
 
 	if(c == '[') {
-		setList(new BdfList(lookupTable, sr));
+		setList(lookupTable->pool.create<BdfList>(lookupTable, sr));
 		return;
 	}
 
@@ -747,14 +1059,251 @@ BdfObject::~BdfObject() {
 	freeAll();
 }
 
+char* BdfObject::newData(int size)
+{
+	char* allocated = (char*)lookupTable->pool.allocate(size);
+	data_capacity = size;
+
+	return allocated;
+}
+
+BdfObject* BdfObject::share() noexcept
+{
+	references.fetch_add(1);
+
+	return this;
+}
+
+void BdfObject::release(BdfObject* object) noexcept
+{
+	if(object != nullptr && --object->references == 0) {
+		object->lookupTable->pool.destroy(object);
+	}
+}
+
+void BdfObject::release(BdfObject* object, const void* holder) noexcept
+{
+	if(object == nullptr) {
+		return;
+	}
+
+	// Once it leaves the document that can be changed, only copies of the reader hold the object
+	if(object->parent == holder || holder == object->lookupTable->writer)
+	{
+		object->parent = NULL;
+		object->parent_type = BdfTypes::UNDEFINED;
+
+		if(object->references > 1) {
+			object->frozen = true;
+		}
+	}
+
+	release(object);
+}
+
+BdfObject* BdfObject::getHolder() const noexcept
+{
+	switch(parent_type)
+	{
+		case BdfTypes::LIST:
+			return ((BdfList*)parent)->owner;
+		case BdfTypes::NAMED_LIST:
+			return ((BdfNamedList*)parent)->owner;
+		default:
+			return nullptr;
+	}
+}
+
+BdfObject* BdfObject::unshare()
+{
+	// Copies deleted on other threads leave their objects to be released here
+	if(lookupTable->hasRetired())
+	{
+		if(frozen) {
+			throw std::logic_error("The object is only held by copies of the reader, which can't be changed.");
+		}
+
+		lookupTable->freeRetired();
+	}
+
+	if(!lookupTable->isShared()) {
+		return this;
+	}
+
+	if(frozen) {
+		throw std::logic_error("The object is only held by copies of the reader, which can't be changed.");
+	}
+
+	BdfReader* writer = lookupTable->writer;
+	BdfObject* holder = getHolder();
+	BdfObject** slot;
+	void* container = NULL;
+
+	if(holder == nullptr)
+	{
+		if(writer == nullptr || writer->bdf != this)
+		{
+			// Objects not in any document aren't held by a copy
+			if(references > 1) {
+				throw std::logic_error("The object is only held by copies of the reader, which can't be changed.");
+			}
+
+			return this;
+		}
+
+		if(references == 1) {
+			return this;
+		}
+
+		slot = &writer->bdf;
+	}
+
+	else
+	{
+		// Copy the objects on the way from the root object first, so the copy goes into a list
+		// or named list that only the reader that was copied holds
+		BdfObject* holder_new = holder->unshare();
+
+		if(holder_new == holder && references == 1) {
+			return this;
+		}
+
+		container = holder_new->object;
+
+		if(parent_type == BdfTypes::LIST) {
+			slot = ((BdfList*)container)->findSlot(this);
+		} else {
+			slot = ((BdfNamedList*)container)->findSlot(this);
+		}
+
+		if(slot == nullptr) {
+			throw std::logic_error("The object isn't held by the list or named list it was added to.");
+		}
+	}
+
+	BdfObject* copy = shallowCopy();
+
+	if(container != NULL) {
+		copy->parent = container;
+		copy->parent_type = parent_type;
+	}
+
+	// Only copies of the reader hold this object from now on, if any
+	*slot = copy;
+	parent = NULL;
+	parent_type = BdfTypes::UNDEFINED;
+	frozen = true;
+	release(this);
+
+	return copy;
+}
+
+BdfObject* BdfObject::shallowCopy() const
+{
+	// Copy only this object. Lists and named lists get new items pointing to the same objects,
+	// which are copied in turn if they are ever changed.
+	BdfObject* copy = lookupTable->pool.create<BdfObject>(lookupTable);
+	lookupTable->seekGeneration += 1;
+
+	copy->type = type;
+	copy->s = s;
+	copy->hash_value = hash_value;
+	copy->hash_generation = hash_generation;
+
+	try
+	{
+		switch(type)
+		{
+			case BdfTypes::UNDEFINED:
+				break;
+			case BdfTypes::LIST:
+				if(object != NULL) {
+					BdfList* list = ((BdfList*)object)->shallowCopy();
+					list->owner = copy;
+					copy->object = list;
+				}
+
+				break;
+			case BdfTypes::NAMED_LIST:
+				if(object != NULL) {
+					BdfNamedList* list = ((BdfNamedList*)object)->shallowCopy();
+					list->owner = copy;
+					copy->object = list;
+				}
+
+				break;
+			case BdfTypes::STRING:
+				if(interned || object == NULL) {
+					copy->object = object;
+					copy->interned = interned;
+				} else {
+					BDF_STATS_ALLOC(lookupTable->stats, sizeof(std::string) + ((std::string*)object)->size());
+					copy->object = lookupTable->pool.create<std::string>(*(std::string*)object);
+				}
+
+				break;
+			default:
+				if(data != NULL)
+				{
+					BDF_STATS_ALLOC(lookupTable->stats, s);
+					copy->data = copy->newData(s);
+
+					memcpy(copy->data, data, s);
+				}
+		}
+	}
+
+	catch(...)
+	{
+		lookupTable->pool.destroy(copy);
+		throw;
+	}
+
+	return copy;
+}
+
+void BdfObject::relink() noexcept
+{
+	frozen = false;
+
+	if(type == BdfTypes::LIST && object != NULL)
+	{
+		BdfList* list = (BdfList*)object;
+		list->owner = this;
+
+		for(BdfList::Item* item = list->startItem; item != NULL; item = item->next) {
+			if(item->object != NULL) {
+				list->adopt(item->object);
+				item->object->relink();
+			}
+		}
+	}
+
+	else if(type == BdfTypes::NAMED_LIST && object != NULL)
+	{
+		BdfNamedList* list = (BdfNamedList*)object;
+		list->owner = this;
+
+		for(BdfNamedList::Item* item = list->start; item != NULL; item = item->next) {
+			if(item->object != NULL) {
+				list->adopt(item->object);
+				item->object->relink();
+			}
+		}
+	}
+}
+
 void BdfObject::freeAll()
 {
+	// Everything calling this is about to change the object
+	lookupTable->generation += 1;
+
 	switch(type)
 	{
 		case BdfTypes::LIST:
 		{
 			if(object != NULL) {
-				delete (BdfList*)object;
+				lookupTable->pool.destroy((BdfList*)object);
 				object = NULL;
 			}
 		
@@ -764,7 +1313,7 @@ void BdfObject::freeAll()
 		case BdfTypes::NAMED_LIST:
 		{
 			if(object != NULL) {
-				delete (BdfNamedList*)object;
+				lookupTable->pool.destroy((BdfNamedList*)object);
 				object = NULL;
 			}
 			
@@ -773,20 +1322,24 @@ void BdfObject::freeAll()
 
 		case BdfTypes::STRING:
 		{
-			if(object != NULL) {
-				delete (std::string*)object;
-				object = NULL;
+			// Interned strings belong to the lookup table
+			if(object != NULL && !interned) {
+				lookupTable->pool.destroy((std::string*)object);
 			}
 
+			object = NULL;
+			interned = false;
+
 			break;
 		}
 	}
 
 	if(data != NULL)
 	{
-		delete[] data;
+		lookupTable->pool.deallocate(data, data_capacity);
 
 		data = NULL;
+		data_capacity = 0;
 	}
 
 	type = BdfTypes::UNDEFINED;
@@ -799,6 +1352,7 @@ char BdfObject::getType() {
 int BdfObject::serializeSeeker(int* locations)
 {
 	int size = getDefaultSize(type);
+	last_seek_type = type;
 	
 	if(size != -1) {
 		last_seek = size;
@@ -809,21 +1363,70 @@ int BdfObject::serializeSeeker(int* locations)
 	switch(type)
 	{
 		case BdfTypes::STRING:
+		{
+			// Strings in the string table are stored as a reference to their location
+			int location = lookupTable->getStringLocation(*(std::string*)object);
+
+			if(location != -1) {
+				last_seek_type = BdfTypes::STRING_REF;
+				last_seek = 1 + getSizeBytes(getLocationSizeTag(location));
+				return last_seek;
+			}
+
 			size = ((std::string*)object)->size() + 1;
 			break;
+		}
 		case BdfTypes::NAMED_LIST:
 			size = ((BdfNamedList*)object)->serializeSeeker(locations) + 1;
 			break;
 		case BdfTypes::LIST:
 			size = ((BdfList*)object)->serializeSeeker(locations) + 1;
-			break;
-		default:
-			size = s + 1;
-	}
 
-	int size_bytes;
+			if(((BdfList*)object)->serializesAsColumns()) {
+				last_seek_type = BdfTypes::LIST_COLUMNAR;
+			}
 
-	if(size > 65531) {
+			break;
+		case BdfTypes::ARRAY_INTEGER:
+		case BdfTypes::ARRAY_LONG:
+		case BdfTypes::ARRAY_SHORT:
+		{
+			size = s + 1;
+
+			BdfSerializeOptions::ArrayEncoding encoding = lookupTable->serializeOptions.arrayEncoding;
+
+			if(encoding == BdfSerializeOptions::ArrayEncoding::FIXED) {
+				break;
+			}
+
+			int compact_size;
+
+			switch(type)
+			{
+				case BdfTypes::ARRAY_INTEGER:
+					compact_size = getCompactArraySize<uint32_t>(data, s) + 1;
+					break;
+				case BdfTypes::ARRAY_LONG:
+					compact_size = getCompactArraySize<uint64_t>(data, s) + 1;
+					break;
+				default:
+					compact_size = getCompactArraySize<uint16_t>(data, s) + 1;
+			}
+
+			if(encoding == BdfSerializeOptions::ArrayEncoding::COMPACT || compact_size < size) {
+				size = compact_size;
+				last_seek_type = getCompactArrayType(type);
+			}
+
+			break;
+		}
+		default:
+			size = s + 1;
+	}
+
+	int size_bytes;
+
+	if(size > 65531) {
 		size_bytes = 4;
 	} else if(size > 253) {
 		size_bytes = 2;
@@ -837,8 +1440,65 @@ int BdfObject::serializeSeeker(int* locations)
 	return size;
 }
 
+/**
+ * Replaces every NaN in the big-endian doubles or floats at data with the same quiet NaN,
+ * so NaNs with different payloads are stored as the same bytes in canonical data.
+ */
+static void canonicalizeNaNs(char* data, int size, char type)
+{
+	switch(type)
+	{
+		case BdfTypes::DOUBLE:
+		case BdfTypes::ARRAY_DOUBLE:
+			for(int i=0;i+8<=size;i+=8)
+			{
+				uint64_t v = get_netul(data + i);
+
+				if((v & 0x7ff0000000000000ULL) == 0x7ff0000000000000ULL && (v & 0x000fffffffffffffULL) != 0) {
+					put_netul(data + i, 0x7ff8000000000000ULL);
+				}
+			}
+
+			break;
+		case BdfTypes::FLOAT:
+		case BdfTypes::ARRAY_FLOAT:
+			for(int i=0;i+4<=size;i+=4)
+			{
+				uint32_t v = get_netui(data + i);
+
+				if((v & 0x7f800000U) == 0x7f800000U && (v & 0x007fffffU) != 0) {
+					put_netui(data + i, 0x7fc00000U);
+				}
+			}
+
+			break;
+	}
+}
+
 int BdfObject::serialize(char *pData, int* locations, unsigned char parent_flags)
 {
+	if(last_seek_type == BdfTypes::STRING_REF)
+	{
+		int location = lookupTable->getStringLocation(*(std::string*)object);
+		char location_size_tag = getLocationSizeTag(location);
+
+		pData[0] = getFlags(BdfTypes::STRING_REF, location_size_tag, parent_flags);
+
+		switch(location_size_tag)
+		{
+			case 0:
+				put_netsi(pData + 1, location);
+				break;
+			case 1:
+				put_netus(pData + 1, location);
+				break;
+			default:
+				pData[1] = location & 255;
+		}
+
+		return last_seek;
+	}
+
 	int size = last_seek;
 	bool storeSize = shouldStoreSize(type);
 
@@ -860,13 +1520,20 @@ int BdfObject::serialize(char *pData, int* locations, unsigned char parent_flags
 	}
 
 	int offset = size_bytes + 1;
-	unsigned char flags = (unsigned char)(type + (size_bytes_tag * 18) + (parent_flags * 3 * 18));
+	unsigned char flags = getFlags(last_seek_type, size_bytes_tag, parent_flags);
 	
 	// Objects
-	switch(type)
+	switch(last_seek_type)
 	{
 		case BdfTypes::STRING: {
 			std::string* str = (std::string*)object;
+
+			if(isGathered()) {
+				lookupTable->gathered->push_back({pData + offset, str->data(), (int)str->size()});
+				size = offset;
+				break;
+			}
+
 			memcpy(pData + offset, str->c_str(), str->size());
 			size = str->size() + offset;
 			break;
@@ -876,7 +1543,8 @@ int BdfObject::serialize(char *pData, int* locations, unsigned char parent_flags
 			size = v->serialize(pData + offset, locations) + offset;
 			break;
 		}
-		case BdfTypes::LIST: {
+		case BdfTypes::LIST:
+		case BdfTypes::LIST_COLUMNAR: {
 			BdfList* v = (BdfList*)object;
 			size = v->serialize(pData + offset, locations) + offset;
 			break;
@@ -884,36 +1552,109 @@ int BdfObject::serialize(char *pData, int* locations, unsigned char parent_flags
 		case BdfTypes::UNDEFINED: {
 			break;
 		}
+		case BdfTypes::ARRAY_INTEGER_VARINT: {
+			size = serializeCompactArray<uint32_t>(pData + offset, data, s) + offset;
+			break;
+		}
+		case BdfTypes::ARRAY_LONG_VARINT: {
+			size = serializeCompactArray<uint64_t>(pData + offset, data, s) + offset;
+			break;
+		}
+		case BdfTypes::ARRAY_SHORT_VARINT: {
+			size = serializeCompactArray<uint16_t>(pData + offset, data, s) + offset;
+			break;
+		}
 		default: {
 			size = s + offset;
+
+			if(isGathered()) {
+				lookupTable->gathered->push_back({pData + offset, data, s});
+				size = offset;
+				break;
+			}
+
 			memcpy(pData + offset, data, s);
+
+			if(lookupTable->serializeOptions.canonical) {
+				canonicalizeNaNs(pData + offset, s, type);
+			}
 		}
 	}
 
 	pData[0] = flags;
 
+	// The size tag holds the full size, which is more than the bytes written if payloads were gathered
 	if(storeSize)
 	{
 		switch(size_bytes_tag)
 		{
 			case 0:
-				put_netsi(pData + 1, size);
+				put_netsi(pData + 1, last_seek);
 				break;
 			case 1:
-				put_netus(pData + 1, size);
+				put_netus(pData + 1, last_seek);
 				break;
 			default:
-				pData[1] = size & 255;
+				pData[1] = last_seek & 255;
 		}
 	}
 
 	return size;
 }
 
+bool BdfObject::isGathered() const noexcept
+{
+	if(lookupTable->gathered == nullptr) {
+		return false;
+	}
+
+	switch(last_seek_type)
+	{
+		case BdfTypes::STRING:
+			return (int)((std::string*)object)->size() >= lookupTable->gatherThreshold;
+		case BdfTypes::UNDEFINED:
+		case BdfTypes::NAMED_LIST:
+		case BdfTypes::LIST:
+		case BdfTypes::LIST_COLUMNAR:
+		case BdfTypes::STRING_REF:
+		case BdfTypes::ARRAY_INTEGER_VARINT:
+		case BdfTypes::ARRAY_LONG_VARINT:
+		case BdfTypes::ARRAY_SHORT_VARINT:
+			return false;
+		case BdfTypes::DOUBLE:
+		case BdfTypes::FLOAT:
+		case BdfTypes::ARRAY_DOUBLE:
+		case BdfTypes::ARRAY_FLOAT:
+			// Canonical data changes the NaNs, so the payload can't be written as it's stored
+			return !lookupTable->serializeOptions.canonical && s >= lookupTable->gatherThreshold;
+		default:
+			return s >= lookupTable->gatherThreshold;
+	}
+}
+
+int BdfObject::getGatheredSize() const noexcept
+{
+	switch(last_seek_type)
+	{
+		case BdfTypes::NAMED_LIST:
+			return ((BdfNamedList*)object)->getGatheredSize();
+		case BdfTypes::LIST:
+		case BdfTypes::LIST_COLUMNAR:
+			return ((BdfList*)object)->getGatheredSize();
+		case BdfTypes::STRING:
+			return isGathered() ? ((std::string*)object)->size() : 0;
+		default:
+			return isGathered() ? s : 0;
+	}
+}
+
 void BdfObject::getLocationUses(int* locations)
 {
 	switch(type)
 	{
+		case BdfTypes::STRING:
+			lookupTable->countString(*(std::string*)object);
+			return;
 		case BdfTypes::NAMED_LIST:
 			((BdfNamedList*)object)->getLocationUses(locations);
 			return;
@@ -1176,7 +1917,7 @@ void BdfObject::serializeHumanReadable(std::ostream &out, const BdfIndent &inden
 
 
 
-int BdfObject::getKeyLocation(std::string key) {
+int BdfObject::getKeyLocation(std::string_view key) {
 	return lookupTable->getLocation(key);
 }
 
@@ -1184,31 +1925,253 @@ std::string BdfObject::getKeyName(int key) {
 	return lookupTable->getName(key);
 }
 
+BdfMemoryUsage BdfObject::memoryUsage() const
+{
+	BdfMemoryUsage usage;
+	usage.nodes = sizeof(BdfObject);
+
+	switch(type)
+	{
+		case BdfTypes::STRING:
+			if(!interned) {
+				usage.strings = BdfMemoryUsage::getStringSize(*(std::string*)object);
+			}
+
+			break;
+		case BdfTypes::LIST:
+			usage += ((BdfList*)object)->memoryUsage();
+			break;
+		case BdfTypes::NAMED_LIST:
+			usage += ((BdfNamedList*)object)->memoryUsage();
+			break;
+		default:
+			if(data != NULL) {
+				usage.payloads = data_capacity;
+			}
+	}
+
+	return usage;
+}
+
+uint64_t BdfObject::hash() const noexcept
+{
+	if(hash_generation == lookupTable->generation) {
+		return hash_value;
+	}
+
+	uint64_t h;
+
+	switch(type)
+	{
+		case BdfTypes::STRING:
+		{
+			const std::string* v = (const std::string*)object;
+			h = (v == NULL) ? hash_bytes(NULL, 0, type) : hash_bytes(v->data(), v->size(), type);
+			break;
+		}
+		case BdfTypes::LIST:
+			h = (object == NULL) ? hash_mix(type) : ((BdfList*)object)->hash();
+			break;
+		case BdfTypes::NAMED_LIST:
+			h = (object == NULL) ? hash_mix(type) : ((BdfNamedList*)object)->hash();
+			break;
+		default:
+			// Primitives and arrays are stored in network order, so their bytes can be hashed directly
+			h = hash_bytes(data, (data == NULL) ? 0 : s, type);
+	}
+
+	hash_value = h;
+	hash_generation = lookupTable->generation;
+
+	return h;
+}
+
+bool BdfObject::operator==(const BdfObject &rhs) const noexcept
+{
+	if(this == &rhs) {
+		return true;
+	}
+
+	if(type != rhs.type) {
+		return false;
+	}
+
+	// Hashes that are already cached tell unequal objects apart without comparing their content
+	if(hash_generation == lookupTable->generation && rhs.hash_generation == rhs.lookupTable->generation &&
+			hash_value != rhs.hash_value) {
+		return false;
+	}
+
+	switch(type)
+	{
+		case BdfTypes::UNDEFINED:
+			return true;
+		case BdfTypes::STRING:
+		{
+			const std::string* lhs_v = (const std::string*)object;
+			const std::string* rhs_v = (const std::string*)rhs.object;
+
+			if(lhs_v == NULL || rhs_v == NULL) {
+				return (lhs_v == NULL ? 0 : lhs_v->size()) == (rhs_v == NULL ? 0 : rhs_v->size());
+			}
+
+			return *lhs_v == *rhs_v;
+		}
+		case BdfTypes::LIST:
+			if(object == NULL || rhs.object == NULL) {
+				return object == rhs.object;
+			}
+
+			return *(BdfList*)object == *(BdfList*)rhs.object;
+		case BdfTypes::NAMED_LIST:
+			if(object == NULL || rhs.object == NULL) {
+				return object == rhs.object;
+			}
+
+			return *(BdfNamedList*)object == *(BdfNamedList*)rhs.object;
+		default:
+		{
+			int lhs_s = (data == NULL) ? 0 : s;
+			int rhs_s = (rhs.data == NULL) ? 0 : rhs.s;
+
+			return lhs_s == rhs_s && (lhs_s == 0 || memcmp(data, rhs.data, lhs_s) == 0);
+		}
+	}
+}
+
+#if __cplusplus >= 202002L
+
+template<typename T> static std::partial_ordering compareDecimals(T lhs, T rhs)
+{
+	// Compare the bits first, so that the ordering agrees with operator==
+	if(memcmp(&lhs, &rhs, sizeof(T)) == 0) {
+		return std::partial_ordering::equivalent;
+	}
+
+	std::partial_ordering result = lhs <=> rhs;
+
+	// -0.0 and 0.0 have different bits, so put -0.0 first
+	if(result == std::partial_ordering::equivalent) {
+		return std::signbit(rhs) <=> std::signbit(lhs);
+	}
+
+	return result;
+}
+
+static std::partial_ordering comparePrimitiveData(char type, const char* lhs, const char* rhs)
+{
+	switch(type)
+	{
+		case BdfTypes::BOOLEAN:
+			return (uint8_t)lhs[0] <=> (uint8_t)rhs[0];
+		case BdfTypes::BYTE:
+			return (int8_t)lhs[0] <=> (int8_t)rhs[0];
+		case BdfTypes::SHORT:
+			return get_netss(lhs) <=> get_netss(rhs);
+		case BdfTypes::INTEGER:
+			return get_netsi(lhs) <=> get_netsi(rhs);
+		case BdfTypes::LONG:
+			return get_netsl(lhs) <=> get_netsl(rhs);
+		case BdfTypes::DOUBLE:
+			return compareDecimals(get_netd(lhs), get_netd(rhs));
+		case BdfTypes::FLOAT:
+			return compareDecimals(get_netf(lhs), get_netf(rhs));
+		default:
+			return std::partial_ordering::unordered;
+	}
+}
+
+std::partial_ordering BdfObject::operator<=>(const BdfObject &rhs) const noexcept
+{
+	if(type != rhs.type) {
+		return type <=> rhs.type;
+	}
+
+	switch(type)
+	{
+		case BdfTypes::UNDEFINED:
+			return std::partial_ordering::equivalent;
+		case BdfTypes::STRING:
+		{
+			std::string empty;
+			const std::string* lhs_v = (object == NULL) ? &empty : (const std::string*)object;
+			const std::string* rhs_v = (rhs.object == NULL) ? &empty : (const std::string*)rhs.object;
+
+			return *lhs_v <=> *rhs_v;
+		}
+		case BdfTypes::LIST:
+			if(object == NULL || rhs.object == NULL) {
+				return (object != NULL) <=> (rhs.object != NULL);
+			}
+
+			return *(BdfList*)object <=> *(BdfList*)rhs.object;
+		case BdfTypes::NAMED_LIST:
+			return (*this == rhs) ? std::partial_ordering::equivalent : std::partial_ordering::unordered;
+	}
+
+	int lhs_s = (data == NULL) ? 0 : s;
+	int rhs_s = (rhs.data == NULL) ? 0 : rhs.s;
+
+	if(type < BdfTypes::ARRAY_BOOLEAN) {
+		if(lhs_s == 0 || rhs_s == 0) {
+			return lhs_s <=> rhs_s;
+		}
+
+		return comparePrimitiveData(type, data, rhs.data);
+	}
+
+	// Compare arrays element by element, then by size
+	char element_type = type - BdfTypes::ARRAY_BOOLEAN + BdfTypes::BOOLEAN;
+	int element_size = getDefaultSize(element_type) - 1;
+	int lhs_size = lhs_s / element_size;
+	int rhs_size = rhs_s / element_size;
+
+	for(int i = 0; i < lhs_size && i < rhs_size; i++)
+	{
+		std::partial_ordering result = comparePrimitiveData(element_type, data + i * element_size, rhs.data + i * element_size);
+
+		if(result != std::partial_ordering::equivalent) {
+			return result;
+		}
+	}
+
+	return lhs_s <=> rhs_s;
+}
+
+#endif
+
+size_t BdfObject::PointerHash::operator()(const BdfObject* object) const noexcept {
+	return object->hash();
+}
+
+bool BdfObject::PointerEqual::operator()(const BdfObject* lhs, const BdfObject* rhs) const noexcept {
+	return *lhs == *rhs;
+}
+
 BdfObject* BdfObject::newObject() {
-	return new BdfObject(lookupTable);
+	return lookupTable->pool.create<BdfObject>(lookupTable);
 }
 
 BdfNamedList* BdfObject::newNamedList() {
-	return new BdfNamedList(lookupTable);
+	return lookupTable->pool.create<BdfNamedList>(lookupTable);
 }
 
 BdfList* BdfObject::newList() {
-	return new BdfList(lookupTable);
+	return lookupTable->pool.create<BdfList>(lookupTable);
 }
 
 BdfObject* BdfObject::setAutoInt(long number)
 {
+	// The setter returns the object changed, which is a copy if this one was shared
 	if(number > 2147483648L || number <= -2147483648L) {
-		setLong(number);
+		return setLong(number);
 	} else if(number > 32768 || number <= -32768) {
-		setInteger((int)number);
+		return setInteger((int)number);
 	} else if(number > 128 || number <= -128) {
-		setShort((short)number);
+		return setShort((short)number);
 	} else {
-		setByte((char)number);
+		return setByte((char)number);
 	}
-	
-	return this;
 }
 
 long BdfObject::getAutoInt()
@@ -1419,37 +2382,52 @@ void BdfObject::getFloatArray(float** v, int* pSize)
 
 std::string BdfObject::getString()
 {
-	std::string* v;
-
+	// Only objects of another type are changed, so getting the value of a copy of the reader is a read
 	if(type == BdfTypes::STRING) {
-		v = (std::string*)object;
+		return *(std::string*)object;
 	}
-	
-	else
-	{
-		freeAll();
-		v = new std::string();
+
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->getString();
 	}
 
+	freeAll();
+
+	std::string* v = lookupTable->pool.create<std::string>();
+
 	type = BdfTypes::STRING;
 	object = v;
 	return *v;
 }
 
-BdfList* BdfObject::getList()
+std::string_view BdfObject::getStringView()
 {
-	BdfList* v;
+	if(type != BdfTypes::STRING) {
+		return setString(std::string())->getStringView();
+	}
+
+	return *(std::string*)object;
+}
 
+BdfList* BdfObject::getList()
+{
 	if(type == BdfTypes::LIST) {
-		v = (BdfList*)object;
+		return (BdfList*)object;
 	}
-	
-	else
-	{
-		freeAll();
-		v = new BdfList(lookupTable);
+
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->getList();
 	}
 
+	freeAll();
+
+	BdfList* v = lookupTable->pool.create<BdfList>(lookupTable);
+	v->owner = this;
+
 	type = BdfTypes::LIST;
 	object = v;
 	return v;
@@ -1457,18 +2435,21 @@ BdfList* BdfObject::getList()
 
 BdfNamedList* BdfObject::getNamedList()
 {
-	BdfNamedList* v;
-
 	if(type == BdfTypes::NAMED_LIST) {
-		v = (BdfNamedList*)object;
+		return (BdfNamedList*)object;
 	}
-	
-	else
-	{
-		freeAll();
-		v = new BdfNamedList(lookupTable);
+
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->getNamedList();
 	}
 
+	freeAll();
+
+	BdfNamedList* v = lookupTable->pool.create<BdfNamedList>(lookupTable);
+	v->owner = this;
+
 	type = BdfTypes::NAMED_LIST;
 	object = v;
 	return v;
@@ -1480,10 +2461,17 @@ BdfNamedList* BdfObject::getNamedList()
 
 BdfObject* BdfObject::setInteger(int32_t v)
 {
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setInteger(v);
+	}
+
 	freeAll();
 
 	s = sizeof(v);
-	data = new char[4];
+	BDF_STATS_ALLOC(lookupTable->stats, 4);
+	data = newData(4);
 	type = BdfTypes::INTEGER;
 	put_netsi(data, v);
 	return this;
@@ -1491,10 +2479,17 @@ BdfObject* BdfObject::setInteger(int32_t v)
 
 BdfObject* BdfObject::setLong(int64_t v)
 {
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setLong(v);
+	}
+
 	freeAll();
 
 	s = sizeof(v);
-	data = new char[8];
+	BDF_STATS_ALLOC(lookupTable->stats, 8);
+	data = newData(8);
 	type = BdfTypes::LONG;
 	put_netsl(data, v);
 	return this;
@@ -1502,10 +2497,17 @@ BdfObject* BdfObject::setLong(int64_t v)
 
 BdfObject* BdfObject::setShort(int16_t v)
 {
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setShort(v);
+	}
+
 	freeAll();
 
 	s = sizeof(v);
-	data = new char[2];
+	BDF_STATS_ALLOC(lookupTable->stats, 2);
+	data = newData(2);
 	type = BdfTypes::SHORT;
 	put_netss(data, v);
 	return this;
@@ -1513,20 +2515,35 @@ BdfObject* BdfObject::setShort(int16_t v)
 
 BdfObject* BdfObject::setBoolean(bool v)
 {
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setBoolean(v);
+	}
+
 	freeAll();
 
 	s = 1;
-	data = new char[1] {(char)(v ? 0x01 : 0x00)};
+	BDF_STATS_ALLOC(lookupTable->stats, 1);
+	data = newData(1);
+	data[0] = (char)(v ? 0x01 : 0x00);
 	type = BdfTypes::BOOLEAN;
 	return this;
 }
 
 BdfObject* BdfObject::setDouble(double v)
 {
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setDouble(v);
+	}
+
 	freeAll();
 
 	s = sizeof(v);
-	data = new char[8];
+	BDF_STATS_ALLOC(lookupTable->stats, 8);
+	data = newData(8);
 	type = BdfTypes::DOUBLE;
 	put_netd(data, v);
 	return this;
@@ -1534,10 +2551,17 @@ BdfObject* BdfObject::setDouble(double v)
 
 BdfObject* BdfObject::setFloat(float v)
 {
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setFloat(v);
+	}
+
 	freeAll();
 
 	s = sizeof(v);
-	data = new char[4];
+	BDF_STATS_ALLOC(lookupTable->stats, 4);
+	data = newData(4);
 	type = BdfTypes::FLOAT;
 	put_netf(data, v);
 	return this;
@@ -1545,11 +2569,19 @@ BdfObject* BdfObject::setFloat(float v)
 
 BdfObject* BdfObject::setByte(char v)
 {
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setByte(v);
+	}
+
 	freeAll();
 
 	s = sizeof(v);
 	type = BdfTypes::BYTE;
-	data = new char[1] {v};
+	BDF_STATS_ALLOC(lookupTable->stats, 1);
+	data = newData(1);
+	data[0] = v;
 	return this;
 }
 
@@ -1557,10 +2589,17 @@ BdfObject* BdfObject::setByte(char v)
 
 BdfObject* BdfObject::setIntegerArray(const int32_t* v, int size)
 {
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setIntegerArray(v, size);
+	}
+
 	freeAll();
 
 	s = 4 * size;
-	data = new char[s];
+	BDF_STATS_ALLOC(lookupTable->stats, s);
+	data = newData(s);
 	type = BdfTypes::ARRAY_INTEGER;
 
 	for(int i=0;i<size;i++) {
@@ -1572,10 +2611,17 @@ BdfObject* BdfObject::setIntegerArray(const int32_t* v, int size)
 
 BdfObject* BdfObject::setBooleanArray(const bool* v, int size)
 {
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setBooleanArray(v, size);
+	}
+
 	freeAll();
 
 	s = size;
-	data = new char[s];
+	BDF_STATS_ALLOC(lookupTable->stats, s);
+	data = newData(s);
 	type = BdfTypes::ARRAY_BOOLEAN;
 
 	for(int i=0;i<s;i++) {
@@ -1587,10 +2633,17 @@ BdfObject* BdfObject::setBooleanArray(const bool* v, int size)
 
 BdfObject* BdfObject::setLongArray(const int64_t* v, int size)
 {
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setLongArray(v, size);
+	}
+
 	freeAll();
 
 	s = 8 * size;
-	data = new char[s];
+	BDF_STATS_ALLOC(lookupTable->stats, s);
+	data = newData(s);
 	type = BdfTypes::ARRAY_LONG;
 
 	for(int i=0;i<size;i++) {
@@ -1602,10 +2655,17 @@ BdfObject* BdfObject::setLongArray(const int64_t* v, int size)
 
 BdfObject* BdfObject::setShortArray(const int16_t* v, int size)
 {
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setShortArray(v, size);
+	}
+
 	freeAll();
 
 	s = 2 * size;
-	data = new char[s];
+	BDF_STATS_ALLOC(lookupTable->stats, s);
+	data = newData(s);
 	type = BdfTypes::ARRAY_SHORT;
 
 	for(int i=0;i<size;i++) {
@@ -1617,12 +2677,19 @@ BdfObject* BdfObject::setShortArray(const int16_t* v, int size)
 
 BdfObject* BdfObject::setByteArray(const char* v, int size)
 {
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setByteArray(v, size);
+	}
+
 	freeAll();
 
 	s = size;
 	type = BdfTypes::ARRAY_BYTE;
 
-	data = new char[s];
+	BDF_STATS_ALLOC(lookupTable->stats, s);
+	data = newData(s);
 	memcpy(data, v, size);
 
 	return this;
@@ -1630,10 +2697,17 @@ BdfObject* BdfObject::setByteArray(const char* v, int size)
 
 BdfObject* BdfObject::setDoubleArray(const double* v, int size)
 {
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setDoubleArray(v, size);
+	}
+
 	freeAll();
 
 	s = 8 * size;
-	data = new char[s];
+	BDF_STATS_ALLOC(lookupTable->stats, s);
+	data = newData(s);
 	type = BdfTypes::ARRAY_DOUBLE;
 
 	for(int i=0;i<size;i++) {
@@ -1645,10 +2719,17 @@ BdfObject* BdfObject::setDoubleArray(const double* v, int size)
 
 BdfObject* BdfObject::setFloatArray(const float* v, int size)
 {
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setFloatArray(v, size);
+	}
+
 	freeAll();
 
 	s = 4 * size;
-	data = new char[s];
+	BDF_STATS_ALLOC(lookupTable->stats, s);
+	data = newData(s);
 	type = BdfTypes::ARRAY_FLOAT;
 
 	for(int i=0;i<size;i++) {
@@ -1658,34 +2739,522 @@ BdfObject* BdfObject::setFloatArray(const float* v, int size)
 	return this;
 }
 
+// Growable arrays
+
+static int getArrayElementSize(char type)
+{
+	switch(type)
+	{
+		case BdfTypes::ARRAY_BOOLEAN:
+		case BdfTypes::ARRAY_BYTE:
+			return 1;
+		case BdfTypes::ARRAY_SHORT:
+			return 2;
+		case BdfTypes::ARRAY_INTEGER:
+		case BdfTypes::ARRAY_FLOAT:
+			return 4;
+		case BdfTypes::ARRAY_LONG:
+		case BdfTypes::ARRAY_DOUBLE:
+			return 8;
+		default:
+			return 0;
+	}
+}
+
+char* BdfObject::appendArray(char arrayType, int elementSize, int count)
+{
+	if(type != arrayType) {
+		freeAll();
+		type = arrayType;
+		s = 0;
+	} else {
+		lookupTable->generation += 1;
+	}
+
+	int size = s + count * elementSize;
+
+	if(size > data_capacity)
+	{
+		char* old_data = data;
+		int old_capacity = data_capacity;
+		int capacity = std::max(size, std::max(old_capacity * 2, 16));
+
+		BDF_STATS_ALLOC(lookupTable->stats, capacity);
+		data = newData(capacity);
+
+		if(old_data != NULL) {
+			memcpy(data, old_data, s);
+			lookupTable->pool.deallocate(old_data, old_capacity);
+		}
+	}
+
+	char* end = data + s;
+	s = size;
+
+	return end;
+}
+
+char* BdfObject::getArrayElement(char arrayType, int elementSize, int index)
+{
+	if(type != arrayType || index < 0 || index >= s / elementSize) {
+		throw std::out_of_range("The requested array element was not found.");
+	}
+
+	return data + index * elementSize;
+}
+
+BdfObject* BdfObject::appendInteger(int32_t v)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->appendInteger(v);
+	}
+
+	put_netsi(appendArray(BdfTypes::ARRAY_INTEGER, 4, 1), v);
+	return this;
+}
+
+BdfObject* BdfObject::appendBoolean(bool v)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->appendBoolean(v);
+	}
+
+	appendArray(BdfTypes::ARRAY_BOOLEAN, 1, 1)[0] = (char)(v ? 0x01 : 0x00);
+	return this;
+}
+
+BdfObject* BdfObject::appendLong(int64_t v)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->appendLong(v);
+	}
+
+	put_netsl(appendArray(BdfTypes::ARRAY_LONG, 8, 1), v);
+	return this;
+}
+
+BdfObject* BdfObject::appendShort(int16_t v)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->appendShort(v);
+	}
+
+	put_netss(appendArray(BdfTypes::ARRAY_SHORT, 2, 1), v);
+	return this;
+}
+
+BdfObject* BdfObject::appendByte(char v)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->appendByte(v);
+	}
+
+	appendArray(BdfTypes::ARRAY_BYTE, 1, 1)[0] = v;
+	return this;
+}
+
+BdfObject* BdfObject::appendDouble(double v)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->appendDouble(v);
+	}
+
+	put_netd(appendArray(BdfTypes::ARRAY_DOUBLE, 8, 1), v);
+	return this;
+}
+
+BdfObject* BdfObject::appendFloat(float v)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->appendFloat(v);
+	}
+
+	put_netf(appendArray(BdfTypes::ARRAY_FLOAT, 4, 1), v);
+	return this;
+}
+
+BdfObject* BdfObject::appendRange(const int32_t* v, int size)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->appendRange(v, size);
+	}
+
+	char* end = appendArray(BdfTypes::ARRAY_INTEGER, 4, size);
+
+	for(int i=0;i<size;i++) {
+		put_netsi(end + i * 4, v[i]);
+	}
+
+	return this;
+}
+
+BdfObject* BdfObject::appendRange(const bool* v, int size)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->appendRange(v, size);
+	}
+
+	char* end = appendArray(BdfTypes::ARRAY_BOOLEAN, 1, size);
+
+	for(int i=0;i<size;i++) {
+		end[i] = (char)(v[i] ? 0x01 : 0x00);
+	}
+
+	return this;
+}
+
+BdfObject* BdfObject::appendRange(const int64_t* v, int size)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->appendRange(v, size);
+	}
+
+	char* end = appendArray(BdfTypes::ARRAY_LONG, 8, size);
+
+	for(int i=0;i<size;i++) {
+		put_netsl(end + i * 8, v[i]);
+	}
+
+	return this;
+}
+
+BdfObject* BdfObject::appendRange(const int16_t* v, int size)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->appendRange(v, size);
+	}
+
+	char* end = appendArray(BdfTypes::ARRAY_SHORT, 2, size);
+
+	for(int i=0;i<size;i++) {
+		put_netss(end + i * 2, v[i]);
+	}
+
+	return this;
+}
+
+BdfObject* BdfObject::appendRange(const char* v, int size)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->appendRange(v, size);
+	}
+
+	char* end = appendArray(BdfTypes::ARRAY_BYTE, 1, size);
+
+	if(size > 0) {
+		memcpy(end, v, size);
+	}
+
+	return this;
+}
+
+BdfObject* BdfObject::appendRange(const double* v, int size)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->appendRange(v, size);
+	}
+
+	char* end = appendArray(BdfTypes::ARRAY_DOUBLE, 8, size);
+
+	for(int i=0;i<size;i++) {
+		put_netd(end + i * 8, v[i]);
+	}
+
+	return this;
+}
+
+BdfObject* BdfObject::appendRange(const float* v, int size)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->appendRange(v, size);
+	}
+
+	char* end = appendArray(BdfTypes::ARRAY_FLOAT, 4, size);
+
+	for(int i=0;i<size;i++) {
+		put_netf(end + i * 4, v[i]);
+	}
+
+	return this;
+}
+
+BdfObject* BdfObject::reserve(int size)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->reserve(size);
+	}
+
+	int elementSize = getArrayElementSize(type);
+
+	if(elementSize == 0 || size * elementSize <= data_capacity) {
+		return this;
+	}
+
+	char* old_data = data;
+	int old_capacity = data_capacity;
+
+	BDF_STATS_ALLOC(lookupTable->stats, size * elementSize);
+	data = newData(size * elementSize);
+
+	if(old_data != NULL) {
+		memcpy(data, old_data, s);
+		lookupTable->pool.deallocate(old_data, old_capacity);
+	}
+
+	return this;
+}
+
+int BdfObject::getArraySize()
+{
+	int elementSize = getArrayElementSize(type);
+
+	if(elementSize == 0) {
+		return 0;
+	}
+
+	return s / elementSize;
+}
+
+BdfObject* BdfObject::setIntegerAt(int index, int32_t v)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setIntegerAt(index, v);
+	}
+
+	put_netsi(getArrayElement(BdfTypes::ARRAY_INTEGER, 4, index), v);
+	lookupTable->generation += 1;
+	return this;
+}
+
+BdfObject* BdfObject::setBooleanAt(int index, bool v)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setBooleanAt(index, v);
+	}
+
+	getArrayElement(BdfTypes::ARRAY_BOOLEAN, 1, index)[0] = (char)(v ? 0x01 : 0x00);
+	lookupTable->generation += 1;
+	return this;
+}
+
+BdfObject* BdfObject::setLongAt(int index, int64_t v)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setLongAt(index, v);
+	}
+
+	put_netsl(getArrayElement(BdfTypes::ARRAY_LONG, 8, index), v);
+	lookupTable->generation += 1;
+	return this;
+}
+
+BdfObject* BdfObject::setShortAt(int index, int16_t v)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setShortAt(index, v);
+	}
+
+	put_netss(getArrayElement(BdfTypes::ARRAY_SHORT, 2, index), v);
+	lookupTable->generation += 1;
+	return this;
+}
+
+BdfObject* BdfObject::setByteAt(int index, char v)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setByteAt(index, v);
+	}
+
+	getArrayElement(BdfTypes::ARRAY_BYTE, 1, index)[0] = v;
+	lookupTable->generation += 1;
+	return this;
+}
+
+BdfObject* BdfObject::setDoubleAt(int index, double v)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setDoubleAt(index, v);
+	}
+
+	put_netd(getArrayElement(BdfTypes::ARRAY_DOUBLE, 8, index), v);
+	lookupTable->generation += 1;
+	return this;
+}
+
+BdfObject* BdfObject::setFloatAt(int index, float v)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setFloatAt(index, v);
+	}
+
+	put_netf(getArrayElement(BdfTypes::ARRAY_FLOAT, 4, index), v);
+	lookupTable->generation += 1;
+	return this;
+}
+
+int32_t BdfObject::getIntegerAt(int index) {
+	return get_netsi(getArrayElement(BdfTypes::ARRAY_INTEGER, 4, index));
+}
+
+bool BdfObject::getBooleanAt(int index) {
+	return getArrayElement(BdfTypes::ARRAY_BOOLEAN, 1, index)[0] == 0x01;
+}
+
+int64_t BdfObject::getLongAt(int index) {
+	return get_netsl(getArrayElement(BdfTypes::ARRAY_LONG, 8, index));
+}
+
+int16_t BdfObject::getShortAt(int index) {
+	return get_netss(getArrayElement(BdfTypes::ARRAY_SHORT, 2, index));
+}
+
+char BdfObject::getByteAt(int index) {
+	return getArrayElement(BdfTypes::ARRAY_BYTE, 1, index)[0];
+}
+
+double BdfObject::getDoubleAt(int index) {
+	return get_netd(getArrayElement(BdfTypes::ARRAY_DOUBLE, 8, index));
+}
+
+float BdfObject::getFloatAt(int index) {
+	return get_netf(getArrayElement(BdfTypes::ARRAY_FLOAT, 4, index));
+}
+
 // Objects
 
-BdfObject* BdfObject::setString(std::string v)
+BdfObject* BdfObject::setString(std::string &&v)
 {
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setString(std::move(v));
+	}
+
+	freeAll();
+
+	type = BdfTypes::STRING;
+	BDF_STATS_ALLOC(lookupTable->stats, sizeof(std::string) + v.size());
+	object = lookupTable->pool.create<std::string>(std::move(v));
+
+	return this;
+}
+
+BdfObject* BdfObject::setString(std::string_view v)
+{
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setString(v);
+	}
+
+	// Interned strings belong to the lookup table, so only a string of the object's own can be assigned to
+	if(type == BdfTypes::STRING && object != NULL && !interned && data == NULL)
+	{
+		std::string* str = (std::string*)object;
+		lookupTable->generation += 1;
+
+		if(v.size() > str->capacity()) {
+			BDF_STATS_ALLOC(lookupTable->stats, v.size());
+		}
+
+		str->assign(v.data(), v.size());
+
+		return this;
+	}
+
 	freeAll();
 
 	type = BdfTypes::STRING;
-	object = new std::string(std::move(v));
+	BDF_STATS_ALLOC(lookupTable->stats, sizeof(std::string) + v.size());
+	object = lookupTable->pool.create<std::string>(v);
 
 	return this;
 }
 
+BdfObject* BdfObject::setString(const char* v) {
+	return setString(std::string_view(v));
+}
+
 BdfObject* BdfObject::setList(BdfList* v)
 {
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setList(v);
+	}
+
 	freeAll();
 
 	type = BdfTypes::LIST;
 	object = v;
 
+	if(v != NULL) {
+		v->owner = this;
+	}
+
 	return this;
 }
 
 BdfObject* BdfObject::setNamedList(BdfNamedList* v)
 {
+	BdfObject* copy = unshare();
+
+	if(copy != this) {
+		return copy->setNamedList(v);
+	}
+
 	freeAll();
 
 	type = BdfTypes::NAMED_LIST;
 	object = v;
 
+	if(v != NULL) {
+		v->owner = this;
+	}
+
 	return this;
 }
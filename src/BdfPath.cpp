@@ -0,0 +1,603 @@
+
+#include "../include/Bdf.hpp"
+#include "../include/BdfHelpers.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include <string.h>
+
+using namespace Bdf;
+using namespace BdfHelpers;
+
+static bool isPathKeyChar(char c) {
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+}
+
+/*
+ * Finds the value at key in the given row of the columnar list at data, which is stored in the key's column:
+ * either an element of a typed array or an object in a list.
+ */
+static BdfPath::View getColumnarValue(const char* data, int size, uint64_t row, int key)
+{
+	BdfPath::View result = {nullptr, 0, BdfTypes::UNDEFINED, -1};
+
+	char size_tag;
+	BdfObject::getFlagData(data, NULL, &size_tag, NULL);
+
+	int offset = 1 + BdfObject::getSizeBytes(size_tag);
+	const char* payload = data + offset;
+	int payload_size = size - offset;
+
+	uint64_t rows, columns;
+	int pos = get_varint(payload, payload_size, &rows);
+
+	if(pos == -1) {
+		return result;
+	}
+
+	int varint_size = get_varint(payload + pos, payload_size - pos, &columns);
+
+	if(varint_size == -1 || row >= rows) {
+		return result;
+	}
+
+	pos += varint_size;
+
+	for(uint64_t c=0;c<columns;c++)
+	{
+		uint64_t column_key;
+		varint_size = get_varint(payload + pos, payload_size - pos, &column_key);
+
+		if(varint_size == -1) {
+			return result;
+		}
+
+		pos += varint_size;
+
+		const char* column = payload + pos;
+		int column_size = BdfObject::getCheckedSize(column, payload_size - pos);
+
+		if(column_size == -1) {
+			return result;
+		}
+
+		pos += column_size;
+
+		if(column_key != (uint64_t)key) {
+			continue;
+		}
+
+		char column_type, column_size_tag;
+		BdfObject::getFlagData(column, &column_type, &column_size_tag, NULL);
+
+		int column_offset = 1 + BdfObject::getSizeBytes(column_size_tag);
+		const char* values = column + column_offset;
+		int values_size = column_size - column_offset;
+
+		// Typed arrays have no flag byte for each value, so the view is of the array
+		if(column_type >= BdfTypes::ARRAY_BOOLEAN && column_type <= BdfTypes::ARRAY_SHORT_VARINT)
+		{
+			char type;
+			uint64_t count;
+
+			switch(column_type)
+			{
+				case BdfTypes::ARRAY_INTEGER_VARINT:
+					type = BdfTypes::INTEGER;
+					break;
+				case BdfTypes::ARRAY_LONG_VARINT:
+					type = BdfTypes::LONG;
+					break;
+				case BdfTypes::ARRAY_SHORT_VARINT:
+					type = BdfTypes::SHORT;
+					break;
+				default:
+					type = column_type - (BdfTypes::ARRAY_BOOLEAN - BdfTypes::BOOLEAN);
+			}
+
+			// Compact arrays start with their number of elements
+			if(column_type >= BdfTypes::ARRAY_INTEGER_VARINT) {
+				if(get_varint(values, values_size, &count) == -1) {
+					return result;
+				}
+			} else {
+				count = values_size / BdfColumns::getElementSize(type);
+			}
+
+			if(count != rows) {
+				return result;
+			}
+
+			result.data = column;
+			result.size = column_size;
+			result.type = type;
+			result.element = row;
+
+			return result;
+		}
+
+		if(column_type != BdfTypes::LIST) {
+			return result;
+		}
+
+		// List of any objects, one for each row
+		int at = 0;
+
+		for(uint64_t upto=0;at<values_size;upto++)
+		{
+			int object_size = BdfObject::getCheckedSize(values + at, values_size - at);
+
+			if(object_size == -1) {
+				return result;
+			}
+
+			if(upto == row)
+			{
+				char type;
+				BdfObject::getFlagData(values + at, &type, NULL, NULL);
+
+				result.data = values + at;
+				result.size = object_size;
+				result.type = type;
+
+				return result;
+			}
+
+			at += object_size;
+		}
+
+		return result;
+	}
+
+	return result;
+}
+
+BdfPath::View::operator bool() const noexcept {
+	return data != nullptr;
+}
+
+BdfPath BdfPath::compile(const std::string &path)
+{
+	BdfPath compiled;
+	size_t i = 0;
+	size_t n = path.size();
+	bool first = true;
+
+	// The leading dot is optional (".a.b" and "a.b" are the same path)
+	if(i < n && path[i] == '.') {
+		i += 1;
+	}
+
+	while(i < n)
+	{
+		Step step;
+		step.index = 0;
+		step.isIndex = false;
+
+		// [index]
+		if(path[i] == '[')
+		{
+			size_t start = i + 1;
+			size_t end = path.find(']', start);
+
+			if(end == std::string::npos || end == start) {
+				throw std::invalid_argument("Unterminated or empty index in path at " + std::to_string(i));
+			}
+
+			for(size_t j=start;j<end;j++) {
+				if(path[j] < '0' || path[j] > '9') {
+					throw std::invalid_argument("Invalid index in path at " + std::to_string(j));
+				}
+			}
+
+			try {
+				step.index = std::stoull(path.substr(start, end - start));
+			} catch(std::out_of_range &e) {
+				throw std::invalid_argument("Index in path is out of range at " + std::to_string(start));
+			}
+
+			step.isIndex = true;
+			compiled.steps.push_back(step);
+
+			i = end + 1;
+			first = false;
+			continue;
+		}
+
+		// Every key after the first one needs a dot before it
+		if(!first)
+		{
+			if(path[i] != '.') {
+				throw std::invalid_argument("Expected '.' or '[' in path at " + std::to_string(i));
+			}
+
+			i += 1;
+		}
+
+		// "quoted key"
+		if(i < n && path[i] == '"')
+		{
+			i += 1;
+
+			for(;;)
+			{
+				if(i >= n) {
+					throw std::invalid_argument("Unterminated quoted key in path");
+				}
+
+				char c = path[i];
+
+				if(c == '\\' && i + 1 < n) {
+					step.key += path[i + 1];
+					i += 2;
+					continue;
+				}
+
+				i += 1;
+
+				if(c == '"') {
+					break;
+				}
+
+				step.key += c;
+			}
+		}
+
+		// key
+		else
+		{
+			size_t start = i;
+
+			while(i < n && isPathKeyChar(path[i])) {
+				i += 1;
+			}
+
+			if(i == start) {
+				throw std::invalid_argument("Expected a key in path at " + std::to_string(i));
+			}
+
+			step.key = path.substr(start, i - start);
+		}
+
+		compiled.steps.push_back(step);
+		first = false;
+	}
+
+	return compiled;
+}
+
+std::shared_ptr<const BdfPath::Resolved> BdfPath::resolve(const BdfLookupTable* lookupTable) const
+{
+	int tableSize = lookupTable->size();
+	std::shared_ptr<const Resolved> last = std::atomic_load(&resolved);
+
+	bool sameTable = (last != nullptr && last->keysId == lookupTable->keysId);
+
+	if(sameTable && tableSize == last->size) {
+		return last;
+	}
+
+	// Keys that were already found keep their location as long as the table has only grown,
+	// so only missing keys need to be looked up again.
+	bool onlyMissing = (sameTable && tableSize > last->size);
+
+	std::shared_ptr<Resolved> next = std::make_shared<Resolved>();
+	next->locations.resize(steps.size(), -1);
+	next->keysId = lookupTable->keysId;
+	next->size = tableSize;
+
+	for(size_t i=0;i<steps.size();i++)
+	{
+		if(steps[i].isIndex) {
+			next->locations[i] = -1;
+		} else if(onlyMissing && last->locations[i] != -1) {
+			next->locations[i] = last->locations[i];
+		} else {
+			next->locations[i] = lookupTable->findLocation(steps[i].key);
+		}
+	}
+
+	std::atomic_store(&resolved, std::shared_ptr<const Resolved>(next));
+
+	return next;
+}
+
+BdfObject* BdfPath::evaluate(BdfReader* reader) const {
+	return evaluate(reader->getObject());
+}
+
+BdfObject* BdfPath::evaluate(BdfObject* root) const
+{
+	if(root == nullptr) {
+		return nullptr;
+	}
+
+	std::shared_ptr<const Resolved> keys = resolve(root->lookupTable);
+	const std::vector<int> &locations = keys->locations;
+
+	BdfObject* cur = root;
+
+	for(size_t i=0;i<steps.size() && cur != nullptr;i++)
+	{
+		const Step& step = steps[i];
+
+		if(step.isIndex)
+		{
+			if(cur->type != BdfTypes::LIST) {
+				return nullptr;
+			}
+
+			BdfList::Item* item = ((BdfList*)cur->object)->startItem;
+
+			for(uint64_t j=0;j<step.index && item != nullptr;j++) {
+				item = item->next;
+			}
+
+			cur = (item == nullptr) ? nullptr : item->object;
+		}
+
+		else
+		{
+			int location = locations[i];
+
+			if(cur->type != BdfTypes::NAMED_LIST || location == -1) {
+				return nullptr;
+			}
+
+			BdfNamedList::Item* item = ((BdfNamedList*)cur->object)->start;
+
+			while(item != nullptr && item->key != location) {
+				item = item->next;
+			}
+
+			cur = (item == nullptr) ? nullptr : item->object;
+		}
+	}
+
+	return cur;
+}
+
+BdfPath::View BdfPath::evaluate(const char* data, int size) const
+{
+	View result = {nullptr, 0, BdfTypes::UNDEFINED, -1};
+
+	if(data == nullptr) {
+		return result;
+	}
+
+	// Find the root object and the lookup table stored after it
+	int root_size = BdfObject::getCheckedSize(data, size);
+
+	if(root_size == -1) {
+		return result;
+	}
+
+	char lookupTable_size_tag;
+	BdfObject::getFlagData(data, NULL, NULL, &lookupTable_size_tag);
+	int lookupTable_size_bytes = BdfObject::getSizeBytes(lookupTable_size_tag);
+
+	if(root_size + lookupTable_size_bytes > size) {
+		return result;
+	}
+
+	const char* lookupTable = data + root_size;
+	int lookupTable_size = 0;
+
+	switch(lookupTable_size_tag)
+	{
+		case 0:
+			lookupTable_size = get_netsi(lookupTable);
+			break;
+		case 1:
+			lookupTable_size = get_netus(lookupTable);
+			break;
+		case 2:
+			lookupTable_size = lookupTable[0] & 255;
+			break;
+	}
+
+	if(lookupTable_size < 0 || lookupTable_size > size - root_size - lookupTable_size_bytes) {
+		return result;
+	}
+
+	lookupTable += lookupTable_size_bytes;
+
+	// Resolve the keys against this buffer's lookup table in a single pass
+	std::vector<int> bufferLocations(steps.size(), -1);
+	int location = 0;
+
+	for(int i=0;i<lookupTable_size;location++)
+	{
+		int key_size = lookupTable[i] & 255;
+
+		i += 1;
+
+		if(i + key_size > lookupTable_size) {
+			break;
+		}
+
+		for(size_t j=0;j<steps.size();j++)
+		{
+			if(!steps[j].isIndex && bufferLocations[j] == -1 && steps[j].key.size() == (size_t)key_size &&
+					memcmp(steps[j].key.data(), lookupTable + i, key_size) == 0)
+			{
+				bufferLocations[j] = location;
+			}
+		}
+
+		i += key_size;
+	}
+
+	// Walk the objects along the path
+	const char* cur = data;
+	int cur_size = root_size;
+
+	for(size_t i=0;i<steps.size();i++)
+	{
+		const Step& step = steps[i];
+
+		char type, size_tag;
+		BdfObject::getFlagData(cur, &type, &size_tag, NULL);
+
+		// A row of a columnar list isn't stored in one piece, so the key after the index
+		// is used to find the row's value in that key's column instead
+		if(step.isIndex && type == BdfTypes::LIST_COLUMNAR)
+		{
+			if(i + 1 == steps.size() || steps[i + 1].isIndex || bufferLocations[i + 1] == -1) {
+				return result;
+			}
+
+			View value = getColumnarValue(cur, cur_size, step.index, bufferLocations[i + 1]);
+
+			// Values stored in typed arrays have nothing inside them for the path to go on to
+			if(!value || (value.element != -1 && i + 2 != steps.size())) {
+				return result;
+			}
+
+			if(value.element != -1) {
+				return value;
+			}
+
+			cur = value.data;
+			cur_size = value.size;
+			i += 1;
+
+			continue;
+		}
+
+		if(type != (step.isIndex ? BdfTypes::LIST : BdfTypes::NAMED_LIST)) {
+			return result;
+		}
+
+		if(!step.isIndex && bufferLocations[i] == -1) {
+			return result;
+		}
+
+		int offset = 1 + BdfObject::getSizeBytes(size_tag);
+		const char* payload = cur + offset;
+		int payload_size = cur_size - offset;
+		const char* found = nullptr;
+		int found_size = 0;
+		uint64_t upto = 0;
+
+		for(int pos=0;pos<payload_size;upto++)
+		{
+			int object_size = BdfObject::getCheckedSize(payload + pos, payload_size - pos);
+
+			if(object_size == -1) {
+				return result;
+			}
+
+			if(step.isIndex)
+			{
+				if(upto == step.index) {
+					found = payload + pos;
+					found_size = object_size;
+					break;
+				}
+
+				pos += object_size;
+				continue;
+			}
+
+			// Named list items are followed by their key
+			char key_size_tag;
+			BdfObject::getFlagData(payload + pos, NULL, NULL, &key_size_tag);
+			int key_size = BdfObject::getSizeBytes(key_size_tag);
+
+			if(pos + object_size + key_size > payload_size) {
+				return result;
+			}
+
+			const char* key_data = payload + pos + object_size;
+			int key = 0;
+
+			switch(key_size_tag)
+			{
+				case 2:
+					key = key_data[0] & 255;
+					break;
+				case 1:
+					key = get_netus(key_data);
+					break;
+				case 0:
+					key = get_netsi(key_data);
+					break;
+			}
+
+			if(key == bufferLocations[i]) {
+				found = payload + pos;
+				found_size = object_size;
+				break;
+			}
+
+			pos += object_size + key_size;
+		}
+
+		if(found == nullptr) {
+			return result;
+		}
+
+		cur = found;
+		cur_size = found_size;
+	}
+
+	char type;
+	BdfObject::getFlagData(cur, &type, NULL, NULL);
+
+	result.data = cur;
+	result.size = cur_size;
+	result.type = type;
+
+	return result;
+}
+
+size_t BdfPath::size() const noexcept {
+	return steps.size();
+}
+
+std::string BdfPath::toString() const
+{
+	std::string path;
+
+	for(const Step& step : steps)
+	{
+		if(step.isIndex) {
+			path += "[" + std::to_string(step.index) + "]";
+			continue;
+		}
+
+		bool quote = step.key.empty();
+
+		for(char c : step.key) {
+			if(!isPathKeyChar(c)) {
+				quote = true;
+				break;
+			}
+		}
+
+		path += ".";
+
+		if(!quote) {
+			path += step.key;
+			continue;
+		}
+
+		path += "\"";
+
+		for(char c : step.key)
+		{
+			if(c == '"' || c == '\\') {
+				path += "\\";
+			}
+
+			path += c;
+		}
+
+		path += "\"";
+	}
+
+	return path;
+}
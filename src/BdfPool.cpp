@@ -0,0 +1,78 @@
+
+#include "../include/Bdf.hpp"
+#include <algorithm>
+#include <new>
+
+using namespace Bdf;
+
+// Blocks hold the free list link while they are in the pool, so they can't be any smaller
+static size_t getBlockSize(size_t size) {
+	return std::max(size, sizeof(void*));
+}
+
+BdfPool::BdfPool() noexcept
+{
+	for(size_t i=0;i<=MAX_SIZE;i++) {
+		blocks[i] = nullptr;
+	}
+
+	bytes = 0;
+}
+
+BdfPool::~BdfPool() {
+	clear();
+}
+
+void* BdfPool::allocate(size_t size)
+{
+	if(size <= MAX_SIZE && blocks[size] != nullptr)
+	{
+		Block* block = blocks[size];
+		blocks[size] = block->next;
+		bytes -= getBlockSize(size);
+
+		return block;
+	}
+
+	return ::operator new(getBlockSize(size));
+}
+
+void BdfPool::deallocate(void* block, size_t size) noexcept
+{
+	if(block == nullptr) {
+		return;
+	}
+
+	if(size > MAX_SIZE) {
+		::operator delete(block);
+		return;
+	}
+
+	Block* cur = new(block) Block;
+	cur->next = blocks[size];
+	blocks[size] = cur;
+	bytes += getBlockSize(size);
+}
+
+void BdfPool::clear() noexcept
+{
+	for(size_t i=0;i<=MAX_SIZE;i++)
+	{
+		Block* cur = blocks[i];
+
+		while(cur != nullptr)
+		{
+			Block* next = cur->next;
+			::operator delete(cur);
+			cur = next;
+		}
+
+		blocks[i] = nullptr;
+	}
+
+	bytes = 0;
+}
+
+size_t BdfPool::size() const noexcept {
+	return bytes;
+}
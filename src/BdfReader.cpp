@@ -6,121 +6,336 @@
 #include <sstream>
 #include <codecvt>
 #include <locale>
+#include <algorithm>
+#include <climits>
 
 using namespace Bdf;
 using namespace BdfHelpers;
 
 void BdfReader::initEmpty()
 {
+	content_hash_generation = 0;
+	seek_generation = 0;
+
+	spare = nullptr;
 	lookupTable = new BdfLookupTable(this);
-	bdf = new BdfObject(lookupTable);
+	bdf = lookupTable->pool.create<BdfObject>(lookupTable);
 }
 
 BdfReader::BdfReader() {
 	initEmpty();
 }
 
-BdfReader::BdfReader(const char* data, int size) {
+BdfReader::BdfReader(const char* data, int size)
+{
+	bdf = nullptr;
+	lookupTable = nullptr;
+	spare = nullptr;
+	content_hash_generation = 0;
+	seek_generation = 0;
+
+	initFromData(data, size);
+}
+
+void BdfReader::load(const char* data, int size) {
+	initFromData(data, size);
+}
+
+void BdfReader::trim() noexcept
+{
+	// The pool of a shared lookup table is only used by the reader changing the document
+	if(lookupTable->writer == this) {
+		lookupTable->trim();
+	}
+
+	BdfLookupTable::release(spare, this);
+	spare = nullptr;
+
+	buffer = std::vector<char>();
+	serialize_locations = std::vector<int>();
+}
+
+int BdfReader::compactKeys() {
+	return lookupTable->compact();
+}
+
+void BdfReader::initFromData(const char* data, int size)
+{
+	BDF_STATS_TIMER(timer);
+
+	BdfLookupTable* lookupTable_new;
+	int bdf_size = initLookupTable(data, size, &lookupTable_new);
+	BdfObject* bdf_new;
+
+	// Load the objects from the buffer. The old document is still in use until this succeeds.
 	try {
-		if(size == 0) {
-			throw BdfError(BdfError::ErrorType::BINARY_SIZE_TAG_MISMATCH);
-		}
+		bdf_new = lookupTable_new->pool.create<BdfObject>(lookupTable_new, data, bdf_size);
+	} catch(...) {
+		spare = lookupTable_new;
+		throw;
+	}
+
+	replaceDocument(bdf_new, lookupTable_new);
+
+	BDF_STATS_ADD(&stats, bytesParsed, size);
+	BDF_STATS_LAP(&stats, parseTime, timer);
+}
 
-		// Get the size of the bdf size tag and the lookup table size tag
-		char lookupTable_size_tag;
-		char lookupTable_size_bytes = 0;
-		char bdf_size_tag;
-		char bdf_size_bytes = 0;
+int BdfReader::initLookupTable(const char* data, int size, BdfLookupTable** pLookupTable)
+{
+	if(size == 0) {
+		throw BdfError(BdfError::ErrorType::BINARY_SIZE_TAG_MISMATCH);
+	}
 
-		BdfObject::getFlagData(data, NULL, &bdf_size_tag, &lookupTable_size_tag);
-		lookupTable_size_bytes = BdfObject::getSizeBytes(lookupTable_size_tag);
-		bdf_size_bytes = BdfObject::getSizeBytes(bdf_size_tag);	
+	// Get the size of the lookup table size tag
+	char lookupTable_size_tag;
+	char lookupTable_size_bytes = 0;
+
+	BdfObject::getFlagData(data, NULL, NULL, &lookupTable_size_tag);
+	lookupTable_size_bytes = BdfObject::getSizeBytes(lookupTable_size_tag);
 	
-		// Check if there is enough space
-		if(1 + lookupTable_size_bytes + bdf_size_bytes > size) {
-			throw BdfError(BdfError::ErrorType::BINARY_SIZE_TAG_MISMATCH);
-		}
+	// Get the size of the root object. Primitives have no size tag, so only
+	// objects that store one need their size tag to fit.
+	int bdf_size = BdfObject::getCheckedSize(data, size);
 	
-		// Get the rest of the data
-		int bdf_size = BdfObject::getSize(data);
+	// Check if there is enough space in the buffer
+	if(bdf_size == -1 || bdf_size + lookupTable_size_bytes > size) {
+		throw BdfError(BdfError::ErrorType::BINARY_SIZE_TAG_MISMATCH);
+	}
 	
-		// Check if there is enough space in the buffer
-		if(bdf_size <= 0 || bdf_size + lookupTable_size_bytes > size) {
-			throw BdfError(BdfError::ErrorType::BINARY_SIZE_TAG_MISMATCH);
-		}
+	data += bdf_size;
+
+	// Get the size of the lookup table
+	int lookupTable_size = 0;
+
+	switch(lookupTable_size_tag) {
+		case 0:
+			lookupTable_size = get_netsi(data);
+			break;
+		case 1:
+			lookupTable_size = get_netus(data);
+			break;
+		case 2:
+			lookupTable_size = data[0] & 255;
+			break;
+	}
 	
-		const char* data_bdf = data;
-		data += bdf_size;
-
-		// Get the size of the lookup table
-		int lookupTable_size = 0;
-
-		switch(lookupTable_size_tag) {
-			case 0:
-				lookupTable_size = get_netsi(data);
-				break;
-			case 1:
-				lookupTable_size = get_netus(data);
-				break;
-			case 2:
-				lookupTable_size = data[0] & 255;
-				break;
-		}
+	// Check if there is enough space in the buffer. 4 byte size tags are signed, so they can be negative.
+	if(lookupTable_size < 0 || lookupTable_size > size - bdf_size - lookupTable_size_bytes) {
+		throw BdfError(BdfError::ErrorType::BINARY_SIZE_TAG_MISMATCH);
+	}
 	
-		// Check if there is enough space in the buffer
-		if(bdf_size + lookupTable_size_bytes + lookupTable_size > size) {
-			throw BdfError(BdfError::ErrorType::BINARY_SIZE_TAG_MISMATCH);
+	// Load the lookup table from the buffer into the one kept from the load before last, which nothing else
+	// uses, so it's cleared and reused along with its pool. The one in use is kept until parsing succeeds.
+	BdfLookupTable* lookupTable_new = spare;
+
+	if(lookupTable_new != nullptr) {
+		lookupTable_new->load(data + lookupTable_size_bytes, lookupTable_size);
+	} else {
+		lookupTable_new = spare = new BdfLookupTable(this, data + lookupTable_size_bytes, lookupTable_size);
+	}
+
+	// Anything after the lookup table is the string table
+	int strings_start = bdf_size + lookupTable_size_bytes + lookupTable_size;
+
+	if(strings_start < size) {
+		lookupTable_new->readStrings(data + lookupTable_size_bytes + lookupTable_size, size - strings_start);
+	}
+
+	spare = nullptr;
+	*pLookupTable = lookupTable_new;
+
+	return bdf_size;
+}
+
+void BdfReader::replaceDocument(BdfObject* pBdf, BdfLookupTable* pLookupTable) noexcept
+{
+	// Objects use their lookup table until they are deleted, so delete the old
+	// document before its lookup table is kept, or along with releasing it
+	if(lookupTable == pLookupTable)
+	{
+		BdfObject::release(bdf, this);
+	}
+
+	else
+	{
+		BdfLookupTable::release(spare, this);
+		spare = nullptr;
+
+		if(lookupTable != nullptr && !lookupTable->isShared()) {
+			BdfObject::release(bdf, this);
+			spare = lookupTable;
+		} else {
+			BdfLookupTable::release(lookupTable, this, bdf);
 		}
-	
-		// Load the lookup table and the objects from the buffer
-		lookupTable = new BdfLookupTable(this, data + lookupTable_size_bytes, lookupTable_size);
-		bdf = new BdfObject(lookupTable, data_bdf, bdf_size);
-		
-		return; // To avoid the finally block ruining everything
-	} finally {
-		this->initEmpty();
+
+		lookupTable = pLookupTable;
 	}
+
+	bdf = pBdf;
+
+	content_hash_generation = 0;
+	seek_generation = 0;
+}
+
+BdfReader::BdfReader(const BdfReader &reader)
+{
+	// Share the whole document. Objects are copied one at a time as they are changed by the
+	// reader that was copied, so the copy keeps the document as it is now.
+	lookupTable = reader.lookupTable;
+	lookupTable->share(this);
+	spare = nullptr;
+
+	bdf = reader.bdf->share();
+
+	content_hash = reader.content_hash;
+	content_hash_generation = reader.content_hash_generation;
+	seek_generation = 0;
 }
 
 BdfReader::~BdfReader() {
-	delete lookupTable;
-	delete bdf;
+	BdfLookupTable::release(lookupTable, this, bdf);
+	BdfLookupTable::release(spare, this);
+}
+
+void BdfReader::serialize(char** pData, int* pSize) {
+	serialize(pData, pSize, BdfSerializeOptions());
+}
+
+void BdfReader::serialize(char** pData, int* pSize, const BdfSerializeOptions &options)
+{
+	int data_size = serializeSeek(options);
+	char* data = new char[data_size];
+	BDF_STATS_ALLOC(&stats, data_size);
+
+	serializeWrite(data);
+
+	*pData = data;
+	*pSize = data_size;
+}
+
+void BdfReader::serializeBuffered(const char** pData, int* pSize, const BdfSerializeOptions &options)
+{
+	int data_size = serializeSeek(options);
+
+	if(buffer.size() < (size_t)data_size) {
+		BDF_STATS_ALLOC(&stats, data_size);
+		buffer.resize(data_size);
+	}
+
+	serializeWrite(buffer.data());
+
+	*pData = buffer.data();
+	*pSize = data_size;
+}
+
+size_t BdfReader::serializedSize(const BdfSerializeOptions &options) {
+	return serializeSeek(options);
+}
+
+size_t BdfReader::serializeInto(char* data, size_t capacity, const BdfSerializeOptions &options)
+{
+	size_t data_size = serializeSeek(options);
+
+	if(data_size <= capacity) {
+		serializeWrite(data);
+	}
+
+	return data_size;
+}
+
+static bool isSameOptions(const BdfSerializeOptions &a, const BdfSerializeOptions &b)
+{
+	return a.arrayEncoding == b.arrayEncoding && a.listEncoding == b.listEncoding &&
+		a.stringTable == b.stringTable && a.canonical == b.canonical;
 }
 
-void BdfReader::serialize(char** pData, int* pSize)
+int BdfReader::serializeSeek(const BdfSerializeOptions &pOptions)
 {
+	BdfSerializeOptions options = pOptions;
+
+	// Canonical data always uses the classic encodings, which only depend on the content
+	if(options.canonical)
+	{
+		options.arrayEncoding = BdfSerializeOptions::ArrayEncoding::FIXED;
+		options.listEncoding = BdfSerializeOptions::ListEncoding::ROWS;
+		options.stringTable = false;
+	}
+
+	// The sizes found by the last pass are still in the objects if nothing has changed or been measured since
+	if(seek_generation == lookupTable->generation && seek_pass == lookupTable->seekGeneration && isSameOptions(options, lookupTable->serializeOptions)) {
+		return seek_bdf_size + seek_lookupTable_size + seek_lookupTable_size_bytes + seek_strings_size;
+	}
+
+	if(options.compactKeys && lookupTable->isCompactDue()) {
+		lookupTable->compact();
+	}
+
+	lookupTable->serializeOptions = options;
+	lookupTable->seekGeneration += 1;
+
+	BDF_STATS_TIMER(timer);
+
 	int locations_size = lookupTable->size();
-	int* locations = new int[locations_size];
 
-	lookupTable->serializeGetLocations(locations);
+	if(serialize_locations.capacity() < (size_t)locations_size) {
+		BDF_STATS_ALLOC(&stats, sizeof(int) * locations_size);
+	}
+
+	serialize_locations.resize(locations_size);
+	int* locations = serialize_locations.data();
+
+	lookupTable->serializeGetLocations(locations, bdf);
 
-	int bdf_size = bdf->serializeSeeker(locations);
-	int lookupTable_size = lookupTable->serializeSeeker(locations, locations_size);
+	BDF_STATS_LAP(&stats, getLocationsTime, timer);
 
-	int lookupTable_size_bytes = 0;
-	char lookupTable_size_tag = 0;
+	seek_bdf_size = bdf->serializeSeeker(locations);
+	seek_lookupTable_size = lookupTable->serializeSeeker(locations, locations_size);
 
-	if(lookupTable_size > 65535) {
-		lookupTable_size_tag = 0;
-		lookupTable_size_bytes = 4;
-	} else if(lookupTable_size > 255) {
-		lookupTable_size_tag = 1;
-		lookupTable_size_bytes = 2;
+	BDF_STATS_LAP(&stats, serializeSeekerTime, timer);
+
+	if(seek_lookupTable_size > 65535) {
+		seek_lookupTable_size_bytes = 4;
+	} else if(seek_lookupTable_size > 255) {
+		seek_lookupTable_size_bytes = 2;
 	} else {
-		lookupTable_size_tag = 2;
-		lookupTable_size_bytes = 1;
+		seek_lookupTable_size_bytes = 1;
 	}
 
-	int data_size = bdf_size + lookupTable_size + lookupTable_size_bytes;
-	char* data = new char[data_size];
+	seek_strings_size = lookupTable->serializeStringsSeeker();
+	seek_generation = lookupTable->generation;
+	seek_pass = lookupTable->seekGeneration;
 
-	*pData = data;
-	*pSize = data_size;
-	
-	bdf->serialize(data, locations, lookupTable_size_tag);
-	data += bdf_size;
+	return seek_bdf_size + seek_lookupTable_size + seek_lookupTable_size_bytes + seek_strings_size;
+}
+
+int BdfReader::serializeWrite(char* data)
+{
+	BDF_STATS_TIMER(timer);
+
+	int* locations = serialize_locations.data();
+	int lookupTable_size = seek_lookupTable_size;
+	char lookupTable_size_tag;
+
+	switch(seek_lookupTable_size_bytes)
+	{
+		case 4:
+			lookupTable_size_tag = 0;
+			break;
+		case 2:
+			lookupTable_size_tag = 1;
+			break;
+		default:
+			lookupTable_size_tag = 2;
+	}
+
+	BDF_STATS_ADD(&stats, bytesSerialized, seek_bdf_size + seek_lookupTable_size + seek_lookupTable_size_bytes + seek_strings_size);
+
+	char* start = data;
+
+	data += bdf->serialize(data, locations, lookupTable_size_tag);
 
-	switch(lookupTable_size_bytes)
+	switch(seek_lookupTable_size_bytes)
 	{
 		case 4:
 			put_netsi(data, lookupTable_size);
@@ -132,19 +347,160 @@ void BdfReader::serialize(char** pData, int* pSize)
 			data[0] = lookupTable_size & 255;
 	}
 
-	lookupTable->serialize(data + lookupTable_size_bytes, locations, locations_size);
+	lookupTable->serialize(data + seek_lookupTable_size_bytes, locations, serialize_locations.size());
+	lookupTable->serializeStrings(data + seek_lookupTable_size_bytes + lookupTable_size);
+
+	// Writing frees the columns and forgets the strings counted, so the next serialisation needs a new pass
+	seek_generation = 0;
+
+	BDF_STATS_LAP(&stats, serializeTime, timer);
+
+	return data - start + seek_lookupTable_size_bytes + lookupTable_size + seek_strings_size;
+}
+
+#ifdef BDF_HAS_IOVEC
+
+void BdfReader::serializeVectored(std::vector<iovec>* segments, const BdfSerializeOptions &options, size_t threshold)
+{
+	serializeSeek(options);
+
+	gathered.clear();
+	lookupTable->gathered = &gathered;
+	lookupTable->gatherThreshold = (int)std::min<size_t>(threshold, INT_MAX);
+
+	int written;
+
+	try
+	{
+		int scratch_size = seek_bdf_size + seek_lookupTable_size + seek_lookupTable_size_bytes + seek_strings_size - bdf->getGatheredSize();
+
+		if(buffer.size() < (size_t)scratch_size) {
+			BDF_STATS_ALLOC(&stats, scratch_size);
+			buffer.resize(scratch_size);
+		}
+
+		written = serializeWrite(buffer.data());
+	}
+
+	catch(...)
+	{
+		lookupTable->gathered = nullptr;
+		throw;
+	}
+
+	lookupTable->gathered = nullptr;
+
+	// Interleave the scratch data with the payloads left out of it, in the order they were left out
+	const char* scratch = buffer.data();
+	int pos = 0;
+
+	segments->clear();
+
+	for(const BdfLookupTable::Gathered &payload : gathered)
+	{
+		int at = payload.at - scratch;
+
+		if(at > pos) {
+			segments->push_back({(void*)(scratch + pos), (size_t)(at - pos)});
+		}
+
+		if(payload.size > 0) {
+			segments->push_back({(void*)payload.data, (size_t)payload.size});
+		}
+
+		pos = at;
+	}
+
+	if(written > pos) {
+		segments->push_back({(void*)(scratch + pos), (size_t)(written - pos)});
+	}
+}
+
+#endif
+
+void BdfReader::serializeCompressed(std::ostream &stream, BdfCompression::Codec codec, int level)
+{
+	BdfCompression::Compressor compressor(stream, codec, level);
+
+	#ifdef BDF_HAS_IOVEC
+
+	std::vector<iovec> segments;
+	serializeVectored(&segments);
+
+	for(const iovec &segment : segments) {
+		compressor.write((const char*)segment.iov_base, segment.iov_len);
+	}
+
+	#else
+
+	const char* data;
+	int data_size;
+	serializeBuffered(&data, &data_size);
+	compressor.write(data, data_size);
+
+	#endif
+
+	compressor.finish();
+}
+
+uint64_t BdfReader::contentHash()
+{
+	if(content_hash_generation == lookupTable->generation) {
+		return content_hash;
+	}
+
+	char* data;
+	int size;
 
-	delete[] locations;
+	serialize(&data, &size, BdfSerializeOptions(BdfSerializeOptions::ArrayEncoding::FIXED, BdfSerializeOptions::ListEncoding::ROWS, false, true));
+
+	content_hash = contentHash(data, size);
+	content_hash_generation = lookupTable->generation;
+
+	delete[] data;
+
+	return content_hash;
+}
+
+uint64_t BdfReader::contentHash(const char* data, int size) noexcept {
+	return hash_bytes(data, size, 0);
 }
 
 BdfObject* BdfReader::getObject() {
 	return bdf;
 }
 
+BdfStats BdfReader::getStats() const
+{
+	BdfStats copy = stats;
+	copy.keys = lookupTable->size();
+
+	return copy;
+}
+
+void BdfReader::resetStats() noexcept {
+	stats.reset();
+}
+
+BdfMemoryUsage BdfReader::memoryUsage() const
+{
+	BdfMemoryUsage usage = lookupTable->memoryUsage();
+	usage.nodes += sizeof(*this);
+	usage += bdf->memoryUsage();
+
+	if(spare != nullptr) {
+		usage += spare->memoryUsage();
+	}
+
+	return usage;
+}
+
 BdfObject* BdfReader::resetObject()
 {
-	delete bdf;
-	bdf = new BdfObject(lookupTable);
+	BdfObject::release(bdf, this);
+	bdf = lookupTable->pool.create<BdfObject>(lookupTable);
+	content_hash_generation = 0;
+	seek_generation = 0;
 	return bdf;
 }
 
@@ -154,7 +510,10 @@ std::string BdfReader::serializeHumanReadable(const BdfIndent &indent)
 
 	bdf->serializeHumanReadable(stream, indent, 0);
 
-	return stream.str();
+	std::string data = stream.str();
+	BDF_STATS_ADD(&stats, bytesSerialized, data.size());
+
+	return data;
 }
 
 std::string BdfReader::serializeHumanReadable() {
@@ -0,0 +1,28 @@
+
+#include "../include/Bdf.hpp"
+#include "../include/BdfHelpers.hpp"
+#include <string>
+
+using namespace Bdf;
+using namespace BdfHelpers;
+
+BdfReaderColumn::BdfReaderColumn(const char* data, int size, const BdfPath &path, const std::string &key)
+{
+	BdfLookupTable* lookupTable_new;
+	BdfObject* bdf_new = nullptr;
+
+	initLookupTable(data, size, &lookupTable_new);
+
+	BdfPath::View list = path.evaluate(data, size);
+	int location = lookupTable_new->findLocation(key);
+
+	if(list && list.element == -1 && location != -1) {
+		bdf_new = BdfColumns::readColumn(lookupTable_new, list.data, list.size, location);
+	}
+
+	if(bdf_new == nullptr) {
+		bdf_new = lookupTable_new->pool.create<BdfObject>(lookupTable_new);
+	}
+
+	replaceDocument(bdf_new, lookupTable_new);
+}
@@ -0,0 +1,161 @@
+
+#include "../include/Bdf.hpp"
+#include "../include/BdfHelpers.hpp"
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace Bdf;
+using namespace BdfHelpers;
+
+BdfReaderCompressed::BdfReaderCompressed(std::istream &stream, BdfCompression::Codec codec) {
+	readCompressed(stream, codec);
+}
+
+BdfReaderCompressed::BdfReaderCompressed(const std::filesystem::path &filename, BdfCompression::Codec codec)
+{
+	std::ifstream stream(filename, std::ios::in | std::ios::binary);
+
+	if(!stream.is_open()) {
+		throw std::runtime_error("Could not open " + filename.string() + " for reading.");
+	}
+
+	readCompressed(stream, codec);
+}
+
+void BdfReaderCompressed::readCompressed(std::istream &stream, BdfCompression::Codec codec)
+{
+	BdfCompression::Decompressor decompressor(stream, codec);
+
+	// The flag byte and size tag of the root object are enough to find the size of the
+	// document up to the lookup table, so the buffer only needs to grow once more for the table.
+	char header[5];
+	size_t header_size = decompressor.read(header, sizeof(header));
+
+	if(header_size == 0) {
+		throw BdfError(BdfError::ErrorType::BINARY_SIZE_TAG_MISMATCH);
+	}
+
+	char type, size_tag, lookupTable_size_tag;
+	BdfObject::getFlagData(header, &type, &size_tag, &lookupTable_size_tag);
+	int lookupTable_size_bytes = BdfObject::getSizeBytes(lookupTable_size_tag);
+
+	if(type > BdfTypes::FLOAT && (size_t)(1 + BdfObject::getSizeBytes(size_tag)) > header_size) {
+		throw BdfError(BdfError::ErrorType::BINARY_SIZE_TAG_MISMATCH);
+	}
+
+	int bdf_size = BdfObject::getSize(header);
+
+	if(bdf_size <= 0) {
+		throw BdfError(BdfError::ErrorType::BINARY_SIZE_TAG_MISMATCH);
+	}
+
+	size_t size = bdf_size + lookupTable_size_bytes;
+	size_t upto = header_size;
+	char* data = (char*)malloc(std::max(size, header_size));
+
+	if(data == nullptr) {
+		throw std::bad_alloc();
+	}
+
+	memcpy(data, header, header_size);
+
+	try
+	{
+		if(upto < size) {
+			upto += decompressor.read(data + upto, size - upto);
+		}
+
+		if(upto < size) {
+			throw BdfError(BdfError::ErrorType::BINARY_SIZE_TAG_MISMATCH);
+		}
+
+		// Get the size of the lookup table
+		const char* lookupTable_data = data + bdf_size;
+		int lookupTable_size = 0;
+
+		switch(lookupTable_size_tag)
+		{
+			case 0:
+				lookupTable_size = get_netsi(lookupTable_data);
+				break;
+			case 1:
+				lookupTable_size = get_netus(lookupTable_data);
+				break;
+			case 2:
+				lookupTable_size = lookupTable_data[0] & 255;
+				break;
+		}
+
+		if(lookupTable_size < 0) {
+			throw BdfError(BdfError::ErrorType::BINARY_SIZE_TAG_MISMATCH);
+		}
+
+		size += lookupTable_size;
+
+		if(upto < size)
+		{
+			char* data_new = (char*)realloc(data, size);
+
+			if(data_new == nullptr) {
+				throw std::bad_alloc();
+			}
+
+			data = data_new;
+			upto += decompressor.read(data + upto, size - upto);
+		}
+
+		if(upto < size) {
+			throw BdfError(BdfError::ErrorType::BINARY_SIZE_TAG_MISMATCH);
+		}
+
+		// The string table after the lookup table has no size tag, so read until the end of the data
+		size_t chunk;
+
+		do
+		{
+			char* data_new = (char*)realloc(data, size + 65536);
+
+			if(data_new == nullptr) {
+				throw std::bad_alloc();
+			}
+
+			data = data_new;
+			chunk = decompressor.read(data + size, 65536);
+			size += chunk;
+		}
+
+		while(chunk == 65536);
+
+		initFromData(data, size);
+	}
+
+	catch(...)
+	{
+		free(data);
+		throw;
+	}
+
+	free(data);
+}
+
+BdfReaderGz::BdfReaderGz(std::istream &stream) : BdfReaderCompressed(stream, BdfCompression::Codec::GZIP) {
+}
+
+BdfReaderGz::BdfReaderGz(const std::filesystem::path &filename) : BdfReaderCompressed(filename, BdfCompression::Codec::GZIP) {
+}
+
+BdfReaderXz::BdfReaderXz(std::istream &stream) : BdfReaderCompressed(stream, BdfCompression::Codec::XZ) {
+}
+
+BdfReaderXz::BdfReaderXz(const std::filesystem::path &filename) : BdfReaderCompressed(filename, BdfCompression::Codec::XZ) {
+}
+
+BdfReaderZstd::BdfReaderZstd(std::istream &stream) : BdfReaderCompressed(stream, BdfCompression::Codec::ZSTD) {
+}
+
+BdfReaderZstd::BdfReaderZstd(const std::filesystem::path &filename) : BdfReaderCompressed(filename, BdfCompression::Codec::ZSTD) {
+}
@@ -13,6 +13,8 @@ using namespace BdfHelpers;
 BdfReaderHuman::BdfReaderHuman(const std::wstring &data)
 {
 	// Make a BdfStringReader from the given data.
+	BDF_STATS_TIMER(timer);
+
 	BdfStringReader sr(data.c_str(), data.size());
 	BdfObject* bdfNew = nullptr;
 	// Skip ahead to the first non-comment character.
@@ -20,7 +22,7 @@ BdfReaderHuman::BdfReaderHuman(const std::wstring &data)
 		while(!sr.ignoreBlanks()) {
 			// If this is our first time in the loop, bdfNew will be null. Create it using a new BdfObject.
 			if (!bdfNew) {
-				bdfNew = new BdfObject(lookupTable, &sr);
+				bdfNew = lookupTable->pool.create<BdfObject>(lookupTable, &sr);
 			// Otherwise that means we already attempted to create the file yet haven't hit end of file yet, which
 			// probably means something has gone wrong. Throw a BdfError and delete the attempted object.
 			} else {
@@ -29,14 +31,24 @@ BdfReaderHuman::BdfReaderHuman(const std::wstring &data)
 		}
 	// In case we run into an exception, make sure bdfNew is deallocated.
 	} catch (...) {
-		delete bdfNew;
+		BdfObject::release(bdfNew);
 		throw;
 	}
 
-	// Make our BdfObject the new one.
-	this->bdf = bdfNew;
+	// Make our BdfObject the new one, replacing the empty one made by BdfReader(). Data with nothing but
+	// blanks and comments keeps the empty one.
+	if(bdfNew != nullptr) {
+		BdfObject::release(this->bdf, this);
+		this->bdf = bdfNew;
+	}
+
+	BDF_STATS_ADD(&stats, bytesParsed, data.size());
+	BDF_STATS_LAP(&stats, parseTime, timer);
+}
+
+BdfReaderHuman::BdfReaderHuman(const std::string &data) : BdfReaderHuman(data.data(), data.size()) {
 }
 
-BdfReaderHuman::BdfReaderHuman(const std::string &data) : BdfReaderHuman(
-	std::wstring_convert<std::codecvt_utf8<wchar_t>, wchar_t>().from_bytes(data)) {
+BdfReaderHuman::BdfReaderHuman(const char* data, size_t size) : BdfReaderHuman(
+	std::wstring_convert<std::codecvt_utf8<wchar_t>, wchar_t>().from_bytes(data, data + size)) {
 }
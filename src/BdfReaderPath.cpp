@@ -0,0 +1,32 @@
+
+#include "../include/Bdf.hpp"
+#include "../include/BdfHelpers.hpp"
+
+using namespace Bdf;
+using namespace BdfHelpers;
+
+BdfReaderPath::BdfReaderPath(const char* data, int size, const BdfPath &path, bool decode)
+{
+	BdfLookupTable* lookupTable_new;
+	BdfObject* bdf_new = nullptr;
+
+	initLookupTable(data, size, &lookupTable_new);
+
+	view = path.evaluate(data, size);
+
+	if(view && decode && view.element != -1) {
+		bdf_new = BdfColumns::readArrayElement(lookupTable_new, view.data, view.size, view.element);
+	} else if(view && decode) {
+		bdf_new = lookupTable_new->pool.create<BdfObject>(lookupTable_new, view.data, view.size);
+	}
+
+	if(bdf_new == nullptr) {
+		bdf_new = lookupTable_new->pool.create<BdfObject>(lookupTable_new);
+	}
+
+	replaceDocument(bdf_new, lookupTable_new);
+}
+
+BdfPath::View BdfReaderPath::getView() const noexcept {
+	return view;
+}
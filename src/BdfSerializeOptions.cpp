@@ -0,0 +1,9 @@
+
+#include "../include/BdfSerializeOptions.hpp"
+
+using namespace Bdf;
+
+BdfSerializeOptions::BdfSerializeOptions() : BdfSerializeOptions(ArrayEncoding::FIXED) {}
+
+BdfSerializeOptions::BdfSerializeOptions(ArrayEncoding pArrayEncoding, ListEncoding pListEncoding, bool pStringTable, bool pCanonical):
+	arrayEncoding(pArrayEncoding), listEncoding(pListEncoding), stringTable(pStringTable), canonical(pCanonical), compactKeys(false) {}
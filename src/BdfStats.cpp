@@ -0,0 +1,87 @@
+
+#include "../include/BdfStats.hpp"
+#include <sstream>
+
+using namespace Bdf;
+
+const char* statsTypeNames[BdfTypes::ARRAY_FLOAT + 1] = {
+	"undefined", "boolean", "integer", "long", "short", "byte", "double", "float", "string", "list", "named list",
+	"boolean array", "integer array", "long array", "short array", "byte array", "double array", "float array"
+};
+
+BdfStats::BdfStats() {
+	reset();
+}
+
+bool BdfStats::isEnabled() noexcept
+{
+#ifdef BDF_STATS
+	return true;
+#else
+	return false;
+#endif
+}
+
+void BdfStats::reset() noexcept
+{
+	for(uint64_t &count : nodes) {
+		count = 0;
+	}
+
+	bytesParsed = 0;
+	bytesSerialized = 0;
+	keys = 0;
+	keyHits = 0;
+	keyMisses = 0;
+	allocations = 0;
+	allocatedBytes = 0;
+	maxDepth = 0;
+	parseTime = 0;
+	getLocationsTime = 0;
+	serializeSeekerTime = 0;
+	serializeTime = 0;
+	depth = 0;
+}
+
+std::string BdfStats::toString() const
+{
+	std::stringstream out;
+
+	if(!isEnabled()) {
+		out << "Statistics are disabled; build the library with BDF_STATS to record them.\n";
+	}
+
+	for(int i=0;i<=BdfTypes::ARRAY_FLOAT;i++) {
+		if(nodes[i] != 0) {
+			out << "nodes (" << statsTypeNames[i] << "): " << nodes[i] << "\n";
+		}
+	}
+
+	out << "bytes parsed: " << bytesParsed << "\n";
+	out << "bytes serialized: " << bytesSerialized << "\n";
+	out << "keys: " << keys << "\n";
+	out << "key hits: " << keyHits << "\n";
+	out << "key misses: " << keyMisses << "\n";
+	out << "allocations: " << allocations << "\n";
+	out << "allocated bytes: " << allocatedBytes << "\n";
+	out << "max depth: " << maxDepth << "\n";
+	out << "parse time (ns): " << parseTime << "\n";
+	out << "get locations time (ns): " << getLocationsTime << "\n";
+	out << "serialize seeker time (ns): " << serializeSeekerTime << "\n";
+	out << "serialize time (ns): " << serializeTime << "\n";
+
+	return out.str();
+}
+
+void BdfStats::enter() noexcept
+{
+	depth += 1;
+
+	if(depth > maxDepth) {
+		maxDepth = depth;
+	}
+}
+
+void BdfStats::leave() noexcept {
+	depth -= 1;
+}
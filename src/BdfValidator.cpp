@@ -0,0 +1,559 @@
+
+#include "../include/Bdf.hpp"
+#include "../include/BdfHelpers.hpp"
+#include "../include/BdfValidator.hpp"
+#include <climits>
+#include <cstdint>
+
+using namespace Bdf;
+using namespace BdfHelpers;
+
+static const char* validatorMessages[BdfValidator::ErrorType::TOO_DEEP + 1] = {
+	"No error",
+	"Data is empty or too large",
+	"Invalid flag byte",
+	"Object runs past the end of its container",
+	"Size tag is smaller than the object header",
+	"Typed array size is not a whole number of elements",
+	"Invalid compact array encoding",
+	"Invalid columnar list",
+	"Key is not in the lookup table",
+	"String reference is not in the string table",
+	"Lookup table runs past the end of the data",
+	"String table runs past the end of the data",
+	"Data after the end of the string table",
+	"Lists are nested too deeply"
+};
+
+BdfValidator::Result::operator bool() const noexcept {
+	return error == ErrorType::NONE;
+}
+
+const char* BdfValidator::Result::getMessage() const noexcept {
+	return validatorMessages[error];
+}
+
+/*
+ * The type, size tag and parent flags of every flag byte, decoded ahead of time the same way as
+ * BdfObject::getFlagData(), so checking an object only takes a table lookup.
+ */
+class ValidatorFlags
+{
+public:
+	char type[256];
+	char sizeBytes[256];
+	char parentBytes[256];
+
+	constexpr ValidatorFlags() : type(), sizeBytes(), parentBytes()
+	{
+		const char tagBytes[3] = {4, 2, 1};
+
+		for(int flags=0;flags<256;flags++)
+		{
+			int rest = flags;
+
+			if(rest >= 162) {
+				rest -= 162;
+				type[flags] = rest % 10 + 18;
+				rest /= 10;
+			} else {
+				type[flags] = rest % 18;
+				rest /= 18;
+			}
+
+			sizeBytes[flags] = tagBytes[rest % 3];
+			parentBytes[flags] = tagBytes[rest / 3 % 3];
+		}
+	}
+};
+
+constexpr ValidatorFlags validatorFlags;
+
+// The sizes of the primitive types, which have no size tag
+const int validatorPrimitiveSizes[BdfTypes::FLOAT + 1] = {1, 2, 5, 9, 3, 2, 9, 5};
+
+static int getValidatorElementSize(char type)
+{
+	switch(type)
+	{
+		case BdfTypes::ARRAY_BOOLEAN:
+		case BdfTypes::ARRAY_BYTE:
+			return 1;
+		case BdfTypes::ARRAY_SHORT:
+			return 2;
+		case BdfTypes::ARRAY_INTEGER:
+		case BdfTypes::ARRAY_FLOAT:
+			return 4;
+		case BdfTypes::ARRAY_LONG:
+		case BdfTypes::ARRAY_DOUBLE:
+			return 8;
+		default:
+			return 0;
+	}
+}
+
+static bool isValidatorContainer(char type) {
+	return type == BdfTypes::LIST || type == BdfTypes::NAMED_LIST || type == BdfTypes::LIST_COLUMNAR;
+}
+
+/*
+ * Checks a compact array without decoding it, the same way BdfObject's parseCompactArray() reads it.
+ */
+template<typename U> static bool checkValidatorCompactArray(const char* data, int size, uint64_t* pCount)
+{
+	uint64_t count;
+	int pos = get_varint(data, size, &count);
+
+	// Every element takes at least 1 byte, and the decoded array has to fit in an int
+	if(pos == -1 || count > (uint64_t)(size - pos) || count > INT_MAX / sizeof(U)) {
+		return false;
+	}
+
+	for(uint64_t i=0;i<count;i++)
+	{
+		uint64_t zigzag;
+		int varint_size = get_varint(data + pos, size - pos, &zigzag);
+
+		if(varint_size == -1 || zigzag > (U)-1) {
+			return false;
+		}
+
+		pos += varint_size;
+	}
+
+	*pCount = count;
+
+	return pos == size;
+}
+
+/*
+ * A list, named list or columnar list whose items are being checked.
+ */
+class ValidatorFrame
+{
+public:
+	int start;
+	int pos;
+	int end;
+	char type;
+
+	// Columnar lists: the number of rows and the columns left to check.
+	// Lists that are columns: the number of rows the list must have.
+	uint64_t rows;
+	uint64_t columns;
+	uint64_t items;
+	bool checkItems;
+};
+
+class ValidatorState
+{
+public:
+	const char* data;
+	uint64_t keys;
+	uint64_t strings;
+	BdfValidator::Result result;
+
+	bool fail(BdfValidator::ErrorType error, int64_t offset)
+	{
+		result.error = error;
+		result.offset = offset;
+
+		return false;
+	}
+
+	/*
+	 * Checks the object at pos, which has to end by end, and everything inside it except the items of lists.
+	 * Sets its size, its type, the offset of its payload and the number of elements if it is an array.
+	 */
+	bool checkObject(int pos, int end, int* pSize, char* pType, int* pPayload, uint64_t* pCount)
+	{
+		const char* object = data + pos;
+		int available = end - pos;
+
+		if(available < 1) {
+			return fail(BdfValidator::ErrorType::TRUNCATED, pos);
+		}
+
+		// Flag bytes from 252 onwards would need a fourth parent flag, and the
+		// compact encodings only use 5 of the 10 types they have room for
+		unsigned char flags = *(const unsigned char*)object;
+		char type = validatorFlags.type[flags];
+
+		if(flags >= 252 || type > BdfTypes::STRING_REF) {
+			return fail(BdfValidator::ErrorType::INVALID_FLAGS, pos);
+		}
+
+		*pType = type;
+		*pCount = 0;
+
+		// Primitives have a fixed size and no size tag
+		if(type <= BdfTypes::FLOAT)
+		{
+			*pSize = validatorPrimitiveSizes[(int)type];
+			*pPayload = pos + 1;
+
+			if(*pSize > available) {
+				return fail(BdfValidator::ErrorType::TRUNCATED, pos);
+			}
+
+			return true;
+		}
+
+		int size_bytes = validatorFlags.sizeBytes[flags];
+
+		if(1 + size_bytes > available) {
+			return fail(BdfValidator::ErrorType::TRUNCATED, pos);
+		}
+
+		*pPayload = pos + 1 + size_bytes;
+
+		// String references store a location in the string table instead of a size
+		if(type == BdfTypes::STRING_REF)
+		{
+			uint64_t location;
+
+			switch(size_bytes)
+			{
+				case 4:
+					location = get_netui(object + 1);
+					break;
+				case 2:
+					location = get_netus(object + 1);
+					break;
+				default:
+					location = object[1] & 255;
+			}
+
+			if(location >= strings) {
+				return fail(BdfValidator::ErrorType::INVALID_STRING_REF, pos);
+			}
+
+			*pSize = 1 + size_bytes;
+
+			return true;
+		}
+
+		int size;
+
+		switch(size_bytes)
+		{
+			case 4:
+				size = get_netsi(object + 1);
+				break;
+			case 2:
+				size = get_netus(object + 1);
+				break;
+			default:
+				size = object[1] & 255;
+		}
+
+		if(size < 1 + size_bytes) {
+			return fail(BdfValidator::ErrorType::INVALID_SIZE, pos);
+		}
+
+		if(size > available) {
+			return fail(BdfValidator::ErrorType::TRUNCATED, pos);
+		}
+
+		*pSize = size;
+
+		const char* payload = data + *pPayload;
+		int payload_size = size - 1 - size_bytes;
+		bool valid = true;
+
+		switch(type)
+		{
+			case BdfTypes::ARRAY_INTEGER_VARINT:
+				valid = checkValidatorCompactArray<uint32_t>(payload, payload_size, pCount);
+				break;
+			case BdfTypes::ARRAY_LONG_VARINT:
+				valid = checkValidatorCompactArray<uint64_t>(payload, payload_size, pCount);
+				break;
+			case BdfTypes::ARRAY_SHORT_VARINT:
+				valid = checkValidatorCompactArray<uint16_t>(payload, payload_size, pCount);
+				break;
+			default:
+			{
+				int width = getValidatorElementSize(type);
+
+				if(width != 0)
+				{
+					if(payload_size % width != 0) {
+						return fail(BdfValidator::ErrorType::INVALID_ARRAY_SIZE, pos);
+					}
+
+					*pCount = payload_size / width;
+				}
+			}
+		}
+
+		if(!valid) {
+			return fail(BdfValidator::ErrorType::INVALID_ENCODING, pos);
+		}
+
+		return true;
+	}
+
+	/*
+	 * Checks the lookup table and string table after the root object, counting the keys and strings.
+	 */
+	bool checkTables(int root_size, int size)
+	{
+		int lookupTable_size_bytes = validatorFlags.parentBytes[*(const unsigned char*)data];
+
+		if(root_size + lookupTable_size_bytes > size) {
+			return fail(BdfValidator::ErrorType::LOOKUP_TABLE_BOUNDS, root_size);
+		}
+
+		const char* lookupTable = data + root_size;
+		int lookupTable_size;
+
+		switch(lookupTable_size_bytes)
+		{
+			case 4:
+				lookupTable_size = get_netsi(lookupTable);
+				break;
+			case 2:
+				lookupTable_size = get_netus(lookupTable);
+				break;
+			default:
+				lookupTable_size = lookupTable[0] & 255;
+		}
+
+		int lookupTable_start = root_size + lookupTable_size_bytes;
+
+		if(lookupTable_size < 0 || lookupTable_size > size - lookupTable_start) {
+			return fail(BdfValidator::ErrorType::LOOKUP_TABLE_BOUNDS, root_size);
+		}
+
+		for(int i=0;i<lookupTable_size;keys++)
+		{
+			int key_size = data[lookupTable_start + i] & 255;
+
+			if(i + 1 + key_size > lookupTable_size) {
+				return fail(BdfValidator::ErrorType::LOOKUP_TABLE_BOUNDS, lookupTable_start + i);
+			}
+
+			i += 1 + key_size;
+		}
+
+		// Anything after the lookup table is the string table
+		int pos = lookupTable_start + lookupTable_size;
+
+		if(pos == size) {
+			return true;
+		}
+
+		int varint_size = get_varint(data + pos, size - pos, &strings);
+
+		// Every string takes at least 1 byte
+		if(varint_size == -1 || strings > (uint64_t)(size - pos - varint_size)) {
+			strings = 0;
+			return fail(BdfValidator::ErrorType::STRING_TABLE_BOUNDS, pos);
+		}
+
+		pos += varint_size;
+
+		for(uint64_t i=0;i<strings;i++)
+		{
+			uint64_t string_size;
+			varint_size = get_varint(data + pos, size - pos, &string_size);
+
+			if(varint_size == -1 || string_size > (uint64_t)(size - pos - varint_size)) {
+				return fail(BdfValidator::ErrorType::STRING_TABLE_BOUNDS, pos);
+			}
+
+			pos += varint_size + (int)string_size;
+		}
+
+		if(pos != size) {
+			return fail(BdfValidator::ErrorType::TRAILING_DATA, pos);
+		}
+
+		return true;
+	}
+};
+
+BdfValidator::Result BdfValidator::validate(const char* data, int64_t size) noexcept
+{
+	ValidatorState state;
+	state.data = data;
+	state.keys = 0;
+	state.strings = 0;
+	state.result = {ErrorType::NONE, -1};
+
+	if(data == nullptr || size < 1 || size > INT_MAX) {
+		state.fail(ErrorType::INVALID_DATA_SIZE, 0);
+		return state.result;
+	}
+
+	int root_size, payload;
+	char type;
+	uint64_t count;
+
+	// The tables come after the root object, but the keys and strings have to be counted before the objects are checked
+	if(!state.checkObject(0, (int)size, &root_size, &type, &payload, &count) || !state.checkTables(root_size, (int)size)) {
+		return state.result;
+	}
+
+	if(!isValidatorContainer(type)) {
+		return state.result;
+	}
+
+	// Walk the lists with a fixed size stack, so deeply nested data can't overflow the call stack
+	ValidatorFrame stack[MAX_DEPTH];
+	int depth = 0;
+	int start = 0;
+	int end = root_size;
+	uint64_t rows = 0;
+	bool checkItems = false;
+
+	for(;;)
+	{
+		// Push the list found, reading the header of columnar lists
+		if(isValidatorContainer(type))
+		{
+			if(depth == MAX_DEPTH) {
+				state.fail(ErrorType::TOO_DEEP, start);
+				return state.result;
+			}
+
+			ValidatorFrame& frame = stack[depth++];
+			frame.start = start;
+			frame.pos = payload;
+			frame.end = end;
+			frame.type = type;
+			frame.rows = rows;
+			frame.columns = 0;
+			frame.items = 0;
+			frame.checkItems = checkItems;
+
+			if(type == BdfTypes::LIST_COLUMNAR)
+			{
+				int varint_size = get_varint(data + frame.pos, frame.end - frame.pos, &frame.rows);
+
+				if(varint_size != -1) {
+					frame.pos += varint_size;
+					varint_size = get_varint(data + frame.pos, frame.end - frame.pos, &frame.columns);
+				}
+
+				if(varint_size == -1) {
+					state.fail(ErrorType::INVALID_COLUMNS, start);
+					return state.result;
+				}
+
+				frame.pos += varint_size;
+				int remaining = frame.end - frame.pos;
+
+				// Every column takes at least 1 byte per row, plus its key and flag byte
+				if(frame.columns == 0 || frame.rows > (uint64_t)remaining || frame.columns > (uint64_t)remaining / 2) {
+					state.fail(ErrorType::INVALID_COLUMNS, start);
+					return state.result;
+				}
+			}
+		}
+
+		// Pop every list that has been checked to the end
+		while(depth > 0 && stack[depth - 1].pos == stack[depth - 1].end)
+		{
+			ValidatorFrame& frame = stack[depth - 1];
+
+			if((frame.type == BdfTypes::LIST_COLUMNAR && frame.columns != 0) ||
+					(frame.checkItems && frame.items != frame.rows)) {
+				state.fail(ErrorType::INVALID_COLUMNS, frame.start);
+				return state.result;
+			}
+
+			depth -= 1;
+		}
+
+		if(depth == 0) {
+			return state.result;
+		}
+
+		// Check the next item of the innermost list
+		ValidatorFrame& frame = stack[depth - 1];
+		start = frame.pos;
+
+		if(frame.type == BdfTypes::LIST_COLUMNAR)
+		{
+			uint64_t key;
+			int varint_size = get_varint(data + start, frame.end - start, &key);
+
+			if(frame.columns == 0 || varint_size == -1) {
+				state.fail(ErrorType::INVALID_COLUMNS, start);
+				return state.result;
+			}
+
+			if(key >= state.keys) {
+				state.fail(ErrorType::INVALID_KEY, start);
+				return state.result;
+			}
+
+			start += varint_size;
+		}
+
+		int object_size;
+
+		if(!state.checkObject(start, frame.end, &object_size, &type, &payload, &count)) {
+			return state.result;
+		}
+
+		end = start + object_size;
+		frame.pos = end;
+		frame.items += 1;
+		rows = 0;
+		checkItems = false;
+
+		// Named list items are followed by their key
+		if(frame.type == BdfTypes::NAMED_LIST)
+		{
+			int key_size = validatorFlags.parentBytes[*(const unsigned char*)(data + start)];
+
+			if(key_size > frame.end - end) {
+				state.fail(ErrorType::TRUNCATED, end);
+				return state.result;
+			}
+
+			int64_t key;
+
+			switch(key_size)
+			{
+				case 4:
+					key = get_netsi(data + end);
+					break;
+				case 2:
+					key = get_netus(data + end);
+					break;
+				default:
+					key = data[end] & 255;
+			}
+
+			if(key < 0 || (uint64_t)key >= state.keys) {
+				state.fail(ErrorType::INVALID_KEY, end);
+				return state.result;
+			}
+
+			frame.pos += key_size;
+		}
+
+		// Columns are typed arrays or lists with one element for each row
+		else if(frame.type == BdfTypes::LIST_COLUMNAR)
+		{
+			frame.columns -= 1;
+
+			if(type >= BdfTypes::ARRAY_BOOLEAN && type <= BdfTypes::ARRAY_SHORT_VARINT) {
+				if(count != frame.rows) {
+					state.fail(ErrorType::INVALID_COLUMNS, start);
+					return state.result;
+				}
+			} else if(type == BdfTypes::LIST) {
+				rows = frame.rows;
+				checkItems = true;
+			} else {
+				state.fail(ErrorType::INVALID_COLUMNS, start);
+				return state.result;
+			}
+		}
+	}
+}
@@ -0,0 +1,119 @@
+
+#ifndef INPUTDATA_HPP_
+#define INPUTDATA_HPP_
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define INPUTDATA_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define INPUTDATA_HAS_MMAP 0
+#endif
+
+/**
+ * Input data read by the tools from a file or standard input. Files are mapped into memory where the platform allows it, so large
+ * inputs are paged in from disk by the parsers instead of being copied. Standard input is read in large chunks.
+ */
+class InputData
+{
+public:
+	const char* data = nullptr;
+	size_t size = 0;
+	
+	explicit InputData(const std::filesystem::path &path) {
+#if INPUTDATA_HAS_MMAP
+		int fd = open(path.c_str(), O_RDONLY);
+		
+		if (fd == -1) {
+			throw std::runtime_error("Could not open " + path.string() + " for reading.");
+		}
+		
+		struct stat st;
+		
+		if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+			size = st.st_size;
+			
+			if (size > 0) {
+				void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+				
+				if (mapping != MAP_FAILED) {
+					madvise(mapping, size, MADV_SEQUENTIAL);
+					mapped = mapping;
+					data = (const char*)mapping;
+				}
+			}
+			
+			if (mapped != nullptr || size == 0) {
+				close(fd);
+				return;
+			}
+		}
+		
+		close(fd);
+#endif
+		// Fall back to reading the file in chunks if it could not be mapped, such as when it is a pipe.
+		std::ifstream ifstr(path, std::ios::binary);
+		
+		if (!ifstr) {
+			throw std::runtime_error("Could not open " + path.string() + " for reading.");
+		}
+		
+		readStream(ifstr);
+	}
+	
+	explicit InputData(std::istream &istream) {
+		readStream(istream);
+	}
+	
+	InputData(const InputData &) = delete;
+	InputData &operator=(const InputData &) = delete;
+	
+	~InputData() {
+#if INPUTDATA_HAS_MMAP
+		if (mapped != nullptr) {
+			munmap(mapped, size);
+		}
+#endif
+	}
+	
+private:
+	static constexpr size_t CHUNK_SIZE = 1 << 20;
+	
+	void* mapped = nullptr;
+	std::vector<char> buffer;
+	
+	void readStream(std::istream &istream) {
+		// Read straight into the buffer in large chunks. The buffer grows geometrically, so each byte is
+		// moved a constant number of times on average however large the input is.
+		size_t used = 0;
+		
+		while (istream) {
+			if (buffer.size() - used < CHUNK_SIZE) {
+				buffer.resize(std::max(buffer.size() * 2, used + CHUNK_SIZE));
+			}
+			
+			istream.read(buffer.data() + used, buffer.size() - used);
+			used += istream.gcount();
+		}
+		
+		if (istream.bad()) {
+			throw std::runtime_error("Could not read the input BDF data.");
+		}
+		
+		buffer.resize(used);
+		data = buffer.data();
+		size = used;
+	}
+};
+
+#endif
@@ -4,12 +4,23 @@
 
 #include <tclap/CmdLine.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <filesystem>
 #include <iterator>
 #include <iostream>
 #include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
-#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "InputData.hpp"
 
 std::string command = "bdfconvert";
 
@@ -19,6 +30,12 @@ bool keepGoing = false;
 bool validate = false;
 bool pretty = false;
 bool minified = false;
+bool memoryUsage = false;
+int memoryDepth = 1;
+std::string batchList;
+std::filesystem::path batchDir, outputDir;
+unsigned int jobs = 0;
+unsigned int batchMemory = 1024;
 
 void getCliArgsOrShowHelp(int argc, char** argv) {
 	try {
@@ -57,6 +74,27 @@ void getCliArgsOrShowHelp(int argc, char** argv) {
 		// -v, --validate
 		TCLAP::SwitchArg validateArg("V", "validate", "Only read the input and check it for errors, but do not attempt to convert it to any output. If no error message is generated, bdfconvert has successfully validated your BDF data is without error.", cmd, false);
 		
+		// -M, --memory-usage
+		TCLAP::SwitchArg memoryUsageArg("M", "memory-usage", "Only read the input and print how much memory it occupies once parsed, broken down by category, for the whole document and each subtree down to --memory-depth levels.", cmd, false);
+		
+		// --memory-depth
+		TCLAP::ValueArg<int> memoryDepthArg("", "memory-depth", "How many levels of subtrees --memory-usage prints.", false, 1, "levels", cmd);
+		
+		// -l, --batch-list
+		TCLAP::ValueArg<std::string> batchListArg("l", "batch-list", "Convert every file listed in this file, one path per line, and write the results to --output-dir. Pass '-' to read the list from standard input.", false, std::string(), "filename", cmd);
+		
+		// -D, --batch-dir
+		TCLAP::ValueArg<std::string> batchDirArg("D", "batch-dir", "Convert every file in this directory and its subdirectories, and write the results to --output-dir.", false, std::string(), "directory", cmd);
+		
+		// -d, --output-dir
+		TCLAP::ValueArg<std::string> outputDirArg("d", "output-dir", "In batch mode, the directory to write the converted files to. The directories of the input files are mirrored inside it, and each file gets the extension .bdf or .hbdf for its output mode.", false, std::string(), "directory", cmd);
+		
+		// -j, --jobs
+		TCLAP::ValueArg<unsigned int> jobsArg("j", "jobs", "In batch mode, how many files to convert at once. Defaults to the number of processors.", false, 0, "count", cmd);
+		
+		// --batch-memory
+		TCLAP::ValueArg<unsigned int> batchMemoryArg("", "batch-memory", "In batch mode, the most input data to convert at once, in MiB. A file larger than this is converted on its own.", false, 1024, "MiB", cmd);
+		
 		// Parse the argv array.
 		cmd.parse( argc, argv );
 		
@@ -64,6 +102,13 @@ void getCliArgsOrShowHelp(int argc, char** argv) {
 		pretty = prettyArg.getValue();
 		minified = minifiedArg.getValue();
 		validate = validateArg.getValue();
+		memoryUsage = memoryUsageArg.getValue();
+		memoryDepth = memoryDepthArg.getValue();
+		batchList = batchListArg.getValue();
+		batchDir = batchDirArg.getValue();
+		outputDir = outputDirArg.getValue();
+		jobs = jobsArg.getValue();
+		batchMemory = batchMemoryArg.getValue();
 		
 		inputMode = inputModeArg.getValue();
 		outputMode = outputModeArg.getValue();
@@ -74,28 +119,60 @@ void getCliArgsOrShowHelp(int argc, char** argv) {
 	}
 }
 
-bool stringHasNonPrintableChars(const std::string &toCheck) {
-	return true;// !std::all_of( toCheck.begin(), toCheck.end(), []( char c ));
+bool hasNonPrintableChars(const InputData &inputData) {
+	// Human-readable data is UTF-8 text, which only uses control characters for whitespace. Checking the start
+	// of the input is enough, as every binary BDF file starts with the flags of its root object.
+	size_t checkSize = std::min(inputData.size, (size_t)4096);
+	
+	for (size_t i = 0; i < checkSize; i++) {
+		unsigned char c = inputData.data[i];
+		
+		if ((c < 0x20 && c != '\t' && c != '\n' && c != '\r') || c == 0x7f) {
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+void checkBinaryInput(const InputData &inputData) {
+	if (inputData.size > (size_t)std::numeric_limits<int>::max()) {
+		throw std::runtime_error("The input is too large to be binary BDF data, which is limited to 2 GiB.");
+	}
+	
+	// The binary parser skips anything malformed, so check the structure first rather than convert part of the data.
+	Bdf::BdfValidator::Result result = Bdf::BdfValidator::validate(inputData.data, inputData.size);
+	
+	if (!result) {
+		throw std::runtime_error("Invalid binary BDF data at byte " + std::to_string(result.offset) + ": " + result.getMessage() + ".");
+	}
+}
+
+bool isBinaryInput(const InputData &inputData, const std::string &mode) {
+	return mode == "binary" || (mode == "auto" && hasNonPrintableChars(inputData));
 }
 
-Bdf::BdfReader *tryBinaryReader(const std::stringstream &inputData) {
+Bdf::BdfReader *tryBinaryReader(const InputData &inputData, std::string &mode) {
 	Bdf::BdfReader *reader = nullptr;
 	try {
-		Bdf::BdfReader *reader = new Bdf::BdfReader(inputData.str().c_str(), inputData.str().size());
+		checkBinaryInput(inputData);
+		
+		reader = new Bdf::BdfReader(inputData.data, (int)inputData.size);
 		
 		// Make sure we have a valid reader.
 		if (reader->getObject()->getType() == Bdf::BdfTypes::UNDEFINED) {
 			delete reader;
+			reader = nullptr;
 		} else {
-			inputMode = "binary";
+			mode = "binary";
 		}
-	} catch (Bdf::BdfError &e) {
-
+	} catch (std::exception &e) {
 		delete reader;
+		reader = nullptr;
 		
 		// Size tag mismatches could theoretically be triggered by human-readable BDF data being interpreted as binary
-		// if our characters line up just the right way. No need to rethrow those if we're using auto inputMode.
-		if (inputMode != "auto") {
+		// if our characters line up just the right way. No need to rethrow those if we're using auto input mode.
+		if (mode != "auto") {
 			throw;
 		}
 	}
@@ -103,19 +180,15 @@ Bdf::BdfReader *tryBinaryReader(const std::stringstream &inputData) {
 	return reader;
 }
 
-Bdf::BdfReader *tryHumanReader(const std::stringstream &inputData) {
+Bdf::BdfReader *tryHumanReader(const InputData &inputData, std::string &mode) {
 	Bdf::BdfReader *reader = nullptr;
 	try {
-		reader = new Bdf::BdfReaderHuman(inputData.str());
+		reader = new Bdf::BdfReaderHuman(inputData.data, inputData.size);
 		
-		inputMode = "human";
-	} catch (Bdf::BdfError &e) {
-		delete reader;
-		throw;
-	} catch (...) {
-		delete reader;
-		
-		if (inputMode != "auto") {
+		mode = "human";
+	} catch (std::range_error &e) {
+		// The input isn't valid UTF-8, so it's probably binary data.
+		if (mode != "auto") {
 			throw;
 		}
 	}
@@ -123,13 +196,13 @@ Bdf::BdfReader *tryHumanReader(const std::stringstream &inputData) {
 	return reader;
 }
 
-Bdf::BdfReader* getBdfInputReader(const std::stringstream &inputData) {
+Bdf::BdfReader* getBdfInputReader(const InputData &inputData, std::string &mode) {
 	Bdf::BdfReader *reader = nullptr;
 	bool triedBinaryReader = false;
 	bool triedHumanReader = false;
 	bool checkedForNonPrintableCharacters = false;
 	
-	if (inputMode == "auto") {
+	if (mode == "auto") {
 		while (reader == nullptr) {
 			// We need to try determining if we have a binary or human-readable file.
 			
@@ -141,41 +214,50 @@ Bdf::BdfReader* getBdfInputReader(const std::stringstream &inputData) {
 			if (!checkedForNonPrintableCharacters) {
 				checkedForNonPrintableCharacters = true;
 				
-				if (stringHasNonPrintableChars(inputData.str())) {
+				if (hasNonPrintableChars(inputData)) {
 					triedBinaryReader = true;
-					reader = tryBinaryReader(inputData);
+					reader = tryBinaryReader(inputData, mode);
 				}
 			} else if (!triedHumanReader) {
 				triedHumanReader = true;
-				reader = tryHumanReader(inputData);
+				reader = tryHumanReader(inputData, mode);
 			} else if (!triedBinaryReader) {
 				triedBinaryReader = true;
-				reader = tryBinaryReader(inputData);
+				reader = tryBinaryReader(inputData, mode);
 			} else {
 				throw std::runtime_error("Could not automatically determine the type of input BDF data. Check that it is valid, and try passing -i human|binary to manually set the input data type.");
 			}
 		}
-	} else if (inputMode == "human") {
-		reader = tryHumanReader(inputData);
-	} else if (inputMode =="binary") {
-		reader = tryBinaryReader(inputData);
+	} else if (mode == "human") {
+		reader = tryHumanReader(inputData, mode);
+	} else if (mode =="binary") {
+		reader = tryBinaryReader(inputData, mode);
 	}
 	
 	return reader;
 }
 
-std::stringstream getBdfInputData(std::istream &istream) {
-	std::stringstream dataStream;
-	// We can't rely on the native BdfReaderHuman filesystem::path constructor as we also need to handle stdin
-	// with the same code. So write our own.
-    while(!istream.eof()) {
-        std::string line;
-        std::getline(istream, line);
-		dataStream << line;
-    }
-	
-	// Return our complete stream
-	return dataStream;
+void printMemoryUsage(Bdf::BdfObject *object, const std::string &path, int level) {
+	std::cout << (path.empty() ? "(root)" : path) << "\t" << object->memoryUsage().toString() << std::endl;
+	
+	if (level >= memoryDepth) {
+		return;
+	}
+	
+	if (object->getType() == Bdf::BdfTypes::NAMED_LIST) {
+		Bdf::BdfNamedList *nl = object->getNamedList();
+		
+		for (int key : nl->keys()) {
+			std::string name = object->getKeyName(key);
+			printMemoryUsage(nl->get(key), path.empty() ? name : path + "." + name, level + 1);
+		}
+	} else if (object->getType() == Bdf::BdfTypes::LIST) {
+		uint64_t index = 0;
+		
+		for (Bdf::BdfObject *item : *object->getList()) {
+			printMemoryUsage(item, path + "[" + std::to_string(index++) + "]", level + 1);
+		}
+	}
 }
 
 Bdf::BdfIndent getIndenter() {
@@ -186,32 +268,300 @@ Bdf::BdfIndent getIndenter() {
 	}
 }
 
+void writeBdfOutput(Bdf::BdfReader *reader, std::ostream &ostream, const std::string &mode) {
+	if(mode == "binary") {
+		char* data;
+		int data_size;
+		reader->serialize(&data, &data_size);
+		
+		ostream.write(data, data_size);
+		delete[] data;
+	} else if(mode == "human") {
+		reader->serializeHumanReadable(ostream, getIndenter());
+	}
+	
+	ostream.flush();
+	
+	if (!ostream) {
+		throw std::runtime_error("Could not write the output BDF data.");
+	}
+}
+
+/**
+ * Limits the total size of the input files being converted at once in batch mode, so memory use stays bounded
+ * however many threads are converting.
+ */
+class MemoryBudget
+{
+public:
+	explicit MemoryBudget(uint64_t limit) : available(limit), limit(limit) {
+	}
+	
+	uint64_t acquire(uint64_t bytes) {
+		// A file larger than the whole budget waits for every other file to finish, then is converted alone.
+		bytes = std::min(bytes, limit);
+		
+		std::unique_lock<std::mutex> lock(mutex);
+		released.wait(lock, [&] { return available >= bytes; });
+		available -= bytes;
+		
+		return bytes;
+	}
+	
+	void release(uint64_t bytes) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			available += bytes;
+		}
+		
+		released.notify_all();
+	}
+	
+private:
+	std::mutex mutex;
+	std::condition_variable released;
+	uint64_t available;
+	uint64_t limit;
+};
+
+class BatchJob
+{
+public:
+	std::filesystem::path input;
+	
+	// The path of the output relative to the output directory, before its extension is set.
+	std::filesystem::path output;
+};
+
+std::filesystem::path getMirrorPath(const std::filesystem::path &input, const std::filesystem::path &base) {
+	std::filesystem::path relative = base.empty() ? input : input.lexically_relative(base);
+	std::filesystem::path mirror;
+	
+	// Drop the root and any parent directory references, so the output always stays inside the output directory.
+	for (const std::filesystem::path &part : relative.lexically_normal().relative_path()) {
+		if (part != ".." && part != ".") {
+			mirror /= part;
+		}
+	}
+	
+	return mirror;
+}
+
+std::vector<BatchJob> getBatchJobs() {
+	std::vector<BatchJob> batchJobs;
+	
+	if (!batchDir.empty()) {
+		if (!std::filesystem::is_directory(batchDir)) {
+			throw std::runtime_error("The batch directory " + batchDir.string() + " does not exist.");
+		}
+		
+		for (const std::filesystem::directory_entry &entry : std::filesystem::recursive_directory_iterator(batchDir)) {
+			if (entry.is_regular_file()) {
+				batchJobs.push_back({entry.path(), getMirrorPath(entry.path(), batchDir)});
+			}
+		}
+		
+		std::sort(batchJobs.begin(), batchJobs.end(), [](const BatchJob &a, const BatchJob &b) {
+			return a.input < b.input;
+		});
+	}
+	
+	if (!batchList.empty()) {
+		std::ifstream listFile;
+		
+		if (batchList != "-") {
+			listFile.open(batchList);
+			
+			if (!listFile) {
+				throw std::runtime_error("Could not open the batch list " + batchList + " for reading.");
+			}
+		}
+		
+		std::istream &list = batchList == "-" ? std::cin : listFile;
+		std::string line;
+		
+		while (std::getline(list, line)) {
+			if (!line.empty() && line.back() == '\r') {
+				line.pop_back();
+			}
+			
+			if (!line.empty()) {
+				batchJobs.push_back({line, getMirrorPath(line, std::filesystem::path())});
+			}
+		}
+	}
+	
+	return batchJobs;
+}
+
+void convertBatchFile(const BatchJob &job, MemoryBudget &budget, uint64_t &bytesIn, uint64_t &bytesOut) {
+	uint64_t reserved = budget.acquire(std::filesystem::file_size(job.input));
+	
+	try {
+		std::string mode = inputMode;
+		std::unique_ptr<Bdf::BdfReader> reader;
+		
+		{
+			InputData inputData(job.input);
+			bytesIn = inputData.size;
+			
+			// Binary data can be validated without building the tree.
+			if (validate && isBinaryInput(inputData, mode)) {
+				checkBinaryInput(inputData);
+			} else {
+				reader.reset(getBdfInputReader(inputData, mode));
+				
+				if (reader == nullptr) {
+					throw std::runtime_error("The input is not valid BDF data.");
+				}
+			}
+		}
+		
+		if (!validate) {
+			// Outputs always go to a file, so auto picks the opposite of the input mode.
+			std::string outMode = outputMode;
+			
+			if (outMode == "auto") {
+				outMode = mode == "binary" ? "human" : "binary";
+			}
+			
+			std::filesystem::path output = outputDir / job.output;
+			output.replace_extension(outMode == "binary" ? ".bdf" : ".hbdf");
+			
+			if (output.has_parent_path()) {
+				std::filesystem::create_directories(output.parent_path());
+			}
+			
+			std::ofstream ofstr(output, std::ios::binary);
+			
+			if (!ofstr) {
+				throw std::runtime_error("Could not open " + output.string() + " for writing.");
+			}
+			
+			writeBdfOutput(reader.get(), ofstr, outMode);
+			bytesOut = ofstr.tellp();
+		}
+	} catch (...) {
+		budget.release(reserved);
+		throw;
+	}
+	
+	budget.release(reserved);
+}
+
+int runBatch() {
+	if (!inputFile.empty() || !outputFile.empty()) {
+		throw std::runtime_error("--input-file and --output-file can't be used in batch mode.");
+	}
+	
+	if (outputDir.empty() && !validate) {
+		throw std::runtime_error("Batch mode needs an --output-dir to write the converted files to.");
+	}
+	
+	std::vector<BatchJob> batchJobs = getBatchJobs();
+	
+	unsigned int threadCount = jobs != 0 ? jobs : std::max(1u, std::thread::hardware_concurrency());
+	threadCount = std::max(1u, (unsigned int)std::min((size_t)threadCount, batchJobs.size()));
+	
+	MemoryBudget budget((uint64_t)std::max(1u, batchMemory) << 20);
+	std::atomic<size_t> next(0);
+	std::atomic<uint64_t> converted(0), failed(0), totalIn(0), totalOut(0);
+	std::mutex errorMutex;
+	
+	auto start = std::chrono::steady_clock::now();
+	
+	// Each thread takes the next file in the list until there are none left.
+	auto worker = [&]() {
+		for (size_t i = next++; i < batchJobs.size(); i = next++) {
+			const BatchJob &job = batchJobs[i];
+			uint64_t bytesIn = 0, bytesOut = 0;
+			std::string error;
+			
+			try {
+				convertBatchFile(job, budget, bytesIn, bytesOut);
+			} catch (Bdf::BdfError &e) {
+				error = e.getErrorShort() + " (line " + std::to_string(e.getLine()) + ", at " + std::to_string(e.getAt()) + ")";
+			} catch (std::exception &e) {
+				error = e.what();
+			}
+			
+			totalIn += bytesIn;
+			totalOut += bytesOut;
+			
+			if (error.empty()) {
+				converted++;
+			} else {
+				failed++;
+				
+				std::lock_guard<std::mutex> lock(errorMutex);
+				std::cerr << job.input.string() << ": " << error << std::endl;
+			}
+		}
+	};
+	
+	std::vector<std::thread> threads;
+	
+	for (unsigned int i = 0; i < threadCount; i++) {
+		threads.emplace_back(worker);
+	}
+	
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+	
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	double rate = seconds > 0 ? totalIn / seconds / (1 << 20) : 0;
+	
+	std::cout << (validate ? "Validated " : "Converted ") << converted << " of " << batchJobs.size() << " files";
+	std::cout << " (" << failed << " failed) with " << threadCount << " threads in " << seconds << " s" << std::endl;
+	std::cout << "Read " << totalIn << " bytes, wrote " << totalOut << " bytes, " << rate << " MiB/s, ";
+	std::cout << (seconds > 0 ? converted / seconds : 0) << " files/s" << std::endl;
+	
+	return failed == 0 ? 0 : 2;
+}
+
 int main(int argc, char** argv)
 {
 	// Get command line arguments, or show help if necessary 
 	getCliArgsOrShowHelp(argc, argv);
 	
-	std::string mode = "";
-	std::string indent = "";
-	std::string breaker = "";
+	// We only use the C++ streams, so let them buffer independently of stdio.
+	std::ios::sync_with_stdio(false);
+	
+	// Convert many files at once if a batch of inputs was given.
+	if (!batchList.empty() || !batchDir.empty()) {
+		try {
+			return runBatch();
+		} catch (std::exception &e) {
+			std::cerr << "Error: " << e.what() << std::endl;
+			return 1;
+		}
+	}
+	
 	Bdf::BdfReader *reader = nullptr;
-	std::stringstream inputData;
 
 	try {
-		// Get an input stream.
+		// Get the input data.
 		// Use stdin if a valid path is not given.
+		std::unique_ptr<InputData> inputData;
+		
 		if (inputFile.empty()) {
-			inputData = getBdfInputData(std::cin);
+			inputData = std::make_unique<InputData>(std::cin);
 		} else {
 			if (!std::filesystem::exists(inputFile)) {
 				throw std::runtime_error("An input file was specified but it does not exist.");
 			}
-			std::ifstream ifstr(inputFile);
-			inputData = getBdfInputData(ifstr);
+			inputData = std::make_unique<InputData>(inputFile);
 		}
 
-		// Prepare our reader.
-		reader = getBdfInputReader(inputData);
+		// Binary data can be validated without building the tree.
+		if (validate && isBinaryInput(*inputData, inputMode)) {
+			checkBinaryInput(*inputData);
+			exit(0);
+		}
+		
+		// Prepare our reader. The parsed objects don't refer back to the input, so it's released right after.
+		reader = getBdfInputReader(*inputData, inputMode);
 	} catch (Bdf::BdfError &e) {
 		std::cerr << "A parse error occured while parsing the input BDF data." << std::endl;
 		std::cerr << "Description: " << e.getErrorShort() << std::endl;
@@ -219,6 +569,13 @@ int main(int argc, char** argv)
 		std::cerr << "At         : " << e.getAt() << std::endl;
 		std::cerr << "Context    : " << e.getContext() << std::endl;
 		
+		if (!keepGoing) {
+			exit(2);
+		}
+	} catch (std::exception &e) {
+		std::cerr << "An error occured while reading the input BDF data." << std::endl;
+		std::cerr << e.what() << std::endl;
+		
 		if (!keepGoing) {
 			exit(2);
 		}
@@ -230,6 +587,15 @@ int main(int argc, char** argv)
 			exit(0);
 		}
 		
+		// Print the memory usage instead of converting if requested.
+		if (memoryUsage && reader != nullptr) {
+			std::cout << "(document)\t" << reader->memoryUsage().toString() << std::endl;
+			printMemoryUsage(reader->getObject(), "", 0);
+			
+			delete reader;
+			exit(0);
+		}
+		
 		// We might end up with a nullptr BdfReader if one of the above steps failed,
 		// especially if --keep-going was set.
 		if (reader == nullptr) {
@@ -246,25 +612,18 @@ int main(int argc, char** argv)
 			}
 		}
 		
-		// Fallthrough
-		if(mode == "binary") {
-			char* data;
-			int data_size;
-			reader->serialize(&data, &data_size);
-
-			for(int i=0;i<data_size;i+=1024) {
-				std::cout.write(data + i, std::min(1024, data_size - i));
-			}
-
-			delete[] data;
-		} else if(outputMode == "human") {
-			if (outputFile.empty()) {
-				reader->serializeHumanReadable(std::cout, getIndenter());
-			} else {
-				std::ofstream ofstr(inputFile);
-				reader->serializeHumanReadable(ofstr, getIndenter());
+		// Write straight to the output file or stdout, without building the output in memory first where possible.
+		std::ofstream ofstr;
+		
+		if (!outputFile.empty()) {
+			ofstr.open(outputFile, std::ios::binary);
+			
+			if (!ofstr) {
+				throw std::runtime_error("Could not open " + outputFile.string() + " for writing.");
 			}
-		}		
+		}
+		
+		writeBdfOutput(reader, outputFile.empty() ? std::cout : ofstr, outputMode);
 	} catch (std::exception &e) {
 		std::cerr << "An error occured while writing the output BDF data." << std::endl;
 		std::cerr << e.what();
@@ -0,0 +1,739 @@
+
+#include "../include/Bdf.hpp"
+#include "../include/version.hpp"
+
+#include <tclap/CmdLine.h>
+
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/*
+ * bdfgen.cpp
+ *
+ * Generates reproducible synthetic BDF documents for benchmarking. The same seed and options
+ * always produce the same document on any machine, since the random numbers come from a
+ * fixed algorithm rather than the standard library distributions.
+ *
+ * Documents are written while they are generated, so the tree is never held in memory.
+ * Binary output is generated twice, once to measure the size of every list and once to
+ * write it, since the size of each list is stored before its contents.
+ */
+
+std::string command = "bdfgen";
+
+class Range
+{
+public:
+	uint64_t min;
+	uint64_t max;
+};
+
+enum GenType {
+	GEN_BOOLEAN, GEN_BYTE, GEN_SHORT, GEN_INTEGER, GEN_LONG, GEN_FLOAT, GEN_DOUBLE, GEN_STRING,
+	GEN_ARRAY_BOOLEAN, GEN_ARRAY_BYTE, GEN_ARRAY_SHORT, GEN_ARRAY_INTEGER, GEN_ARRAY_LONG, GEN_ARRAY_FLOAT, GEN_ARRAY_DOUBLE,
+	GEN_LIST, GEN_NAMED_LIST, GEN_TYPE_COUNT
+};
+
+const char* genTypeNames[GEN_TYPE_COUNT] = {
+	"bool", "byte", "short", "int", "long", "float", "double", "string",
+	"bool-array", "byte-array", "short-array", "int-array", "long-array", "float-array", "double-array",
+	"list", "named-list"
+};
+
+uint64_t seed = 1;
+int depth = 3;
+int fanOut = 8;
+int keyCount = 64;
+Range keyLength = {4, 12};
+Range stringLength = {0, 32};
+Range arrayLength = {0, 64};
+uint64_t typeWeights[GEN_TYPE_COUNT];
+std::string outputMode = "binary";
+std::filesystem::path outputFile;
+bool pretty = false;
+
+Range parseRange(const std::string &arg, const std::string &name)
+{
+	size_t colon = arg.find(':');
+	Range range;
+
+	try
+	{
+		if(colon == std::string::npos) {
+			range.min = range.max = std::stoull(arg);
+		} else {
+			range.min = std::stoull(arg.substr(0, colon));
+			range.max = std::stoull(arg.substr(colon + 1));
+		}
+	}
+
+	catch(std::exception &e) {
+		throw std::runtime_error("Invalid range for " + name + ": " + arg);
+	}
+
+	if(range.min > range.max || range.max > INT_MAX) {
+		throw std::runtime_error("Invalid range for " + name + ": " + arg);
+	}
+
+	return range;
+}
+
+void parseTypes(const std::string &arg)
+{
+	for(int i=0;i<GEN_TYPE_COUNT;i++) {
+		typeWeights[i] = 0;
+	}
+
+	size_t start = 0;
+
+	while(start < arg.size())
+	{
+		size_t end = arg.find(',', start);
+
+		if(end == std::string::npos) {
+			end = arg.size();
+		}
+
+		std::string item = arg.substr(start, end - start);
+		size_t equals = item.find('=');
+		std::string name = item.substr(0, equals);
+		int type = 0;
+
+		while(type < GEN_TYPE_COUNT && name != genTypeNames[type]) {
+			type++;
+		}
+
+		if(type == GEN_TYPE_COUNT) {
+			throw std::runtime_error("Unknown type in type mix: " + name);
+		}
+
+		try {
+			typeWeights[type] = equals == std::string::npos ? 1 : std::stoull(item.substr(equals + 1));
+		} catch(std::exception &e) {
+			throw std::runtime_error("Invalid weight in type mix: " + item);
+		}
+
+		start = end + 1;
+	}
+
+	// Without any container types, every list is a named list
+	if(typeWeights[GEN_LIST] == 0 && typeWeights[GEN_NAMED_LIST] == 0) {
+		typeWeights[GEN_NAMED_LIST] = 1;
+	}
+
+	for(int i=0;i<GEN_LIST;i++) {
+		if(typeWeights[i] != 0) {
+			return;
+		}
+	}
+
+	throw std::runtime_error("The type mix needs at least one type that isn't a list.");
+}
+
+void getCliArgsOrShowHelp(int argc, char** argv) {
+	try {
+		TCLAP::CmdLine cmd("Generates reproducible synthetic BDF documents for benchmarking.", ' ', Bdf::getLibraryVersion());
+
+		// -s, --seed
+		TCLAP::ValueArg<uint64_t> seedArg("s", "seed", "The seed to generate the document from. The same seed and options always generate the same document.", false, 1, "number", cmd);
+
+		// -d, --depth
+		TCLAP::ValueArg<int> depthArg("d", "depth", "The number of levels of lists above the values at the bottom of the document.", false, 3, "number", cmd);
+
+		// -n, --fan-out
+		TCLAP::ValueArg<int> fanOutArg("n", "fan-out", "The number of items in every list.", false, 8, "number", cmd);
+
+		// -k, --keys
+		TCLAP::ValueArg<int> keysArg("k", "keys", "The number of distinct keys used by named lists. This must be at least the fan-out if named lists are generated.", false, 64, "number", cmd);
+
+		// --key-length
+		TCLAP::ValueArg<std::string> keyLengthArg("", "key-length", "The length of keys in characters, either a fixed length or a uniformly distributed range min:max, up to 255.", false, "4:12", "min:max", cmd);
+
+		// --string-length
+		TCLAP::ValueArg<std::string> stringLengthArg("", "string-length", "The length of strings in characters, either a fixed length or a uniformly distributed range min:max.", false, "0:32", "min:max", cmd);
+
+		// --array-length
+		TCLAP::ValueArg<std::string> arrayLengthArg("", "array-length", "The number of elements in arrays, either a fixed length or a uniformly distributed range min:max.", false, "0:64", "min:max", cmd);
+
+		// -t, --types
+		TCLAP::ValueArg<std::string> typesArg("t", "types", "The mix of types as a comma separated list of type=weight. The types are bool, byte, short, int, long, float, double, string, their arrays (e.g. int-array), and list and named-list, which are used for every level above the bottom.", false, "int=4,long=2,double=2,string=4,bool=1,int-array=1,named-list=1", "mix", cmd);
+
+		// -o, --output-mode
+		std::vector<std::string> outputModeArgVector{"binary", "human"};
+		TCLAP::ValuesConstraint<std::string> outputModeArgConstraint(outputModeArgVector);
+		TCLAP::ValueArg<std::string> outputModeArg("o", "output-mode", "Select the type of BDF data that you would like to output.", false, "binary", &outputModeArgConstraint, cmd);
+
+		// -w, --output-file
+		TCLAP::ValueArg<std::string> outputFileArg("w", "output-file", "If you need to write BDF data to a file, specify its path here. Leave this argument unspecified to write to standard output instead.", false, std::string(), "filename", cmd);
+
+		// -p, --pretty
+		TCLAP::SwitchArg prettyArg("p", "pretty", "If bdfgen outputs human-readable BDF data, optimise it to look pretty.", cmd, false);
+
+		// Parse the argv array.
+		cmd.parse( argc, argv );
+
+		seed = seedArg.getValue();
+		depth = depthArg.getValue();
+		fanOut = fanOutArg.getValue();
+		keyCount = keysArg.getValue();
+		keyLength = parseRange(keyLengthArg.getValue(), "--key-length");
+		stringLength = parseRange(stringLengthArg.getValue(), "--string-length");
+		arrayLength = parseRange(arrayLengthArg.getValue(), "--array-length");
+		parseTypes(typesArg.getValue());
+
+		outputMode = outputModeArg.getValue();
+		outputFile = outputFileArg.getValue();
+		pretty = prettyArg.getValue();
+	} catch (TCLAP::ArgException &e) {
+		std::cerr << "Error: " << e.error() << " for arg " << e.argId() << std::endl;
+		exit(1);
+	} catch (std::runtime_error &e) {
+		std::cerr << "Error: " << e.what() << std::endl;
+		exit(1);
+	}
+}
+
+/*
+ * SplitMix64, which is small, fast and gives the same numbers everywhere.
+ */
+class Random
+{
+	uint64_t state;
+
+public:
+	explicit Random(uint64_t seed) {
+		state = seed;
+	}
+
+	uint64_t next()
+	{
+		uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	uint64_t next(const Range &range) {
+		return range.min + next() % (range.max - range.min + 1);
+	}
+
+	int pick(const uint64_t* weights, int start, int end)
+	{
+		uint64_t total = 0;
+
+		for(int i=start;i<end;i++) {
+			total += weights[i];
+		}
+
+		uint64_t v = next() % total;
+
+		for(int i=start;i<end;i++)
+		{
+			if(v < weights[i]) {
+				return i;
+			}
+
+			v -= weights[i];
+		}
+
+		return end - 1;
+	}
+};
+
+char randomChar(Random &random) {
+	return "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_"[random.next() % 63];
+}
+
+class Generator
+{
+	Random random;
+	std::ostream &out;
+	std::vector<std::string> keys;
+
+	// Binary output
+	bool measuring;
+	std::vector<int> sizes;
+	size_t sizes_upto;
+
+	// Human readable output
+	Bdf::BdfIndent indent;
+
+	int getSizeBytes(int size)
+	{
+		if(size > 65535) {
+			return 4;
+		} else if(size > 255) {
+			return 2;
+		} else {
+			return 1;
+		}
+	}
+
+	char getSizeTag(int size_bytes)
+	{
+		switch(size_bytes) {
+			case 4: return 0;
+			case 2: return 1;
+			default: return 2;
+		}
+	}
+
+	void writeSize(int v, int size_bytes)
+	{
+		char data[4] = {(char)(v >> 24), (char)(v >> 16), (char)(v >> 8), (char)v};
+		out.write(data + 4 - size_bytes, size_bytes);
+	}
+
+	void writeHeader(char type, int size, char parent_flags)
+	{
+		if(measuring) {
+			return;
+		}
+
+		int size_bytes = getSizeBytes(size);
+
+		out.put(Bdf::BdfObject::getFlags(type, getSizeTag(size_bytes), parent_flags));
+		writeSize(size, size_bytes);
+	}
+
+	/*
+	 * Adds the size of a header to the payload size of an object with a size tag,
+	 * in the same way as BdfObject::serializeSeeker().
+	 */
+	int addHeaderSize(uint64_t size)
+	{
+		size += 1;
+
+		if(size > 65531) {
+			size += 4;
+		} else if(size > 253) {
+			size += 2;
+		} else {
+			size += 1;
+		}
+
+		if(size > INT_MAX) {
+			throw std::runtime_error("Binary BDF objects are limited to 2 GiB. Generate human readable output or a smaller document.");
+		}
+
+		return size;
+	}
+
+	int getElementSize(int type)
+	{
+		switch(type)
+		{
+			case GEN_BOOLEAN:
+			case GEN_BYTE:
+				return 1;
+			case GEN_SHORT:
+				return 2;
+			case GEN_INTEGER:
+			case GEN_FLOAT:
+				return 4;
+			default:
+				return 8;
+		}
+	}
+
+	char getBdfType(int type)
+	{
+		switch(type)
+		{
+			case GEN_BOOLEAN: return Bdf::BdfTypes::BOOLEAN;
+			case GEN_BYTE: return Bdf::BdfTypes::BYTE;
+			case GEN_SHORT: return Bdf::BdfTypes::SHORT;
+			case GEN_INTEGER: return Bdf::BdfTypes::INTEGER;
+			case GEN_LONG: return Bdf::BdfTypes::LONG;
+			case GEN_FLOAT: return Bdf::BdfTypes::FLOAT;
+			case GEN_DOUBLE: return Bdf::BdfTypes::DOUBLE;
+			case GEN_STRING: return Bdf::BdfTypes::STRING;
+			case GEN_LIST: return Bdf::BdfTypes::LIST;
+			case GEN_NAMED_LIST: return Bdf::BdfTypes::NAMED_LIST;
+			default: return getBdfType(type - GEN_ARRAY_BOOLEAN) + (Bdf::BdfTypes::ARRAY_BOOLEAN - Bdf::BdfTypes::BOOLEAN);
+		}
+	}
+
+	/*
+	 * Gets the bits of a random element of type, with a range that keeps numbers readable
+	 * and gives variable length encodings something realistic to work with.
+	 */
+	uint64_t randomElement(Random &random, int type)
+	{
+		switch(type)
+		{
+			case GEN_BOOLEAN:
+				return random.next() & 1;
+			case GEN_FLOAT: {
+				float v = (int64_t)(random.next() % 2000001 - 1000000) / 100.0f;
+				uint32_t bits;
+				memcpy(&bits, &v, 4);
+				return bits;
+			}
+			case GEN_DOUBLE: {
+				double v = (int64_t)(random.next() % 2000000001 - 1000000000) / 1000.0;
+				uint64_t bits;
+				memcpy(&bits, &v, 8);
+				return bits;
+			}
+			default:
+				return random.next();
+		}
+	}
+
+	void writeElementBinary(uint64_t v, int size)
+	{
+		char data[8];
+
+		for(int i=0;i<size;i++) {
+			data[i] = (char)(v >> ((size - i - 1) * 8));
+		}
+
+		out.write(data, size);
+	}
+
+	void writeElementHuman(uint64_t v, int type)
+	{
+		switch(type)
+		{
+			case GEN_BOOLEAN:
+				out << (v ? "true" : "false");
+				break;
+			case GEN_BYTE:
+				out << (int)(int8_t)v << "B";
+				break;
+			case GEN_SHORT:
+				out << (int16_t)v << "S";
+				break;
+			case GEN_INTEGER:
+				out << (int32_t)v << "I";
+				break;
+			case GEN_LONG:
+				out << (int64_t)v << "L";
+				break;
+			case GEN_FLOAT: {
+				float f;
+				uint32_t bits = v;
+				memcpy(&f, &bits, 4);
+				out << f << "F";
+				break;
+			}
+			case GEN_DOUBLE: {
+				double d;
+				memcpy(&d, &v, 8);
+				out << d << "D";
+				break;
+			}
+		}
+	}
+
+	/*
+	 * Strings and arrays get their contents from their own generator, seeded from the
+	 * main one, so measuring them doesn't need to generate their contents.
+	 */
+	int binaryLeaf(int type, char parent_flags)
+	{
+		if(type < GEN_STRING)
+		{
+			int size = getElementSize(type);
+
+			if(!measuring) {
+				out.put(Bdf::BdfObject::getFlags(getBdfType(type), 0, parent_flags));
+				writeElementBinary(randomElement(random, type), size);
+			} else {
+				randomElement(random, type);
+			}
+
+			return size + 1;
+		}
+
+		Random content(random.next());
+
+		if(type == GEN_STRING)
+		{
+			uint64_t length = random.next(stringLength);
+			int size = addHeaderSize(length);
+
+			if(!measuring)
+			{
+				writeHeader(Bdf::BdfTypes::STRING, size, parent_flags);
+
+				for(uint64_t i=0;i<length;i++) {
+					out.put(randomChar(content));
+				}
+			}
+
+			return size;
+		}
+
+		int element = type - GEN_ARRAY_BOOLEAN;
+		int element_size = getElementSize(element);
+		uint64_t length = random.next(arrayLength);
+		int size = addHeaderSize(length * element_size);
+
+		if(!measuring)
+		{
+			writeHeader(getBdfType(type), size, parent_flags);
+
+			for(uint64_t i=0;i<length;i++) {
+				writeElementBinary(randomElement(content, element), element_size);
+			}
+		}
+
+		return size;
+	}
+
+	int binaryValue(int level, char parent_flags)
+	{
+		if(level == depth) {
+			return binaryLeaf(random.pick(typeWeights, 0, GEN_LIST), parent_flags);
+		}
+
+		int type = random.pick(typeWeights, GEN_LIST, GEN_TYPE_COUNT);
+		size_t index = sizes_upto++;
+
+		if(measuring) {
+			sizes.push_back(0);
+		} else {
+			writeHeader(getBdfType(type), sizes[index], parent_flags);
+		}
+
+		uint64_t size = 0;
+		uint64_t first_key = random.next() % keyCount;
+
+		for(int i=0;i<fanOut;i++)
+		{
+			if(type == GEN_LIST) {
+				size += binaryValue(level + 1, 0);
+				continue;
+			}
+
+			int key = (first_key + i) % keyCount;
+			int key_size = getSizeBytes(key);
+
+			size += binaryValue(level + 1, getSizeTag(key_size));
+			size += key_size;
+
+			if(!measuring) {
+				writeSize(key, key_size);
+			}
+		}
+
+		if(measuring) {
+			sizes[index] = addHeaderSize(size);
+		}
+
+		return sizes[index];
+	}
+
+	void humanLeaf(int type, int it)
+	{
+		if(type < GEN_STRING) {
+			writeElementHuman(randomElement(random, type), type);
+			return;
+		}
+
+		Random content(random.next());
+
+		if(type == GEN_STRING)
+		{
+			uint64_t length = random.next(stringLength);
+
+			out << '"';
+
+			for(uint64_t i=0;i<length;i++) {
+				out.put(randomChar(content));
+			}
+
+			out << '"';
+			return;
+		}
+
+		int element = type - GEN_ARRAY_BOOLEAN;
+		uint64_t length = random.next(arrayLength);
+		std::string name = genTypeNames[element];
+
+		out << name << "(";
+
+		for(uint64_t i=0;i<length;i++)
+		{
+			out << indent.breaker << indent.calcIndent(it);
+			writeElementHuman(randomElement(content, element), element);
+
+			if(i != length - 1) {
+				out << ", ";
+			}
+		}
+
+		out << indent.breaker << indent.calcIndent(it - 1) << ")";
+	}
+
+	void humanValue(int level, int it)
+	{
+		if(level == depth) {
+			humanLeaf(random.pick(typeWeights, 0, GEN_LIST), it);
+			return;
+		}
+
+		int type = random.pick(typeWeights, GEN_LIST, GEN_TYPE_COUNT);
+		uint64_t first_key = random.next() % keyCount;
+
+		out << (type == GEN_LIST ? "[" : "{");
+
+		for(int i=0;i<fanOut;i++)
+		{
+			if(i != 0) {
+				out << ", ";
+			}
+
+			out << indent.breaker << indent.calcIndent(it);
+
+			if(type == GEN_NAMED_LIST) {
+				out << '"' << keys[(first_key + i) % keyCount] << "\": ";
+			}
+
+			humanValue(level + 1, it + 1);
+		}
+
+		out << indent.breaker << indent.calcIndent(it - 1) << (type == GEN_LIST ? "]" : "}");
+	}
+
+public:
+	Generator(std::ostream &pOut) : random(seed), out(pOut), indent("", "")
+	{
+		if(pretty) {
+			indent = Bdf::BdfIndent("\t", "\n");
+		}
+
+		// Keys are generated first, so the document only depends on the options that shape it
+		std::unordered_set<std::string> used;
+		Random key_random(seed ^ 0x6B6579736B657973ULL);
+
+		while((int)keys.size() < keyCount)
+		{
+			std::string key;
+			uint64_t length = key_random.next(keyLength);
+
+			for(uint64_t i=0;i<length;i++) {
+				key += randomChar(key_random);
+			}
+
+			if(used.insert(key).second) {
+				keys.push_back(key);
+			}
+		}
+	}
+
+	void writeBinary()
+	{
+		int lookupTable_size = 0;
+
+		for(const std::string &key : keys) {
+			lookupTable_size += key.size() + 1;
+		}
+
+		int lookupTable_size_bytes = getSizeBytes(lookupTable_size);
+		char lookupTable_size_tag = getSizeTag(lookupTable_size_bytes);
+
+		Random start = random;
+
+		measuring = true;
+		sizes_upto = 0;
+		binaryValue(0, lookupTable_size_tag);
+
+		random = start;
+		measuring = false;
+		sizes_upto = 0;
+		binaryValue(0, lookupTable_size_tag);
+
+		writeSize(lookupTable_size, lookupTable_size_bytes);
+
+		for(const std::string &key : keys) {
+			out.put((char)key.size());
+			out.write(key.c_str(), key.size());
+		}
+	}
+
+	void writeHuman() {
+		humanValue(0, 0);
+		out << indent.breaker;
+	}
+};
+
+void checkOptions()
+{
+	if(depth < 0 || fanOut < 0) {
+		throw std::runtime_error("The depth and fan-out can't be negative.");
+	}
+
+	if(keyLength.min == 0 || keyLength.max > 255) {
+		throw std::runtime_error("Keys must be between 1 and 255 characters long.");
+	}
+
+	// Keys in a named list have to be different, and there have to be enough keys of the given lengths
+	if(depth > 0 && typeWeights[GEN_NAMED_LIST] != 0 && keyCount < fanOut) {
+		throw std::runtime_error("There must be at least as many keys as the fan-out.");
+	}
+
+	double possible_keys = 0;
+
+	for(uint64_t length=keyLength.min;length<=keyLength.max && possible_keys < keyCount;length++) {
+		possible_keys += std::pow(63.0, length);
+	}
+
+	if(keyCount < 1 || possible_keys < keyCount) {
+		throw std::runtime_error("The number of keys must be at least 1 and fit the key length.");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	// Get command line arguments, or show help if necessary
+	getCliArgsOrShowHelp(argc, argv);
+
+	try {
+		checkOptions();
+
+		std::ofstream file;
+
+		if(!outputFile.empty())
+		{
+			file.open(outputFile, std::ios::out | std::ios::binary);
+
+			if(!file.is_open()) {
+				throw std::runtime_error("Could not open " + outputFile.string() + " for writing.");
+			}
+		}
+
+		std::ostream &out = outputFile.empty() ? std::cout : file;
+		Generator generator(out);
+
+		if(outputMode == "binary") {
+			generator.writeBinary();
+		} else {
+			generator.writeHuman();
+		}
+
+		out.flush();
+
+		if(!out) {
+			throw std::runtime_error("Could not write the output BDF data.");
+		}
+	} catch (std::exception &e) {
+		std::cerr << "An error occured while generating the BDF data." << std::endl;
+		std::cerr << e.what() << std::endl;
+
+		exit(3);
+	}
+
+	return 0;
+}
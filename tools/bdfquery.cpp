@@ -0,0 +1,308 @@
+
+#include "../include/Bdf.hpp"
+#include "../include/BdfHelpers.hpp"
+#include "../include/version.hpp"
+
+#include <tclap/CmdLine.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "InputData.hpp"
+
+/*
+ * bdfquery.cpp
+ *
+ * Prints the object at a path in binary BDF data, such as ".sessions[1024].user.name". The input file is
+ * mapped into memory and only the lookup table and the bytes along the path are read, so a single field
+ * can be taken out of a document that is many gigabytes in size.
+ */
+
+std::string command = "bdfquery";
+
+std::string query, outputMode;
+std::filesystem::path inputFile, outputFile;
+bool pretty = false;
+bool listKeys = false;
+bool listSizes = false;
+
+// The names of the types as stored in binary data, including the compact encodings
+const char* queryTypeNames[Bdf::BdfTypes::STRING_REF + 1] = {
+	"undefined", "boolean", "integer", "long", "short", "byte", "double", "float", "string", "list", "named list",
+	"boolean array", "integer array", "long array", "short array", "byte array", "double array", "float array",
+	"integer array (varint)", "long array (varint)", "short array (varint)", "list (columnar)", "string (reference)"
+};
+
+const char* getQueryTypeName(char type) {
+	return (type >= 0 && type <= Bdf::BdfTypes::STRING_REF) ? queryTypeNames[(int)type] : "unknown";
+}
+
+void getCliArgsOrShowHelp(int argc, char** argv) {
+	try {
+		TCLAP::CmdLine cmd("Prints the object at a path in binary BDF data, without reading the rest of the document.", ' ', Bdf::getLibraryVersion());
+
+		// path
+		TCLAP::UnlabeledValueArg<std::string> queryArg("path", "The path of the object to print, made of keys separated by dots and list indicies in square brackets, for example '.sessions[1024].user.name'. Leave it empty to print the whole document.", false, std::string(), "path", cmd);
+
+		// -f, --input-file
+		TCLAP::ValueArg<std::string> inputFileArg("f", "input-file", "The binary BDF file to read. Leave this argument unspecified to read from standard input instead, which has to be read in full.", false, std::string(), "filename", cmd);
+
+		// -w, --output-file
+		TCLAP::ValueArg<std::string> outputFileArg("w", "output-file", "If you need to write the object to a file, specify its path here. Leave this argument unspecified to write to standard output instead.", false, std::string(), "filename", cmd);
+
+		// -o, --output-mode
+		std::vector<std::string> outputModeArgVector{"binary", "human"};
+		TCLAP::ValuesConstraint<std::string> outputModeArgConstraint(outputModeArgVector);
+		TCLAP::ValueArg<std::string> outputModeArg("o", "output-mode", "Select the type of BDF data to print the object as. Binary output is a document holding only the object and the keys it uses.", false, "human", &outputModeArgConstraint, cmd);
+
+		// -p, --pretty
+		TCLAP::SwitchArg prettyArg("p", "pretty", "If bdfquery outputs human-readable BDF data, optimise it to look pretty.", cmd, false);
+
+		// -k, --keys
+		TCLAP::SwitchArg keysArg("k", "keys", "Print the keys of the named list at the path, one per line, instead of the object. For a list stored as columns, print the keys of its columns.", cmd, false);
+
+		// -s, --sizes
+		TCLAP::SwitchArg sizesArg("s", "sizes", "Print the type and size in bytes of the object at the path and of each object directly inside it, instead of the object. A value of a list stored as columns that is in a typed array is shown with the size of the array.", cmd, false);
+
+		// Parse the argv array.
+		cmd.parse( argc, argv );
+
+		query = queryArg.getValue();
+		inputFile = inputFileArg.getValue();
+		outputFile = outputFileArg.getValue();
+		outputMode = outputModeArg.getValue();
+		pretty = prettyArg.getValue();
+		listKeys = keysArg.getValue();
+		listSizes = sizesArg.getValue();
+	} catch (TCLAP::ArgException &e) {
+		std::cerr << "Error: " << e.error() << " for arg " << e.argId() << std::endl;
+		exit(1);
+	}
+}
+
+/**
+ * An object inside the list or named list found at the path, read straight from the binary data.
+ */
+class QueryItem
+{
+public:
+	std::string name;
+	char type;
+	int size;
+};
+
+std::vector<QueryItem> getQueryItems(Bdf::BdfReaderPath &reader, const Bdf::BdfPath::View &view) {
+	std::vector<QueryItem> items;
+
+	// Values in typed array columns have no flag byte, and nothing inside them
+	if (view.element != -1) {
+		return items;
+	}
+
+	char type, size_tag;
+	Bdf::BdfObject::getFlagData(view.data, &type, &size_tag, NULL);
+
+	int offset = 1 + Bdf::BdfObject::getSizeBytes(size_tag);
+	const char* payload = view.data + offset;
+	int payload_size = view.size - offset;
+	int pos = 0;
+
+	if (type == Bdf::BdfTypes::LIST_COLUMNAR) {
+		// Columnar lists start with the number of rows and columns, then each column follows its key.
+		uint64_t rows, columns, key;
+		int varint_size = BdfHelpers::get_varint(payload, payload_size, &rows);
+
+		if (varint_size != -1) {
+			pos = varint_size;
+			varint_size = BdfHelpers::get_varint(payload + pos, payload_size - pos, &columns);
+		}
+
+		if (varint_size == -1) {
+			throw std::runtime_error("The columnar list at the path is malformed.");
+		}
+
+		pos += varint_size;
+
+		for (uint64_t i = 0; i < columns; i++) {
+			varint_size = BdfHelpers::get_varint(payload + pos, payload_size - pos, &key);
+
+			if (varint_size == -1) {
+				throw std::runtime_error("The columnar list at the path is malformed.");
+			}
+
+			pos += varint_size;
+
+			int object_size = Bdf::BdfObject::getCheckedSize(payload + pos, payload_size - pos);
+
+			if (object_size == -1) {
+				throw std::runtime_error("The columnar list at the path is malformed.");
+			}
+
+			char column_type;
+			Bdf::BdfObject::getFlagData(payload + pos, &column_type, NULL, NULL);
+
+			items.push_back({reader.getObject()->getKeyName((int)key), column_type, object_size});
+			pos += object_size;
+		}
+
+		return items;
+	}
+
+	if (type != Bdf::BdfTypes::LIST && type != Bdf::BdfTypes::NAMED_LIST) {
+		return items;
+	}
+
+	for (uint64_t index = 0; pos < payload_size; index++) {
+		int object_size = Bdf::BdfObject::getCheckedSize(payload + pos, payload_size - pos);
+
+		if (object_size == -1) {
+			throw std::runtime_error("The list at the path is malformed.");
+		}
+
+		char item_type, key_size_tag;
+		Bdf::BdfObject::getFlagData(payload + pos, &item_type, NULL, &key_size_tag);
+
+		if (type == Bdf::BdfTypes::LIST) {
+			items.push_back({"[" + std::to_string(index) + "]", item_type, object_size});
+			pos += object_size;
+			continue;
+		}
+
+		// Named list items are followed by their key
+		int key_size = Bdf::BdfObject::getSizeBytes(key_size_tag);
+		const char* key_data = payload + pos + object_size;
+		int key;
+
+		if (pos + object_size + key_size > payload_size) {
+			throw std::runtime_error("The named list at the path is malformed.");
+		}
+
+		switch (key_size) {
+			case 4:
+				key = BdfHelpers::get_netsi(key_data);
+				break;
+			case 2:
+				key = BdfHelpers::get_netus(key_data);
+				break;
+			default:
+				key = key_data[0] & 255;
+		}
+
+		items.push_back({reader.getObject()->getKeyName(key), item_type, object_size});
+		pos += object_size + key_size;
+	}
+
+	return items;
+}
+
+void writeQueryOutput(Bdf::BdfReaderPath &reader, const Bdf::BdfPath &path, std::ostream &ostream) {
+	Bdf::BdfPath::View view = reader.getView();
+
+	if (listKeys) {
+		if (view.type != Bdf::BdfTypes::NAMED_LIST && view.type != Bdf::BdfTypes::LIST_COLUMNAR) {
+			throw std::runtime_error("The object at the path is a " + std::string(getQueryTypeName(view.type)) + ", not a named list.");
+		}
+
+		for (const QueryItem &item : getQueryItems(reader, view)) {
+			ostream << item.name << "\n";
+		}
+	} else if (listSizes) {
+		std::string prefix = path.toString();
+
+		ostream << (prefix.empty() ? "(root)" : prefix) << "\t" << getQueryTypeName(view.type) << "\t" << view.size << "\n";
+
+		for (const QueryItem &item : getQueryItems(reader, view)) {
+			ostream << prefix << (item.name[0] == '[' ? "" : ".") << item.name << "\t" << getQueryTypeName(item.type) << "\t" << item.size << "\n";
+		}
+	} else if (outputMode == "binary") {
+		char* data;
+		int data_size;
+		reader.serialize(&data, &data_size);
+
+		ostream.write(data, data_size);
+		delete[] data;
+	} else {
+		reader.serializeHumanReadable(ostream, pretty ? Bdf::BdfIndent("\t", "\n") : Bdf::BdfIndent("", ""));
+	}
+
+	ostream.flush();
+
+	if (!ostream) {
+		throw std::runtime_error("Could not write the output.");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	// Get command line arguments, or show help if necessary
+	getCliArgsOrShowHelp(argc, argv);
+
+	std::ios::sync_with_stdio(false);
+
+	Bdf::BdfPath path;
+
+	try {
+		path = Bdf::BdfPath::compile(query);
+	} catch (std::invalid_argument &e) {
+		std::cerr << "Error: " << e.what() << std::endl;
+		exit(1);
+	}
+
+	std::unique_ptr<InputData> inputData;
+	std::unique_ptr<Bdf::BdfReaderPath> reader;
+
+	try {
+		if (inputFile.empty()) {
+			inputData = std::make_unique<InputData>(std::cin);
+		} else {
+			inputData = std::make_unique<InputData>(inputFile);
+		}
+
+		if (inputData->size > (size_t)std::numeric_limits<int>::max()) {
+			throw std::runtime_error("The input is too large to be binary BDF data, which is limited to 2 GiB.");
+		}
+
+		// Listing keys and sizes only needs the binary data, so the object doesn't have to be decoded.
+		reader = std::make_unique<Bdf::BdfReaderPath>(inputData->data, (int)inputData->size, path, !listKeys && !listSizes);
+	} catch (Bdf::BdfError &e) {
+		std::cerr << "A parse error occured while reading the input BDF data." << std::endl;
+		std::cerr << "Description: " << e.getErrorShort() << std::endl;
+		exit(2);
+	} catch (std::exception &e) {
+		std::cerr << "An error occured while reading the input BDF data." << std::endl;
+		std::cerr << e.what() << std::endl;
+		exit(2);
+	}
+
+	if (!reader->getView()) {
+		std::cerr << "Nothing was found at " << (query.empty() ? "the root" : query) << "." << std::endl;
+		exit(4);
+	}
+
+	try {
+		std::ofstream ofstr;
+
+		if (!outputFile.empty()) {
+			ofstr.open(outputFile, std::ios::binary);
+
+			if (!ofstr) {
+				throw std::runtime_error("Could not open " + outputFile.string() + " for writing.");
+			}
+		}
+
+		writeQueryOutput(*reader, path, outputFile.empty() ? std::cout : ofstr);
+	} catch (std::exception &e) {
+		std::cerr << "An error occured while writing the output." << std::endl;
+		std::cerr << e.what() << std::endl;
+		exit(3);
+	}
+
+	return 0;
+}